@@ -60,83 +60,77 @@
 #include <thread>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <getopt.h>
 
 #include <dnndk/dnndk.h>
 
+#include "bounded_queue.h"
+#include "frame_admission.h"
+#include "frame_source.h"
+#include "reorder_buffer.h"
+#include "task_pool.h"
+#include "tensor_handle.h"
 #include "utils.h"
+#include "nms.h"
+#include "yolo_decode.h"
+#include "yolo_letterbox.h"
 
 
 using namespace std;
 using namespace cv;
 using namespace std::chrono;
+using namespace deephi;
 
 
 #define NMS_THRESHOLD 0.3f
 #define INPUT_NODE "layer0_conv"
 
+/* four output nodes of YOLO-v3 */
+const char *outputs_node[4] = {"layer81_conv", "layer93_conv", "layer105_conv",  "layer117_conv"};
+
+/* input and output Tensors of every Task, resolved on the Task's first frame:
+   slot 0 is the input, slots 1 to 4 the outputs */
+TaskTensors yoloTensors;
+
+/* anchors (width, height) of the four output nodes, five per node */
+const float yoloBiases[] = {123,100, 167,83, 98,174, 165,158, 347,98, 76,37,
+                            40,97, 74,64, 105,63, 66,131,18,46, 33,29, 47,23,
+                            28,68, 52,42, 5.5,7, 8,17, 14,11, 13,29, 24,17};
+
+/* decoders of the four output nodes, built from their scales at startup */
+vector<YoloDecoder> yoloDecoders;
+
+/* threads running YOLO-v3 */
+#define YOLO_THREAD_NUM 4
+
 int idxInputImage = 0;  // frame index of input video
-int idxShowImage = 0;   // next frame index to be displayed
-bool bReading = true;   // flag of reding input frame
 chrono::system_clock::time_point start_time;
 
-typedef pair<int, Mat> imagePair;
-class paircomp {
-    public:
-    bool operator()(const imagePair &n1, const imagePair &n2) const {
-        if (n1.first == n2.first) {
-            return (n1.first > n2.first);
-        }
+/* capture stamps and latency budget of the frames, see frame_admission.h */
+FrameAdmission *admission = nullptr;
 
-        return n1.first > n2.first;
-    }
-};
+typedef pair<int, Mat> imagePair;
 
-// mutex for protection of input frames queue
-mutex mtxQueueInput;
-// mutex for protection of display frmaes queue
-mutex mtxQueueShow;
 // input frames queue
-queue<pair<int, Mat>> queueInput;
-// display frames queue
-priority_queue<imagePair, vector<imagePair>, paircomp> queueShow;
+BoundedQueue<imagePair> queueInput(30);
+// display frames queue, in frame order; dropped frames are skipped
+ReorderBuffer<Mat> queueShow(30 + YOLO_THREAD_NUM);
+// YOLO-v3 threads still running
+atomic<int> yoloRunning(YOLO_THREAD_NUM);
 
 /**
  * @brief Feed input frame into DPU for process
  *
- * @param task - pointer to DPU Task for YOLO-v3 network
+ * @param input - input Tensor of the DPU Task for YOLO-v3 network
  * @param frame - pointer to input frame
- * @param mean - mean value for YOLO-v3 network
+ * @param letterbox - letterbox of the calling thread, see yolo_letterbox.h
  *
  * @return none
  */
-void setInputImageForYOLO(DPUTask* task, const Mat& frame, float* mean) {
-    Mat img_copy;
-    int height = dpuGetInputTensorHeight(task, INPUT_NODE);
-    int width = dpuGetInputTensorWidth(task, INPUT_NODE);
-    int size = dpuGetInputTensorSize(task, INPUT_NODE);
-    int8_t* data = dpuGetInputTensorAddress(task, INPUT_NODE);
-
-    image img_new = load_image_cv(frame);
-    image img_yolo = letterbox_image(img_new, width, height);
-
-    vector<float> bb(size);
-    for(int b = 0; b < height; ++b) {
-        for(int c = 0; c < width; ++c) {
-            for(int a = 0; a < 3; ++a) {
-                bb[b*width*3 + c*3 + a] = img_yolo.data[a*height*width + b*width + c];
-            }
-        }
-    }
-
-    float scale = pow(2, 7);
-
-    for(int i = 0; i < size; ++i) {
-        data[i] = int(bb.data()[i]*scale);
-        if(data[i] < 0) data[i] = 127;
-    }
-
-    free_image(img_new);
-    free_image(img_yolo);
+void setInputImageForYOLO(const TensorHandle& input, const Mat& frame, YoloLetterbox& letterbox) {
+    /* same INT8 tensor as the Darknet load_image_cv() and letterbox_image(),
+       written in one pass into the DPU input */
+    letterbox.Run(frame, input.width, input.height, input.addr);
 }
 
 
@@ -149,37 +143,61 @@ void setInputImageForYOLO(DPUTask* task, const Mat& frame, float* mean) {
  */
 void readFrame(const char *fileName) {
     static int loop = 3;
-    VideoCapture video;
+    /* decodes ahead of this thread, at the size of the video */
+    FrameSource video(1, 16);
     string videoFile = fileName;
     start_time = chrono::system_clock::now();
 
     while (loop>0) {
         loop--;
-        if (!video.open(videoFile)) {
+        if (!video.Open(videoFile)) {
             cout<<"Fail to open specified video file:" << videoFile << endl;
             exit(-1);
         }
 
+        /* in real-time mode deliver the frames at the rate of the video, as
+           a camera would, otherwise as fast as they are decoded */
+        double fps = video.fps();
+        auto period = duration_cast<steady_clock::duration>(
+            duration<double>(1.0 / (fps > 0 ? fps : 50)));
+        auto next = steady_clock::now();
+
+        int index;
+        Mat img;
         while (true) {
-            usleep(20000);
-            Mat img;
-            if (queueInput.size() < 30) {
-                if (!video.read(img) ) {
-                    break;
-                }
+            if (admission->enabled()) {
+                this_thread::sleep_until(next);
+                next += period;
+            }
 
-                mtxQueueInput.lock();
-                queueInput.push(make_pair(idxInputImage++, img));
-                mtxQueueInput.unlock();
-            } else {
-                usleep(10);
+            if (!video.Read(index, img)) {
+                break;
             }
-        }
+            admission->Capture(idxInputImage);
 
-        video.release();
+            imagePair pairIndexImage = make_pair(idxInputImage++, img);
+            if (admission->enabled()) {
+                if (queueInput.TryPush(pairIndexImage)) {
+                    continue;
+                }
+                /* real-time: the oldest frame gives way to the newest */
+                imagePair dropped;
+                if (queueInput.TryPop(dropped)) {
+                    admission->Drop();
+                    queueShow.Skip(dropped.first);
+                }
+            }
+            /* wait for room, the queue is closed if the display has quit */
+            if (!queueInput.Push(pairIndexImage)) {
+                loop = 0;
+                break;
+            }
+        }
     }
 
-    exit(0);
+    video.Close();
+    video.Report();
+    queueInput.Close();
 }
 
 /**
@@ -190,34 +208,27 @@ void readFrame(const char *fileName) {
  *
  */
 void displayFrame() {
+    /* frames in frame order as soon as the next one is done, the dropped
+       ones passed over */
+    long idxShowImage;
     Mat frame;
 
-    while (true) {
-        mtxQueueShow.lock();
-
-        if (queueShow.empty()) {
-            mtxQueueShow.unlock();
-            usleep(10);
-        } else if (idxShowImage == queueShow.top().first) {
-            auto show_time = chrono::system_clock::now();
-            stringstream buffer;
-            frame = queueShow.top().second;
-            auto dura = (duration_cast<microseconds>(show_time - start_time)).count();
-            buffer << fixed << setprecision(1)
-                   << (float)queueShow.top().first / (dura / 1000000.f);
-            string a = buffer.str() + " FPS";
-            cv::putText(frame, a, cv::Point(10, 15), 1, 1, cv::Scalar{240, 240, 240},1);
-            cv::imshow("ADAS Detection@Deephi DPU", frame);
-
-            idxShowImage++;
-            queueShow.pop();
-            mtxQueueShow.unlock();
-            if (waitKey(1) == 'q') {
-                bReading = false;
-                exit(0);
-            }
-        } else {
-            mtxQueueShow.unlock();
+    while (queueShow.Next(idxShowImage, frame)) {
+        admission->Shown(idxShowImage);
+        auto show_time = chrono::system_clock::now();
+        stringstream buffer;
+        auto dura = (duration_cast<microseconds>(show_time - start_time)).count();
+        buffer << fixed << setprecision(1)
+               << (float)idxShowImage / (dura / 1000000.f);
+        string a = buffer.str() + " FPS";
+        cv::putText(frame, a, cv::Point(10, 15), 1, 1, cv::Scalar{240, 240, 240},1);
+        cv::imshow("ADAS Detection@Deephi DPU", frame);
+
+        if (waitKey(1) == 'q') {
+            /* stop the reader and the YOLO-v3 threads */
+            queueInput.Close();
+            queueShow.Close();
+            return;
         }
     }
 }
@@ -225,56 +236,46 @@ void displayFrame() {
 /**
  * @brief Post process after the running of DPU for YOLO-v3 network
  *
- * @param task - pointer to DPU task for running YOLO-v3
+ * @param outputs - the four output Tensors of the DPU task for running YOLO-v3
  * @param frame
  * @param sWidth
  * @param sHeight
+ * @param boxes - candidate boxes, reused by the thread for every frame
+ * @param res - boxes kept by NMS, reused by the thread for every frame
+ * @param nms - NMS engine of the thread
  *
  * @return none
  */
-void postProcess(DPUTask* task, Mat& frame, int sWidth, int sHeight){
-    const string classes[3] = {"car", "person", "cycle"};
-
-    /* four output nodes of YOLO-v3 */
-    const string outputs_node[4] = {"layer81_conv", "layer93_conv", "layer105_conv",  "layer117_conv"};
-
-    vector<vector<float>> boxes;
+void postProcess(const TensorHandle* outputs, Mat& frame, int sWidth, int sHeight,
+                 Detections& boxes, Detections& res, NmsEngine& nms){
+    boxes.clear();
     for(int i = 0; i < 4; i++){
-        string output_node = outputs_node[i];
-        int channel = dpuGetOutputTensorChannel(task, output_node.c_str());
-        int width = dpuGetOutputTensorWidth(task, output_node.c_str());
-        int height = dpuGetOutputTensorHeight(task, output_node.c_str());
-
-        int sizeOut = dpuGetOutputTensorSize(task, output_node.c_str());
-        int8_t* dpuOut = dpuGetOutputTensorAddress(task, output_node.c_str());
-        float scale = dpuGetOutputTensorScale(task, output_node.c_str());
-        vector<float> result(sizeOut);
-        boxes.reserve(sizeOut);
-
-        /* Store every output node results */
-        get_output(dpuOut, sizeOut, scale, channel, height, width, result);
-
-        /* Store the object detection frames as coordinate information  */
-        detect(boxes, result, channel, height, width, i, sHeight, sWidth);
+        /* Store the object detection frames as coordinate information,
+           decoding only the anchors passing the objectness threshold */
+        yoloDecoders[i].Decode(outputs[i].addr, outputs[i].height, outputs[i].width,
+                               sWidth, sHeight, boxes);
     }
 
     /* Restore the correct coordinate frame of the original image */
-    correct_region_boxes(boxes, boxes.size(), frame.cols, frame.rows, sWidth, sHeight);
+    correct_region_boxes(boxes, frame.cols, frame.rows, sWidth, sHeight);
 
-    /* Apply the computation for NMS */
-    vector<vector<float>> res = applyNMS(boxes, classificationCnt, NMS_THRESHOLD);
+    /* Apply the computation for NMS, all classes at once */
+    nms.Run(boxes, NMS_THRESHOLD, CONF, res);
 
     float h = frame.rows;
     float w = frame.cols;
+    const float *x = res.coord(0);
+    const float *y = res.coord(1);
+    const float *bw = res.coord(2);
+    const float *bh = res.coord(3);
     for(size_t i = 0; i < res.size(); ++i) {
-        float xmin = (res[i][0] - res[i][2]/2.0) * w + 1.0;
-        float ymin = (res[i][1] - res[i][3]/2.0) * h + 1.0;
-        float xmax = (res[i][0] + res[i][2]/2.0) * w + 1.0;
-        float ymax = (res[i][1] + res[i][3]/2.0) * h + 1.0;
+        float xmin = (x[i] - bw[i]/2.0) * w + 1.0;
+        float ymin = (y[i] - bh[i]/2.0) * h + 1.0;
+        float xmax = (x[i] + bw[i]/2.0) * w + 1.0;
+        float ymax = (y[i] + bh[i]/2.0) * h + 1.0;
 
-        if(res[i][res[i][4] + 6] > CONF ) {
-            int type = res[i][4];
-            string classname = classes[type];
+        int type = res.label()[i];
+        if(res.class_score(type)[i] > CONF ) {
 
             if (type==0) {
                 rectangle(frame, cvPoint(xmin, ymin), cvPoint(xmax, ymax), Scalar(0, 0, 255), 1, 1, 0);
@@ -292,48 +293,53 @@ void postProcess(DPUTask* task, Mat& frame, int sWidth, int sHeight){
 /**
  * @brief Thread entry for running YOLO-v3 network on DPU for acceleration
  *
- * @param task - pointer to DPU task for running YOLO-v3
+ * @param pool - pool of the DPU Tasks for running YOLO-v3
+ * @param kernel - DPU Kernel of YOLO-v3
  *
  * @return none
  */
-void runYOLO(DPUTask* task) {
-    /* mean values for YOLO-v3 */
-    float mean[3] = {0.0f, 0.0f, 0.0f};
-
-    int height = dpuGetInputTensorHeight(task, INPUT_NODE);
-    int width = dpuGetInputTensorWidth(task, INPUT_NODE);
-
-    while (true) {
-        pair<int, Mat> pairIndexImage;
-
-        mtxQueueInput.lock();
-        if (queueInput.empty()) {
-            mtxQueueInput.unlock();
-            if (bReading)
-            {
-                continue;
-            } else {
+void runYOLO(TaskPool &pool, DPUKernel *kernel) {
+    /* letterbox tables and scratch rows of this thread */
+    YoloLetterbox letterbox;
+
+    /* boxes of the frames, their memory kept from frame to frame */
+    Detections boxes(classificationCnt), res(classificationCnt);
+    NmsEngine nms(NmsEngine::CENTER_SIZE);
+
+    /* get input frames until the queue is closed and drained */
+    pair<int, Mat> pairIndexImage;
+    while (queueInput.Pop(pairIndexImage)) {
+        /* drop the frame if its result would come too late */
+        if (!admission->Admit(pairIndexImage.first)) {
+            if (!queueShow.Skip(pairIndexImage.first)) {
                 break;
             }
-        } else {
-            /* get an input frame from input frames queue */
-            pairIndexImage = queueInput.front();
-            queueInput.pop();
-            mtxQueueInput.unlock();
+            continue;
         }
-        vector<vector<float>> res;
-        /* feed input frame into DPU Task with mean value */
-        setInputImageForYOLO(task, pairIndexImage.second, mean);
+
+        /* any free Task of the pool runs the frame */
+        TaskLease task(pool, kernel);
+        const TensorHandle *tensors = yoloTensors.Get(task);
+        int height = tensors[0].height;
+        int width = tensors[0].width;
+
+        /* feed input frame into DPU Task */
+        setInputImageForYOLO(tensors[0], pairIndexImage.second, letterbox);
 
         /* invoke the running of DPU for YOLO-v3 */
         dpuRunTask(task);
 
-        postProcess(task, pairIndexImage.second, width, height);
-        mtxQueueShow.lock();
+        postProcess(tensors + 1, pairIndexImage.second, width, height, boxes, res, nms);
+
+        /* push the image into display frame queue, closed if the display has quit */
+        if (!queueShow.Put(pairIndexImage.first, pairIndexImage.second)) {
+            break;
+        }
+    }
 
-        /* push the image into display frame queue */
-        queueShow.push(pairIndexImage);
-        mtxQueueShow.unlock();
+    /* the last thread ends the display */
+    if (--yoloRunning == 0) {
+        queueShow.Close();
     }
 }
 
@@ -341,22 +347,65 @@ void runYOLO(DPUTask* task) {
  * @brief Entry for running YOLO-v3 neural network for ADAS object detection
  *
  */
-int main(const int argc, const char** argv) {
-    if (argc != 2) {
-        cout << "Usage of ADAS detection: ./adas video-file" << endl;
+int main(const int argc, char** argv) {
+    int maxAge = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:")) != -1) {
+        switch (opt) {
+        case 'a':
+            maxAge = atoi(optarg);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        cout << "Usage of ADAS detection: ./adas [-a max_age_ms] video-file" << endl;
+        cout << "  -a  real-time mode: play the video at its frame rate, drop the frames" << endl;
+        cout << "      that cannot be shown within max_age_ms of their capture, and" << endl;
+        cout << "      report the latency" << endl;
         return -1;
     }
 
+    /* capture stamps of the frames, reported at the end */
+    FrameAdmission frameAdmission(maxAge);
+    admission = &frameAdmission;
+
     /* Attach to DPU driver and prepare for running */
     dpuOpen();
 
     /* Load DPU Kernels for YOLO-v3 network model */
     DPUKernel *kernel = dpuLoadKernel("yolo");
-    vector<DPUTask *> task(4);
 
-    /* Create 4 DPU Tasks for YOLO-v3 network model */
-    generate(task.begin(), task.end(),
-    std::bind(dpuCreateTask, kernel, 0));
+    /* Create 4 DPU Tasks for YOLO-v3 network model, shared by the threads */
+    TaskPool pool;
+    pool.Add(kernel, 4, 4, "yolo");
+
+    /* declare the Tensors of the Tasks and show their shapes */
+    yoloTensors.AddInput(INPUT_NODE);
+    for (int i = 0; i < 4; i++) {
+        yoloTensors.AddOutput(outputs_node[i]);
+    }
+    {
+        TaskLease task(pool, kernel);
+        vector<string> nodes(outputs_node, outputs_node + 4);
+        nodes.insert(nodes.begin(), INPUT_NODE);
+        PrintKernelNodes(stdout, ProbeKernelNodes(task, nodes));
+        const TensorHandle *tensors = yoloTensors.Get(task);
+        if (!tensors) {
+            return -1;
+        }
+        for (int i = 0; i < 4; i++) {
+            if (tensors[i + 1].channel != anchorCnt * (5 + classificationCnt)) {
+                fprintf(stderr, "Error: %s has %d channels, expected %d\n", outputs_node[i],
+                        tensors[i + 1].channel, anchorCnt * (5 + classificationCnt));
+                return -1;
+            }
+            yoloDecoders.emplace_back(tensors[i + 1].scale, classificationCnt, anchorCnt,
+                                      yoloBiases + 2 * anchorCnt * i, CONF);
+        }
+    }
 
     /* Spawn 6 threads:
     - 1 thread for reading video frame
@@ -364,12 +413,12 @@ int main(const int argc, const char** argv) {
     - 1 thread for displaying frame in monitor
     */
     array<thread, 6> threadsList = {
-    thread(readFrame, argv[1]),
+    thread(readFrame, argv[optind]),
     thread(displayFrame),
-    thread(runYOLO, task[0]),
-    thread(runYOLO, task[1]),
-    thread(runYOLO, task[2]),
-    thread(runYOLO, task[3]),
+    thread(runYOLO, ref(pool), kernel),
+    thread(runYOLO, ref(pool), kernel),
+    thread(runYOLO, ref(pool), kernel),
+    thread(runYOLO, ref(pool), kernel),
 
     };
 
@@ -378,7 +427,10 @@ int main(const int argc, const char** argv) {
     }
 
     /* Destroy DPU Tasks & free resources */
-    for_each(task.begin(), task.end(), dpuDestroyTask);
+    frameAdmission.Report();
+    queueShow.Report("display");
+    pool.Report();
+    pool.Release();
 
     /* Destroy DPU Kernels & free resources */
     dpuDestroyKernel(kernel);
@@ -66,8 +66,11 @@
 /* header file for DNNDK APIs */
 #include <dnndk/dnndk.h>
 
+#include "classify_result.h"
+
 using namespace std;
 using namespace cv;
+using namespace deephi;
 
 /* 3.16GOP times calculation for GoogLeNet CONV */
 #define GOOGLENET_WORKLOAD (3.16f)
@@ -145,55 +148,6 @@ void LoadWords(std::string const &path, std::vector<std::string> &kinds) {
     fkinds.close();
 }
 
-/**
- * @brief calculate softmax
- *
- * @param data - pointer to input buffer
- * @param size - size of input buffer
- * @param result - calculation result
- *
- * @return none
- */
-void CPUCalcSoftmax(const float *data, size_t size, float *result) {
-    assert(data && result);
-    double sum = 0.0f;
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] = exp(data[i]);
-        sum += result[i];
-    }
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] /= sum;
-    }
-}
-
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, std::vector<std::string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    std::priority_queue<std::pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(std::pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        std::pair<float, int> ki = q.top();
-        fprintf(stdout, "top[%d] prob = %-8f  name = %s\n", i, d[ki.second],
-            vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Run DPU Task for GoogLeNet
  *
@@ -223,8 +177,7 @@ void runGoogLeNet(DPUTask *taskGoogLeNet) {
 
     /* Get channel count of the output Tensor for GoogLeNet Task  */
     int channel = dpuGetOutputTensorChannel(taskGoogLeNet, OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *result = new float[channel];
+    ClassifyResult top5;
 
     for (auto &image_name : images) {
         cout << "\nLoad image : " << image_name << endl;
@@ -242,20 +195,16 @@ void runGoogLeNet(DPUTask *taskGoogLeNet) {
         float prof = (GOOGLENET_WORKLOAD / timeProf) * 1000000.0f;
         cout << "  DPU Task Performance: " << prof << "GOPS\n";
 
-        /* Get FC result and convert from INT8 to FP32 format */
-        dpuGetOutputTensorInHWCFP32(taskGoogLeNet, OUTPUT_NODE, result, channel);
-
-        /* Calculate softmax on CPU and display TOP-5 classification results */
-        CPUCalcSoftmax(result, channel, softmax);
-        TopK(softmax, channel, 5, kinds);
+        /* Select TOP-5 on the INT8 FC result and display the classification results */
+        int8_t *outAddr = dpuGetOutputTensorAddress(taskGoogLeNet, OUTPUT_NODE);
+        float outScale = dpuGetOutputTensorScale(taskGoogLeNet, OUTPUT_NODE);
+        ClassifyTopK(outAddr, channel, outScale, 5, top5);
+        PrintClassifyResult(top5, kinds);
 
         /* Display the image */
         cv::imshow("Classification of inception_v1", image);
         cv::waitKey(1);
     }
-
-    delete[] softmax;
-    delete[] result;
 }
 
 /**
@@ -57,6 +57,8 @@
 #include <vector>
 
 #include "dnndk/dnndk.h"
+#include "conv_fc_executor.h"
+#include "tensor_handle.h"
 
 using namespace std;
 using namespace cv;
@@ -73,19 +75,20 @@ using namespace cv;
 
 namespace deephi {
 
+// pool the output of the CONV Task into the input of the FC Task
+void CPUCalcAvgPool(DPUTask* conv, DPUTask* fc);
+
 class GestureDetect {
    public:
-    void Init();
+    void Init(ConvFcExecutor& executor);
     void Finalize();
     void Run(cv::Mat&);
     GestureDetect();
     ~GestureDetect();
 
    private:
-    DPUKernel* kernel_conv_PT;
-    DPUTask* task_conv_PT;
-    DPUKernel* kernel_fc_PT;
-    DPUTask* task_fc_PT;
+    ConvFcExecutor* executor_;
+    TaskTensors conv_input_;
 };
 }
 
@@ -48,6 +48,7 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <atomic>
@@ -57,9 +58,11 @@
 #include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <string>
@@ -73,11 +76,23 @@
 /* header file OpenCV for image processing */
 #include <opencv2/opencv.hpp>
 
+#include "classify_bench.h"
+#include "classify_pipeline.h"
+#include "classify_result.h"
+#include "stage_timer.h"
+#include "tensor_cache.h"
+#include "worker_context.h"
+
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
+using namespace deephi;
 
 int threadnum;
+/* B, G and R mean the Kernel was compiled with, for the tensor cache:
+   dpuSetInputImage2() applies the mean stored in the Kernel, which N2Cube
+   does not expose, so it has to be given with -m when it differs */
+float cacheMean[3] = {104, 117, 123};
 
 /* 3.16GOP times calculation for GoogLeNet CONV */
 #define GOOGLENET_WORKLOAD_CONV (3.16f)
@@ -93,21 +108,9 @@ int threadnum;
 
 const string baseImagePath = "./image/";
 
-#ifdef SHOWTIME
-#define _T(func)                                                          \
-{                                                                         \
-    auto _start = system_clock::now();                                    \
-    func;                                                                 \
-    auto _end = system_clock::now();                                      \
-    auto duration = (duration_cast<microseconds>(_end - _start)).count(); \
-    string tmp = #func;                                                   \
-    tmp = tmp.substr(0, tmp.find('('));                                   \
-    cout << "[TimeTest]" << left << setw(30) << tmp;                      \
-    cout << left << setw(10) << duration << "us" << endl;                 \
-}
-#else
-#define _T(func) func;
-#endif
+/* Time every _T() call into per-stage latency histograms, dumped at exit
+   and on SIGUSR1 */
+#define _T(func) STAGE_TIME(func)
 
 /**
  * @brief put image names to a vector
@@ -174,83 +177,36 @@ void LoadWords(string const &path, vector<string> &kinds) {
     fkinds.close();
 }
 
-/**
- * @brief softmax operation
- *
- * @param data - pointer to input buffer
- * @param size - size of input buffer
- * @param result - calculation result
- *
- * @return none
- */
-void CPUCalcSoftmax(const float *data, size_t size, float *result) {
-    assert(data && result);
-    double sum = 0.0f;
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] = exp(data[i]);
-        sum += result[i];
-    }
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] /= sum;
-    }
-}
-
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("[Top]%d prob = %-8f  name = %s\n", i, d[ki.second], vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Run Task for GoogLeNet
  *
- * @param taskGoogLeNet - pointer to GooLeNet Task
+ * @param ctx - context of the worker, owning its DPU Tasks
+ * @param img - input image
  *
  * @return none
  */
-void runGoogLeNet(DPUTask *taskGoogLeNet, Mat img) {
-    assert(taskGoogLeNet);
+void runGoogLeNet(WorkerContext &ctx, Mat img) {
+    DPUTask *taskGoogLeNet = ctx.task(0);
 
     int channel = dpuGetOutputTensorChannel(taskGoogLeNet, OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult &top5 = ctx.result();
+
     _T(dpuSetInputImage2(taskGoogLeNet, INPUT_NODE, img));
     _T(dpuRunTask(taskGoogLeNet));
 
-    _T(dpuGetOutputTensorInHWCFP32(taskGoogLeNet, OUTPUT_NODE, FCResult, channel));
-    _T(CPUCalcSoftmax(FCResult, channel, softmax));
-
-    delete[] softmax;
-    delete[] FCResult;
+    /* Select TOP-5 on the INT8 output */
+    int8_t *outAddr = dpuGetOutputTensorAddress(taskGoogLeNet, OUTPUT_NODE);
+    float outScale = dpuGetOutputTensorScale(taskGoogLeNet, OUTPUT_NODE);
+    _T(ClassifyTopK(outAddr, channel, outScale, 5, top5));
 }
 
 /*
  * @brief  - Entry of classify using GoogLeNet
  *
  * @param kernel - point to DPU Kernel
+ * @param pin - pin each worker thread to its own CPU
  */
-void classifyEntry(DPUKernel *kernelGoogLeNet) {
+void classifyEntry(DPUKernel *kernelGoogLeNet, bool pin) {
     vector<string> kinds, images;
     ListImages(baseImagePath, images);
     if (images.size() == 0) {
@@ -274,16 +230,14 @@ void classifyEntry(DPUKernel *kernelGoogLeNet) {
 
     for (auto i = 0; i < threadnum; i++) {
         workers[i] = thread([&,i]() {
-            /* Create DPU Tasks from DPU Kernel */
-            DPUTask *taskGoogLeNet = dpuCreateTask(kernelGoogLeNet, 0);
+            /* Create the context owning the DPU Tasks of this worker */
+            WorkerContext ctx(i, {kernelGoogLeNet}, pin ? i : -1);
+            ctx.Attach();
             for(unsigned int ind = i  ;ind < IMAGE_COUNT;ind+=threadnum) {
 
                 /* Process the image using GoogLeNet model*/
-                runGoogLeNet(taskGoogLeNet, img);
+                runGoogLeNet(ctx, img);
             }
-
-            /* Destroy DPU Tasks & free resources */
-            dpuDestroyTask(taskGoogLeNet);
         });
     }
 
@@ -298,16 +252,233 @@ void classifyEntry(DPUKernel *kernelGoogLeNet) {
     cout << "[FPS]" << IMAGE_COUNT*1000000.0/duration  << endl;
 }
 
+/**
+ * @brief  - Entry of the staged classification pipeline over an image directory
+ *
+ * @param kernelGoogLeNet - point to DPU Kernel
+ * @param path - directory of the images
+ * @param count - number of images to classify, 0 for each image once
+ * @param depth - capacity of the queues between two stages
+ * @param argmax - only pick the most probable class, without softmax
+ * @param pin - pin each DPU worker thread to its own CPU
+ * @param cache - Tensor cache file of the preprocessed images, empty to
+ *                decode every image
+ * @param list - labelled image list to benchmark, empty to run the pipeline
+ * @param bench - warmup, count, duration and outputs of the benchmark
+ *
+ * @return none
+ */
+void pipelineEntry(DPUKernel *kernelGoogLeNet, string path,
+                   int count, int depth, bool argmax, bool pin, string cache,
+                   string list, BenchConfig bench) {
+    vector<string> kinds, images;
+    if (path.back() != '/') {
+        path += '/';
+    }
+
+    ListImages(path, images);
+    if (images.size() == 0) {
+        cerr << "\nError: Not images exist in " << path << endl;
+        return;
+    }
+
+    /* Load all kinds words.*/
+    LoadWords(path + "words.txt", kinds);
+    if (kinds.size() == 0) {
+        cerr << "\nError: Not words exist in words.txt." << endl;
+        return;
+    }
+
+    if (count <= 0) {
+        count = images.size();
+    }
+    cout << "total image : " << count << endl;
+
+    /* Create the context, owning the DPU Tasks, of each DPU worker */
+    vector<unique_ptr<WorkerContext>> contexts;
+    for (auto i = 0; i < threadnum; i++) {
+        contexts.emplace_back(new WorkerContext(i, {kernelGoogLeNet}, pin ? i : -1));
+    }
+
+    Size inputSize(dpuGetInputTensorWidth(contexts[0]->task(0), INPUT_NODE),
+                   dpuGetInputTensorHeight(contexts[0]->task(0), INPUT_NODE));
+    int channel = dpuGetOutputTensorChannel(contexts[0]->task(0), OUTPUT_NODE);
+    ClassifyResult top5;
+
+    ClassifyPipeline pipeline(threadnum, inputSize, depth);
+
+    /* Images in the cache skip decoding and preprocessing */
+    TensorCache tensorCache;
+    if (!cache.empty()) {
+        TensorCacheKey key = {inputSize.width, inputSize.height,
+                              dpuGetInputTensorChannel(contexts[0]->task(0), INPUT_NODE),
+                              {cacheMean[0], cacheMean[1], cacheMean[2]},
+                              dpuGetInputTensorScale(contexts[0]->task(0), INPUT_NODE)};
+        if (!tensorCache.Open(cache)) {
+            return;
+        }
+        if (!tensorCache.Matches(key)) {
+            cerr << "\nError: " << cache << " is not built for this input Tensor, rebuild it with" << endl;
+            cerr << "  tensor_cache_build " << path << " " << cache << " " << key.width << " "
+                 << key.height << " " << key.scale << " " << key.mean[0] << " "
+                 << key.mean[1] << " " << key.mean[2] << endl;
+            return;
+        }
+        pipeline.UseCache(&tensorCache);
+    }
+
+    /* DPU stage, shared by the pipeline and the benchmark */
+    ClassifyPipeline::InferFunc infer = [&](int id, ClassifyJob &job) {
+        WorkerContext &ctx = *contexts[id];
+        ctx.Attach();
+
+        if (job.tensor) {
+            _T(memcpy(dpuGetInputTensorAddress(ctx.task(0), INPUT_NODE), job.tensor,
+                      dpuGetInputTensorSize(ctx.task(0), INPUT_NODE)));
+        } else {
+            _T(dpuSetInputImage2(ctx.task(0), INPUT_NODE, job.image));
+        }
+        _T(dpuRunTask(ctx.task(0)));
+
+        /* Keep the output so that the Task can take the next image */
+        int8_t *outAddr = dpuGetOutputTensorAddress(ctx.task(0), OUTPUT_NODE);
+        int size = dpuGetOutputTensorSize(ctx.task(0), OUTPUT_NODE);
+        job.logits.assign(outAddr, outAddr + size);
+        job.scale = dpuGetOutputTensorScale(ctx.task(0), OUTPUT_NODE);
+    };
+
+    /* Accuracy and latency over a labelled list instead of the pipeline */
+    if (!list.empty()) {
+        vector<BenchImage> samples;
+        if (!LoadBenchList(list, samples) || samples.empty()) {
+            cerr << "\nError: Not images exist in " << list << endl;
+            return;
+        }
+
+        bench.model = "inception_v1";
+        bench.dir = path;
+        bench.input_size = inputSize;
+        bench.channel = channel;
+        bench.threads = threadnum;
+        bench.cache = cache.empty() ? nullptr : &tensorCache;
+
+        ClassifyBench classifyBench(bench);
+        classifyBench.Run(samples, infer);
+        classifyBench.Report();
+        return;
+    }
+
+    pipeline.Run(path, images, count, infer,
+        [&](ClassifyJob &job) {
+            if (argmax) {
+                _T(ClassifyArgmax(job.logits.data(), channel));
+            } else {
+                _T(ClassifyTopK(job.logits.data(), channel, job.scale, 5, top5));
+            }
+        });
+
+    pipeline.Report();
+}
+
+/**
+ * @brief Print usage of the sample
+ *
+ */
+void usage(const char *name) {
+    cout << "Usage: " << name << " [-d image_dir] [-n count] [-q depth] [-c cache] [-m mean] [-a] [-p]" << endl;
+    cout << "       [-b list [-w warmup] [-s seconds] [-o report] [-r record]] thread_num" << endl;
+    cout << "\t-d image_dir: run the decode/preprocess/DPU/postprocess pipeline" << endl;
+    cout << "\t              over the images, e.g. ../common/image500_640_480/" << endl;
+    cout << "\t-n count: number of images for the pipeline (default: each image once)" << endl;
+    cout << "\t-q depth: capacity of the queues between stages (default: 8)" << endl;
+    cout << "\t-c cache: take preprocessed input Tensors from a cache file built by" << endl;
+    cout << "\t          common/tools/tensor_cache_build" << endl;
+    cout << "\t-m mean: B,G,R mean of the Kernel, the one given to tensor_cache_build" << endl;
+    cout << "\t         (default: 104,117,123)" << endl;
+    cout << "\t-b list: benchmark top-1/top-5 accuracy, throughput and latency over a" << endl;
+    cout << "\t         list of \"name label\" lines, images are read from -d image_dir" << endl;
+    cout << "\t-w warmup: images run before measuring the benchmark (default: 10)" << endl;
+    cout << "\t-s seconds: measure the benchmark for a fixed duration instead of -n count" << endl;
+    cout << "\t-o report: write the benchmark results to a .json file or append them" << endl;
+    cout << "\t           to a .csv file" << endl;
+    cout << "\t-r record: record the logits of each image, for common/tools/classify_replay" << endl;
+    cout << "\t-a: argmax only, skip the softmax normalization" << endl;
+    cout << "\t-p: pin each DPU worker thread to its own CPU" << endl;
+}
+
 /**
  * @brief Entry for running GoogLeNet neural network
  *
  */
 int main(int argc ,char** argv) {
-    if(argc == 2)
-    threadnum = stoi(argv[1]);
-    else {
-    cerr << "please input thread number!" <<  endl;
-    exit(-1);
+    string imagePath;
+    string cache;
+    string list;
+    BenchConfig bench;
+    int count = 0;
+    int depth = 8;
+    bool argmax = false;
+    bool pin = false;
+    int opt;
+
+    /* Dump the per-stage latency histograms at exit and on SIGUSR1 */
+    InstallStageDump();
+
+    while ((opt = getopt(argc, argv, "d:n:q:c:m:b:w:s:o:r:ap")) != -1) {
+        switch (opt) {
+        case 'd':
+            imagePath = optarg;
+            break;
+        case 'n':
+            count = stoi(optarg);
+            break;
+        case 'q':
+            depth = stoi(optarg);
+            break;
+        case 'c':
+            cache = optarg;
+            break;
+        case 'm':
+            if (sscanf(optarg, "%f,%f,%f", &cacheMean[0], &cacheMean[1], &cacheMean[2]) != 3) {
+                usage(argv[0]);
+                exit(-1);
+            }
+            break;
+        case 'b':
+            list = optarg;
+            break;
+        case 'w':
+            bench.warmup = stoi(optarg);
+            break;
+        case 's':
+            bench.duration = stod(optarg);
+            break;
+        case 'o':
+            bench.output = optarg;
+            break;
+        case 'r':
+            bench.record = optarg;
+            break;
+        case 'a':
+            argmax = true;
+            break;
+        case 'p':
+            pin = true;
+            break;
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    bench.count = count;
+
+    if (optind == argc - 1) {
+        threadnum = stoi(argv[optind]);
+    } else {
+        cerr << "please input thread number!" << endl;
+        usage(argv[0]);
+        exit(-1);
     }
     /* DPU Kernels for running GoogLeNet */
     DPUKernel *kernelGoogLeNet;
@@ -319,7 +490,11 @@ int main(int argc ,char** argv) {
     kernelGoogLeNet = dpuLoadKernel(KRENEL_GoogLeNet);
 
     /* Entry of classify GoogLeNet */
-    classifyEntry(kernelGoogLeNet);
+    if (imagePath.empty()) {
+        classifyEntry(kernelGoogLeNet, pin);
+    } else {
+        pipelineEntry(kernelGoogLeNet, imagePath, count, depth, argmax, pin, cache, list, bench);
+    }
 
     /* Destroy DPU Tasks & free resources */
     dpuDestroyKernel(kernelGoogLeNet);
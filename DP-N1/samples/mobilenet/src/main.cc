@@ -68,8 +68,12 @@
 /* header file for DNNDK APIs */
 #include <dnndk/dnndk.h>
 
+#include "classify_result.h"
+#include "input_quantize.h"
+
 using namespace std;
 using namespace cv;
+using namespace deephi;
 
 /* 0.56 GOP MAdds for MobileNet */
 #define MOBILENET_WORKLOAD (0.56f)
@@ -148,55 +152,6 @@ void LoadWords(string const &path, vector<string> &kinds) {
     fkinds.close();
 }
 
-/**
- * @brief calculate softmax
- *
- * @param data - pointer to input buffer
- * @param size - size of input buffer
- * @param result - calculation result
- *
- * @return none
- */
-void CPUCalcSoftmax(const float *data, size_t size, float *result) {
-    assert(data && result);
-    double sum = 0.0f;
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] = exp(data[i]);
-        sum += result[i];
-    }
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] /= sum;
-    }
-}
-
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("top[%d] prob = %-8f  name = %s\n", i, d[ki.second],
-        vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Run DPU Task for MobileNet
  *
@@ -225,15 +180,24 @@ void runMobilenet(DPUTask *taskMobilenet) {
 
     /* Get channel count of the output Tensor for MobileNet Task  */
     int channel = dpuGetOutputTensorChannel(taskMobilenet, OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult top5;
+
+    /* Input Tensor, resolved once for all images */
+    TensorHandle input;
+    if (!ResolveTensor(taskMobilenet, CONV_INPUT_NODE, 0, true, &input)) {
+        cerr << "\nError: Fail to resolve the input Tensor of Node " << CONV_INPUT_NODE << "." << endl;
+        return;
+    }
     for (auto &imageName : images) {
         cout << "\nLoad image : " << imageName << endl;
         /* Load image and Set image into DPU Task for MobileNet */
         Mat image = imread(baseImagePath + imageName);
         vector<float> mean{104, 117, 123};
         float scale = 0.00390625;
-        dpuSetInputImageWithScale(taskMobilenet, CONV_INPUT_NODE, image, mean.data(), scale);
+        if (!SetInputImageFused(input, image, mean.data(), scale)) {
+            cerr << "\nError: Fail to set image " << imageName << " into the input Tensor." << endl;
+            continue;
+        }
 
         /* Launch RetNet50 Task */
         cout << "\nRun DPU Task for MobileNet ..." << endl;
@@ -245,20 +209,16 @@ void runMobilenet(DPUTask *taskMobilenet) {
         float prof = (MOBILENET_WORKLOAD / timeProf) * 1000000.0f;
         cout << "  DPU Task Performance: " << prof << "GOPS\n";
 
-        /* Get FC result and convert from INT8 to FP32 format */
-        dpuGetOutputTensorInHWCFP32(taskMobilenet, OUTPUT_NODE, FCResult, channel);
-
-        /* Calculate softmax on CPU and display TOP-5 classification results */
-        CPUCalcSoftmax(FCResult, channel, softmax);
-        TopK(softmax, channel, 5, kinds);
+        /* Select TOP-5 on the INT8 FC result and display the classification results */
+        int8_t *outAddr = dpuGetOutputTensorAddress(taskMobilenet, OUTPUT_NODE);
+        float outScale = dpuGetOutputTensorScale(taskMobilenet, OUTPUT_NODE);
+        ClassifyTopK(outAddr, channel, outScale, 5, top5);
+        PrintClassifyResult(top5, kinds);
 
         /* Display the impage */
         cv::imshow("Classification of MobileNet", image);
         cv::waitKey(1);
     }
-
-    delete[] softmax;
-    delete[] FCResult;
 }
 
 /**
@@ -48,6 +48,7 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <fstream>
@@ -62,9 +63,14 @@
 // Header files for DNNDK APIs
 #include <dnndk/dnndk.h>
 
+#include "frame_source.h"
+#include "reorder_buffer.h"
+#include "task_pool.h"
+
 using namespace std;
 using namespace std::chrono;
 using namespace cv;
+using namespace deephi;
 
 // constant for segmentation network
 #define KERNEL_CONV "segmentation"
@@ -78,69 +84,43 @@ uint8_t colorG[] = {64, 35, 70, 102, 153, 153, 170, 220, 142, 251,
 uint8_t colorR[] = {128, 244, 70,  102, 190, 153, 250, 220, 107, 152,
                     70,  220, 255, 0,   0,   0,   0,   0,   119};
 
-// comparison algorithm for priority_queue
-class Compare {
-    public:
-    bool operator()(const pair<int, Mat> &n1, const pair<int, Mat> &n2) const {
-        return n1.first > n2.first;
-    }
-};
-
-// input video
-VideoCapture video;
+// segmentation threads
+#define THREAD_NUM 2
 
-// flags for each thread
-bool is_reading = true;
-bool is_running_1 = true;
-bool is_running_2 = true;
-bool is_displaying = true;
-
-queue<pair<int, Mat>> read_queue;                                               // read queue
-priority_queue<pair<int, Mat>, vector<pair<int, Mat>>, Compare> display_queue;  // display queue
-mutex mtx_read_queue;                                                           // mutex of read queue
-mutex mtx_display_queue;                                                        // mutex of display queue
-int read_index = 0;                                                             // frame index of input video
-int display_index = 0;                                                          // frame index to display
+FrameSource video(2, 30);                                    // input video, decoded 30 frames ahead
+ReorderBuffer<Mat> display_queue(30 + THREAD_NUM);           // display queue, in frame order
+atomic<int> running_num(THREAD_NUM);                         // segmentation threads still running
 
 /**
  * @brief entry routine of segmentation, and put image into display queue
  *
- * @param task - pointer to Segmentation Task
- * @param is_running - status flag of the thread
+ * @param pool - pool of the Segmentation Tasks
+ * @param kernel - Segmentation Kernel
  *
  * @return none
  */
-void runSegmentation(DPUTask *task, bool &is_running) {
-    // initialize the task's parameters
-    DPUTensor *conv_in_tensor = dpuGetInputTensor(task, CONV_INPUT_NODE);
-    int inHeight = dpuGetTensorHeight(conv_in_tensor);
-    int inWidth = dpuGetTensorWidth(conv_in_tensor);
+void runSegmentation(TaskPool &pool, DPUKernel *kernel) {
+    // initialize the task's parameters, the same for every Task of the Kernel
+    int inHeight, inWidth, outHeight, outWidth;
+    {
+        TaskLease task(pool, kernel);
+        DPUTensor *conv_in_tensor = dpuGetInputTensor(task, CONV_INPUT_NODE);
+        inHeight = dpuGetTensorHeight(conv_in_tensor);
+        inWidth = dpuGetTensorWidth(conv_in_tensor);
+
+        DPUTensor *conv_out_tensor = dpuGetOutputTensor(task, CONV_OUTPUT_NODE);
+        outHeight = dpuGetTensorHeight(conv_out_tensor);
+        outWidth = dpuGetTensorWidth(conv_out_tensor);
+    }
 
-    DPUTensor *conv_out_tensor = dpuGetOutputTensor(task, CONV_OUTPUT_NODE);
-    int outHeight = dpuGetTensorHeight(conv_out_tensor);
-    int outWidth = dpuGetTensorWidth(conv_out_tensor);
-    int8_t *outTensorAddr = dpuGetTensorAddress(conv_out_tensor);
+    // Run detection for the frames of the video, already at the input size
+    int index;
+    Mat img;
+    while (video.Read(index, img)) {
 
-    // Run detection for images in read queue
-    while (is_running) {
-        // Get an image from read queue
-        int index;
-        Mat img;
-        mtx_read_queue.lock();
-        if (read_queue.empty()) {
-            mtx_read_queue.unlock();
-            if (is_reading) {
-                continue;
-            } else {
-                is_running = false;
-                break;
-            }
-        } else {
-            index = read_queue.front().first;
-            img = read_queue.front().second;
-            read_queue.pop();
-            mtx_read_queue.unlock();
-        }
+        // Any free Task of the pool runs the frame, until its output is read
+        TaskLease task(pool, kernel);
+        int8_t *outTensorAddr = dpuGetOutputTensorAddress(task, CONV_OUTPUT_NODE);
 
         // Set image into CONV Task with mean value
         dpuSetInputImage2(task, (char *)CONV_INPUT_NODE, img);
@@ -165,71 +145,36 @@ void runSegmentation(DPUTask *task, bool &is_running) {
             img.data[i] = img.data[i] * 0.4 + showMat.data[i] * 0.6;
         }
 
-        // Put image into display queue
-        mtx_display_queue.lock();
-        display_queue.push(make_pair(index, img));
-        mtx_display_queue.unlock();
+        // Put image into display queue, closed if the display has quit
+        if (!display_queue.Put(index, img)) {
+            break;
+        }
     }
-}
 
-/**
- * @brief Read frames into read queue from a video
- *
- * @param is_reading - status flag of Read thread
- *
- * @return none
- */
-void Read(bool &is_reading) {
-    while (is_reading) {
-        Mat img;
-        if (read_queue.size() < 30) {
-            if (!video.read(img)) {
-                cout << "Finish reading the video." << endl;
-                is_reading = false;
-                break;
-            }
-            mtx_read_queue.lock();
-            read_queue.push(make_pair(read_index++, img));
-            mtx_read_queue.unlock();
-        } else {
-            usleep(20);
-        }
+    // The last thread ends the display
+    if (--running_num == 0) {
+        display_queue.Close();
     }
 }
 
 /**
  * @brief Display frames in display queue
  *
- * @param is_displaying - status flag of Display thread
- *
  * @return none
  */
-void Display(bool &is_displaying) {
-    while (is_displaying) {
-        mtx_display_queue.lock();
-        if (display_queue.empty()) {
-            if (is_running_1 || is_running_2) {
-                mtx_display_queue.unlock();
-                usleep(20);
-            } else {
-                is_displaying = false;
-                break;
-            }
-        } else if (display_index == display_queue.top().first) {
-            // Display image
-            imshow("Segmentaion @Deephi DPU", display_queue.top().second);
-            display_index++;
-            display_queue.pop();
-            mtx_display_queue.unlock();
-            if (waitKey(1) == 'q') {
-                is_reading = false;
-                is_running_1 = false;
-                is_running_2 = false;
-                is_displaying = false;
-                break;
-            }
-        } else {
-            mtx_display_queue.unlock();
+void Display() {
+    // frames in frame order, as soon as the next one is done
+    long index;
+    Mat img;
+
+    while (display_queue.Next(index, img)) {
+        // Display image
+        imshow("Segmentaion @Deephi DPU", img);
+        if (waitKey(1) == 'q') {
+            // Stop the decoder and the segmentation threads
+            video.Close();
+            display_queue.Close();
+            return;
         }
     }
 }
@@ -243,7 +188,7 @@ void Display(bool &is_displaying) {
 int main(int argc, char **argv) {
     // DPU Kernels/Tasks for running SSD
     DPUKernel *kernel_conv;
-    DPUTask *task_conv_1, *task_conv_2;
+    TaskPool pool;
 
     // Check args
     if (argc != 2) {
@@ -256,36 +201,42 @@ int main(int argc, char **argv) {
     dpuOpen();
     // Create DPU Kernels and Tasks for CONV Nodes in SSD
     kernel_conv = dpuLoadKernel(KERNEL_CONV);
-    task_conv_1 = dpuCreateTask(kernel_conv, 0);
-    task_conv_2 = dpuCreateTask(kernel_conv, 0);
+    pool.Add(kernel_conv, THREAD_NUM, THREAD_NUM, KERNEL_CONV);
 
-    // Initializations
+    // Initializations, the frames are decoded and resized to the input of
+    // the network ahead of the segmentation threads
     string file_name = argv[1];
     cout << "Detect video: " << file_name << endl;
-    video.open(file_name);
-    if (!video.isOpened()) {
+    Size inSize;
+    {
+        TaskLease task(pool, kernel_conv);
+        inSize = Size(dpuGetInputTensorWidth(task, CONV_INPUT_NODE),
+                      dpuGetInputTensorHeight(task, CONV_INPUT_NODE));
+    }
+    if (!video.Open(file_name, inSize)) {
         cout << "Failed to open video: " << file_name;
         return -1;
     }
 
     // Run tasks for SSD
-    array<thread, 4> threads = {thread(Read, ref(is_reading)),
-                                thread(runSegmentation, task_conv_1, ref(is_running_1)),
-                                thread(runSegmentation, task_conv_2, ref(is_running_2)),
-                                thread(Display, ref(is_displaying))};
+    array<thread, 3> threads = {thread(runSegmentation, ref(pool), kernel_conv),
+                                thread(runSegmentation, ref(pool), kernel_conv),
+                                thread(Display)};
 
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < 3; ++i) {
         threads[i].join();
     }
 
     // Destroy DPU Tasks and Kernels and free resources
-    dpuDestroyTask(task_conv_1);
-    dpuDestroyTask(task_conv_2);
+    video.Report();
+    display_queue.Report("display");
+    pool.Report();
+    pool.Release();
     dpuDestroyKernel(kernel_conv);
     // Detach from DPU driver and release resources
     dpuClose();
 
-    video.release();
+    video.Close();
 
     return 0;
 }
@@ -46,6 +46,7 @@
 -- PART OF THIS FILE AT ALL TIMES.
 */
 
+#include <getopt.h>
 #include <math.h>
 #include <signal.h>
 #include <unistd.h>
@@ -70,6 +71,14 @@
 // Header files for DNNDK API
 #include <dnndk/dnndk.h>
 
+#include "bounded_queue.h"
+#include "detections.h"
+#include "frame_admission.h"
+#include "nms.h"
+#include "reorder_buffer.h"
+#include "task_pool.h"
+#include "tensor_handle.h"
+
 // DPU input & output Node name for DenseBox
 #define NODE_INPUT "L0"
 #define NODE_CONV "pixel_conv"
@@ -79,74 +88,19 @@
 #define CONFIDENCE_THRESHOLD (0.65)
 #define IOU_THRESHOLD (0.3)
 
+// Images the input queue holds at most
+#define INPUT_QUEUE_SIZE (100)
+
+// Slots of the DenseBox Tensors in TaskTensors
+enum { TENSOR_INPUT, TENSOR_CONV, TENSOR_OUTPUT };
+
 using namespace std;
 using namespace std::chrono;
 using namespace cv;
+using namespace deephi;
 
 typedef pair<int, Mat> pairImage;
 
-class PairComp {  // An auxiliary class for sort the image pair according to its
-                  // index
-    public:
-    bool operator()(const pairImage &n1, const pairImage &n2) const {
-        if (n1.first == n2.first) return n1.first > n2.first;
-        return n1.first > n2.first;
-    }
-};
-
-/**
- * @brief NMS - Discard overlapping boxes using NMS
- *
- * @param box - input box vector
- * @param nms - IOU threshold
- *
- * @ret - output box vector after discarding overlapping boxes
- */
-vector<vector<float>> NMS(const vector<vector<float>> &box, float nms) {
-    size_t count = box.size();
-    vector<pair<size_t, float>> order(count);
-    for (size_t i = 0; i < count; ++i) {
-        order[i].first = i;
-        order[i].second = box[i][4];
-    }
-
-    sort(order.begin(), order.end(), [](const pair<int, float> &ls, const pair<int, float> &rs) {
-        return ls.second > rs.second;
-    });
-
-    vector<int> keep;
-    vector<bool> exist_box(count, true);
-    for (size_t _i = 0; _i < count; ++_i) {
-        size_t i = order[_i].first;
-        float x1, y1, x2, y2, w, h, iarea, jarea, inter, ovr;
-        if (!exist_box[i]) continue;
-        keep.push_back(i);
-        for (size_t _j = _i + 1; _j < count; ++_j) {
-            size_t j = order[_j].first;
-            if (!exist_box[j]) continue;
-            x1 = max(box[i][0], box[j][0]);
-            y1 = max(box[i][1], box[j][1]);
-            x2 = min(box[i][2], box[j][2]);
-            y2 = min(box[i][3], box[j][3]);
-            w = max(float(0.0), x2 - x1 + 1);
-            h = max(float(0.0), y2 - y1 + 1);
-            iarea = (box[i][2] - box[i][0] + 1) * (box[i][3] - box[i][1] + 1);
-            jarea = (box[j][2] - box[j][0] + 1) * (box[j][3] - box[j][1] + 1);
-            inter = w * h;
-            ovr = inter / (iarea + jarea - inter);
-            if (ovr >= nms) exist_box[j] = false;
-        }
-    }
-
-    vector<vector<float>> result;
-    result.reserve(keep.size());
-    for (size_t i = 0; i < keep.size(); ++i) {
-        result.push_back(box[keep[i]]);
-    }
-
-    return result;
-}
-
 /**
  * @brief softmax_2 - 2-class softmax calculation
  *
@@ -172,14 +126,18 @@ void softmax_2(const vector<float> &input, vector<float> &output) {
  * @brief runDenseBox - Run DPU Task for Densebox
  *
  * @param task - pointer to a DPU Task
+ * @param tensors - Tensors of the Task, indexed by TENSOR_INPUT etc.
  * @param img  - input image in OpenCV's Mat format
+ * @param boxes - candidate boxes, reused by the worker for every image
+ * @param res - boxes kept by NMS, reused by the worker for every image
+ * @param nms - NMS engine of the worker
  *
  * @return none
  */
-void runDenseBox(DPUTask *task, Mat &img) {
-    DPUTensor *conv_in_tensor = dpuGetInputTensor(task, NODE_INPUT);
-    int inHeight = dpuGetTensorHeight(conv_in_tensor);
-    int inWidth = dpuGetTensorWidth(conv_in_tensor);
+void runDenseBox(DPUTask *task, const TensorHandle *tensors, Mat &img, Detections &boxes,
+                 Detections &res, NmsEngine &nms) {
+    int inHeight = tensors[TENSOR_INPUT].height;
+    int inWidth = tensors[TENSOR_INPUT].width;
 
     float scale_w = (float)img.cols / (float)inWidth;
     float scale_h = (float)img.rows / (float)inHeight;
@@ -188,49 +146,43 @@ void runDenseBox(DPUTask *task, Mat &img) {
 
     dpuRunTask(task);
 
-    DPUTensor *conv_out_tensor = dpuGetOutputTensor(task, NODE_CONV);
-    int tensorSize = dpuGetTensorSize(conv_out_tensor);
-    DPUTensor *conv_out_tensor_2 = dpuGetOutputTensor(task, NODE_OUTPUT);
-    int tensorSize_2 = dpuGetTensorSize(conv_out_tensor_2);
-    int outHeight_2 = dpuGetTensorHeight(conv_out_tensor_2);
-    int outWidth_2 = dpuGetTensorWidth(conv_out_tensor_2);
+    int tensorSize = tensors[TENSOR_CONV].size;
+    int tensorSize_2 = tensors[TENSOR_OUTPUT].size;
+    int outHeight_2 = tensors[TENSOR_OUTPUT].height;
+    int outWidth_2 = tensors[TENSOR_OUTPUT].width;
     vector<float> pixel(tensorSize);
     vector<float> conf(tensorSize);
     vector<float> bb(tensorSize_2);
 
     //output data format convert
-    dpuGetOutputTensorInHWCFP32(task, NODE_CONV, pixel.data(), tensorSize);
-    dpuGetOutputTensorInHWCFP32(task, NODE_OUTPUT, bb.data(), tensorSize_2);
+    TensorToFloat(tensors[TENSOR_CONV], pixel.data());
+    TensorToFloat(tensors[TENSOR_OUTPUT], bb.data());
 
     //2-classes softmax
     softmax_2(pixel, conf);
 
     // get original face boxes
-    vector<vector<float>> boxes;
+    boxes.clear();
     for (int i = 0; i < outHeight_2; i++) {
         for (int j = 0; j < outWidth_2; j++) {
             int position = i * outWidth_2 + j;
-            vector<float> box;
             if (conf[position * 2 + 1] > 0.55) {
-                box.push_back(bb[position * 4 + 0] + j * 4);
-                box.push_back(bb[position * 4 + 1] + i * 4);
-                box.push_back(bb[position * 4 + 2] + j * 4);
-                box.push_back(bb[position * 4 + 3] + i * 4);
-                box.push_back(conf[position * 2 + 1]);
-                boxes.push_back(box);
+                boxes.Add(bb[position * 4 + 0] + j * 4, bb[position * 4 + 1] + i * 4,
+                          bb[position * 4 + 2] + j * 4, bb[position * 4 + 3] + i * 4,
+                          conf[position * 2 + 1]);
             }
         }
     }
 
-    // Discard overlapping boxes using NMS
-    vector<vector<float>> res = NMS(boxes, 0.35);
+    // Discard overlapping boxes using NMS, no score limit beyond the 0.55 above
+    nms.Run(boxes, 0.35, 0.0f, res);
 
     // Draw detected face boxes to image
     for (size_t i = 0; i < res.size(); ++i) {
-        float xmin = std::max(res[i][0] * scale_w, 0.0f);
-        float ymin = std::max(res[i][1] * scale_h, 0.0f);
-        float xmax = std::min(res[i][2] * scale_w, (float)img.cols);
-        float ymax = std::min(res[i][3] * scale_h, (float)img.rows);
+        float xmin = std::max(res.coord(0)[i] * scale_w, 0.0f);
+        float ymin = std::max(res.coord(1)[i] * scale_h, 0.0f);
+        float xmax = std::min(res.coord(2)[i] * scale_w, (float)img.cols);
+        float ymax = std::min(res.coord(3)[i] * scale_h, (float)img.rows);
 
         rectangle(img, Point(xmin, ymin), Point(xmax, ymax), Scalar(0, 255, 0), 1, 1, 0);
     }
@@ -240,14 +192,16 @@ void runDenseBox(DPUTask *task, Mat &img) {
  * @brief faceDetection - Entry of face detection using Densebox
  *
  * @param kernel - point to DPU Kernel
+ * @param maxAge - latency budget in ms from capture to display, images that
+ *                 cannot meet it are dropped; 0 to process every image
  *
  * @return none
  */
-void faceDetection(DPUKernel *kernel) {
-    mutex mtxQueueInput;                                               // mutex of input queue
-    mutex mtxQueueShow;                                                // mutex of display queue
-    queue<pairImage> queueInput;                                       // input queue
-    priority_queue<pairImage, vector<pairImage>, PairComp> queueShow;  // display queue
+void faceDetection(DPUKernel *kernel, int maxAge) {
+    constexpr int workerNum = 2;
+    BoundedQueue<pairImage> queueInput(INPUT_QUEUE_SIZE);             // input queue
+    ReorderBuffer<Mat> queueShow(INPUT_QUEUE_SIZE + workerNum);       // display queue, in frame order
+    FrameAdmission admission(maxAge);                                 // capture stamps
 
     VideoCapture camera(0);
     if (!camera.isOpened()) {
@@ -267,7 +221,6 @@ void faceDetection(DPUKernel *kernel) {
     // 3. Display thread : Get output image from queueShow and display it.
 
     // 1. Reader thread
-    atomic<bool> bReading(true);
     thread reader([&]() {
         // image index of input video
         int idxInputImage = 0;
@@ -279,87 +232,89 @@ void faceDetection(DPUKernel *kernel) {
                 camera.release();
                 break;
             }
-            mtxQueueInput.lock();
-            queueInput.push(make_pair(idxInputImage++, img));
-            if (queueInput.size() >= 100) {
-                mtxQueueInput.unlock();
-                cout << "[Warning]input queue size is " << queueInput.size() << endl;
-                // Sleep for a moment
-                sleep(2);
-            } else {
-                mtxQueueInput.unlock();
+            admission.Capture(idxInputImage);
+            pairImage pairIndexImage = make_pair(idxInputImage++, img);
+            if (admission.enabled()) {
+                if (queueInput.TryPush(pairIndexImage)) {
+                    continue;
+                }
+                // Real-time: the oldest image gives way to the newest
+                pairImage dropped;
+                if (queueInput.TryPop(dropped)) {
+                    admission.Drop();
+                    queueShow.Skip(dropped.first);
+                }
+            }
+            // Wait for the workers, the camera buffers meanwhile; the queue
+            // is closed if the display has quit
+            if (!queueInput.Push(pairIndexImage)) {
+                break;
             }
         }
-        bReading.store(false);
+        queueInput.Close();
     });
 
     // 2. Worker thread
-    constexpr int workerNum = 2;
     thread workers[workerNum];
     atomic<int> workerAlive(workerNum);
+
+    // DPU Tasks are created once and shared by the workers
+    TaskPool pool;
+    pool.Add(kernel, workerNum, workerNum, "densebox");
+
+    // Tensors of each Task are resolved once, on its first image
+    TaskTensors tensors;
+    tensors.AddInput(NODE_INPUT);
+    tensors.AddOutput(NODE_CONV);
+    tensors.AddOutput(NODE_OUTPUT);
+
     for (auto i = 0; i < workerNum; i++) {
         workers[i] = thread([&]() {
-            // Create DPU Tasks from DPU Kernel
-            DPUTask *task = dpuCreateTask(kernel, 0);
-
-            while (true) {
-                pair<int, Mat> pairIndexImage;
-                mtxQueueInput.lock();
-                if (queueInput.empty()) {
-                    mtxQueueInput.unlock();
-                    if (bReading.load())
-                        continue;
-                    else
-                        break;
-                } else {
-                    // Get an image from input queue
-                    pairIndexImage = queueInput.front();
-                    queueInput.pop();
+            // boxes of the images, their memory kept from image to image
+            Detections boxes, res;
+            NmsEngine nms(NmsEngine::CORNERS);
+            // Get images from input queue until it is closed and drained
+            pair<int, Mat> pairIndexImage;
+            while (queueInput.Pop(pairIndexImage)) {
+                // Drop the image if its result would come too late
+                if (!admission.Admit(pairIndexImage.first)) {
+                    if (!queueShow.Skip(pairIndexImage.first)) break;
+                    continue;
                 }
-                mtxQueueInput.unlock();
                 // Process the image using DenseBox model
-                runDenseBox(task, pairIndexImage.second);
-                mtxQueueShow.lock();
-                // Put the processed iamge to show queue
-                queueShow.push(pairIndexImage);
-                mtxQueueShow.unlock();
+                {
+                    TaskLease task(pool, kernel);
+                    const TensorHandle *handles = tensors.Get(task);
+                    if (!handles) exit(-1);
+                    runDenseBox(task, handles, pairIndexImage.second, boxes, res, nms);
+                }
+                // Put the processed iamge to show queue, closed if the
+                // display has quit
+                if (!queueShow.Put(pairIndexImage.first, pairIndexImage.second)) break;
             }
 
-            // Destroy DPU Tasks & free resources
-            dpuDestroyTask(task);
-
-            workerAlive--;
+            // The last worker ends the display
+            if (--workerAlive == 0) queueShow.Close();
         });
     }
 
     // 3. Display thread;
-    atomic<int> idxShowImage(0);  // next frame index to be display
     thread show([&]() {
-        while (true) {
-            mtxQueueShow.lock();
-            if (queueShow.empty()) {  // no image in display queue
-                mtxQueueShow.unlock();
-                if (workerAlive.load() == 0) {
-                    cout << "Face Detection End." << endl;
-                    break;
-                } else {
-                    usleep(10000);  // Sleep for a moment
-                }
-            } else if (idxShowImage.load() == queueShow.top().first) {
-                cv::imshow("Face Detection @Deephi DPU",
-                           queueShow.top().second);  // Display image
-                idxShowImage++;
-                queueShow.pop();
-                mtxQueueShow.unlock();
-                if (waitKey(1) == 'q') {
-                    bReading = false;
-                    exit(0);
-                }
-
-            } else {
-                mtxQueueShow.unlock();
+        // images in frame order as soon as the next one is done, the
+        // dropped ones passed over
+        long idxShowImage;
+        Mat img;
+        while (queueShow.Next(idxShowImage, img)) {
+            admission.Shown(idxShowImage);
+            cv::imshow("Face Detection @Deephi DPU", img);  // Display image
+            if (waitKey(1) == 'q') {
+                // Stop the reader and the workers
+                queueInput.Close();
+                queueShow.Close();
+                return;
             }
         }
+        cout << "Face Detection End." << endl;
     });
 
     // Release thread resources.
@@ -368,6 +323,12 @@ void faceDetection(DPUKernel *kernel) {
     for (auto &w : workers) {
         if (w.joinable()) w.join();
     }
+
+    // Destroy DPU Tasks & free resources
+    admission.Report();
+    queueShow.Report("display");
+    pool.Report();
+    pool.Release();
 }
 
 /*
@@ -377,7 +338,22 @@ void faceDetection(DPUKernel *kernel) {
  *       on DPU using DenseBox model.
  *
  */
-int main(void) {
+int main(int argc, char **argv) {
+    int maxAge = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:")) != -1) {
+        switch (opt) {
+        case 'a':
+            maxAge = atoi(optarg);
+            break;
+        default:
+            cout << "Usage of face detection: ./face_detection [-a max_age_ms]" << endl;
+            cout << "  -a  real-time mode: drop the images that cannot be shown within" << endl;
+            cout << "      max_age_ms of their capture, and report the latency" << endl;
+            return -1;
+        }
+    }
+
     // Attach to DPU driver and prepare for running
     dpuOpen();
 
@@ -385,7 +361,7 @@ int main(void) {
     DPUKernel *kernel = dpuLoadKernel("densebox");
 
     // Doing face detection.
-    faceDetection(kernel);
+    faceDetection(kernel, maxAge);
 
     // Destroy DPU Kernel & free resources
     dpuDestroyKernel(kernel);
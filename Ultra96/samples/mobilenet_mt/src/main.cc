@@ -48,6 +48,7 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <atomic>
@@ -57,9 +58,11 @@
 #include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <string>
@@ -73,9 +76,19 @@
 /* header file OpenCV for image processing */
 #include <opencv2/opencv.hpp>
 
+#include "classify_bench.h"
+#include "classify_cascade.h"
+#include "classify_pipeline.h"
+#include "classify_result.h"
+#include "input_quantize.h"
+#include "stage_timer.h"
+#include "tensor_cache.h"
+#include "worker_context.h"
+
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
+using namespace deephi;
 
 int threadnum;
 
@@ -86,26 +99,23 @@ int threadnum;
 /* Output Node for Kernel MobileNet */
 #define OUTPUT_NODE "fc7"
 
+/* DPU Kernel name for ResNet50, run on the images MobileNet is unsure of */
+#define KRENEL_RESNET50 "resnet50_0"
+/* Input Node for Kernel ResNet50 */
+#define RESNET50_INPUT_NODE "conv1"
+/* Output Node for Kernel ResNet50 */
+#define RESNET50_OUTPUT_NODE "fc1000"
+
 #define IMAGE_COUNT 1000
 
 const string baseImagePath = "./image/";
 
-/*#define SHOWTIME*/
-#ifdef SHOWTIME
-#define _T(func)                                                          \
-{                                                                         \
-    auto _start = system_clock::now();                                    \
-    func;                                                                 \
-    auto _end = system_clock::now();                                      \
-    auto duration = (duration_cast<microseconds>(_end - _start)).count(); \
-    string tmp = #func;                                                   \
-    tmp = tmp.substr(0, tmp.find('('));                                   \
-    cout << "[TimeTest]" << left << setw(30) << tmp;                      \
-    cout << left << setw(10) << duration << "us" << endl;                 \
-}
-#else
-#define _T(func) func;
-#endif
+/* Input Tensor of every MobileNet Task, resolved on the Task's first image */
+TaskTensors inputTensors;
+
+/* Time every _T() call into per-stage latency histograms, dumped at exit
+   and on SIGUSR1 */
+#define _T(func) STAGE_TIME(func)
 
 /**
  * @brief put image names to a vector
@@ -172,91 +182,42 @@ void LoadWords(string const &path, vector<string> &kinds) {
     fkinds.close();
 }
 
-/**
- * @brief calculate softmax
- *
- * @param data - pointer to input buffer
- * @param size - size of input buffer
- * @param result - calculation result
- *
- * @return none
- */
-void CPUCalcSoftmax(const float *data, size_t size, float *result) {
-    assert(data && result);
-    double sum = 0.0f;
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] = exp(data[i]);
-        sum += result[i];
-    }
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] /= sum;
-    }
-}
-
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("[Top]%d prob = %-8f  name = %s\n", i, d[ki.second], vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Run DPU Task for MobileNet
  *
- * @param taskMobilenet - pointer to MobileNet Task
- * @param img - The mat to be process
+ * @param ctx - context of the worker, owning its DPU Tasks
+ * @param img - input image
  *
  * @return none
  */
-void runMobilenet(DPUTask *taskMobilenet, Mat &img) {
-    assert(taskMobilenet);
+void runMobilenet(WorkerContext &ctx, Mat &img) {
+    DPUTask *taskMobilenet = ctx.task(0);
 
     /* Get channel count of the output Tensor for MobileNet Task  */
     int channel = dpuGetOutputTensorChannel(taskMobilenet, OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult &top5 = ctx.result();
 
-    vector<float> mean{104, 117, 123};
-    float scale = 0.00390625;
-    dpuSetInputImageWithScale(taskMobilenet, CONV_INPUT_NODE, img, mean.data(), scale);
+    /* Mean value and scale of MobileNet, not rebuilt for every image */
+    static float mean[3] = {104, 117, 123};
+    static const float scale = 0.00390625;
+    _T(SetInputImageFused(*inputTensors.Get(taskMobilenet), img, mean, scale));
 
     /* Launch RetNet50 Task */
     _T(dpuRunTask(taskMobilenet));
 
-    /* Calculate softmax on CPU and display TOP-5 classification results */
-    _T(dpuGetOutputTensorInHWCFP32(taskMobilenet, OUTPUT_NODE, FCResult, channel));
-    _T(CPUCalcSoftmax(FCResult, channel, softmax));
-
-    delete[] softmax;
-    delete[] FCResult;
+    /* Select TOP-5 on the INT8 output */
+    int8_t *outAddr = dpuGetOutputTensorAddress(taskMobilenet, OUTPUT_NODE);
+    float outScale = dpuGetOutputTensorScale(taskMobilenet, OUTPUT_NODE);
+    _T(ClassifyTopK(outAddr, channel, outScale, 5, top5));
 }
 
 /*
  * @brief  - Entry of classify using Mobilenet
  *
  * @param kernelMobilenet - point to DPU Kernel of Mobilenet
+ * @param pin - pin each worker thread to its own CPU
  */
-void classifyEntry(DPUKernel *kernelMobilenet) {
+void classifyEntry(DPUKernel *kernelMobilenet, bool pin) {
     vector<string> kinds, images;
     ListImages(baseImagePath, images);
     if (images.size() == 0) {
@@ -280,16 +241,14 @@ void classifyEntry(DPUKernel *kernelMobilenet) {
 
     for (auto i = 0; i < threadnum; i++) {
         workers[i] = thread([&,i]() {
-            /* Create DPU Tasks from DPU Kernel */
-            DPUTask *taskMobilenet = dpuCreateTask(kernelMobilenet, 0);
+            /* Create the context owning the DPU Tasks of this worker */
+            WorkerContext ctx(i, {kernelMobilenet}, pin ? i : -1);
+            ctx.Attach();
 
             for(unsigned int ind = i  ;ind < IMAGE_COUNT;ind+=threadnum) {
                 /* Run MobileNet Task */
-                runMobilenet(taskMobilenet, img);
+                runMobilenet(ctx, img);
             }
-
-            /* Destroy DPU Tasks & free resources */
-            dpuDestroyTask(taskMobilenet);
         });
     }
 
@@ -305,6 +264,186 @@ void classifyEntry(DPUKernel *kernelMobilenet) {
     cout << "[FPS]" << IMAGE_COUNT*1000000.0/duration  << endl;
 }
 
+/**
+ * @brief  - Entry of the staged classification pipeline over an image directory
+ *
+ * @param kernelMobilenet - point to DPU Kernel
+ * @param kernelResnet50 - point to DPU Kernel of ResNet50 for the cascade,
+ *                         or nullptr
+ * @param cascade - escalation of the images to ResNet50, or nullptr
+ * @param path - directory of the images
+ * @param count - number of images to classify, 0 for each image once
+ * @param depth - capacity of the queues between two stages
+ * @param argmax - only pick the most probable class, without softmax
+ * @param pin - pin each DPU worker thread to its own CPU
+ * @param cache - Tensor cache file of the preprocessed images, empty to
+ *                decode every image
+ * @param list - labelled image list to benchmark, empty to run the pipeline
+ * @param bench - warmup, count, duration and outputs of the benchmark
+ *
+ * @return none
+ */
+void pipelineEntry(DPUKernel *kernelMobilenet, DPUKernel *kernelResnet50,
+                   ClassifyCascade *cascade, string path,
+                   int count, int depth, bool argmax, bool pin, string cache,
+                   string list, BenchConfig bench) {
+    vector<string> kinds, images;
+    if (path.back() != '/') {
+        path += '/';
+    }
+
+    ListImages(path, images);
+    if (images.size() == 0) {
+        cerr << "\nError: Not images exist in " << path << endl;
+        return;
+    }
+
+    /* Load all kinds words.*/
+    LoadWords(path + "words.txt", kinds);
+    if (kinds.size() == 0) {
+        cerr << "\nError: Not words exist in words.txt." << endl;
+        return;
+    }
+
+    if (count <= 0) {
+        count = images.size();
+    }
+    cout << "total image : " << count << endl;
+
+    /* Create the context, owning the DPU Tasks, of each DPU worker */
+    vector<DPUKernel *> kernels{kernelMobilenet};
+    if (cascade) {
+        kernels.push_back(kernelResnet50);
+    }
+    vector<unique_ptr<WorkerContext>> contexts;
+    for (auto i = 0; i < threadnum; i++) {
+        contexts.emplace_back(new WorkerContext(i, kernels, pin ? i : -1));
+    }
+
+    Size inputSize(dpuGetInputTensorWidth(contexts[0]->task(0), CONV_INPUT_NODE),
+                   dpuGetInputTensorHeight(contexts[0]->task(0), CONV_INPUT_NODE));
+    int channel = dpuGetOutputTensorChannel(contexts[0]->task(0), OUTPUT_NODE);
+    ClassifyResult top5;
+    vector<float> mean{104, 117, 123};
+    float scale = 0.00390625;
+
+    ClassifyPipeline pipeline(threadnum, inputSize, depth);
+
+    /* Images in the cache skip decoding and preprocessing */
+    TensorCache tensorCache;
+    if (!cache.empty()) {
+        TensorCacheKey key = {inputSize.width, inputSize.height,
+                              dpuGetInputTensorChannel(contexts[0]->task(0), CONV_INPUT_NODE),
+                              {mean[0], mean[1], mean[2]},
+                              scale * dpuGetInputTensorScale(contexts[0]->task(0), CONV_INPUT_NODE)};
+        if (!tensorCache.Open(cache)) {
+            return;
+        }
+        if (!tensorCache.Matches(key)) {
+            cerr << "\nError: " << cache << " is not built for this input Tensor, rebuild it with" << endl;
+            cerr << "  tensor_cache_build " << path << " " << cache << " " << key.width << " "
+                 << key.height << " " << key.scale << " " << key.mean[0] << " "
+                 << key.mean[1] << " " << key.mean[2] << endl;
+            return;
+        }
+        pipeline.UseCache(&tensorCache);
+    }
+
+    /* DPU stage, shared by the pipeline and the benchmark */
+    ClassifyPipeline::InferFunc infer = [&](int id, ClassifyJob &job) {
+        WorkerContext &ctx = *contexts[id];
+        ctx.Attach();
+
+        if (job.tensor) {
+            _T(memcpy(dpuGetInputTensorAddress(ctx.task(0), CONV_INPUT_NODE), job.tensor,
+                      dpuGetInputTensorSize(ctx.task(0), CONV_INPUT_NODE)));
+        } else {
+            _T(SetInputImageFused(*inputTensors.Get(ctx.task(0)), job.image, mean.data(), scale));
+        }
+        _T(dpuRunTask(ctx.task(0)));
+
+        /* Keep the output so that the Task can take the next image */
+        int8_t *outAddr = dpuGetOutputTensorAddress(ctx.task(0), OUTPUT_NODE);
+        int size = dpuGetOutputTensorSize(ctx.task(0), OUTPUT_NODE);
+        job.scale = dpuGetOutputTensorScale(ctx.task(0), OUTPUT_NODE);
+
+        /* Images MobileNet is unsure of are classified by ResNet50 instead */
+        if (cascade && !job.image.empty() && cascade->Escalate(outAddr, size, job.scale)) {
+            _T(dpuSetInputImage2(ctx.task(1), RESNET50_INPUT_NODE, job.image));
+            _T(dpuRunTask(ctx.task(1)));
+            outAddr = dpuGetOutputTensorAddress(ctx.task(1), RESNET50_OUTPUT_NODE);
+            size = dpuGetOutputTensorSize(ctx.task(1), RESNET50_OUTPUT_NODE);
+            job.scale = dpuGetOutputTensorScale(ctx.task(1), RESNET50_OUTPUT_NODE);
+        }
+        job.logits.assign(outAddr, outAddr + size);
+    };
+
+    /* Accuracy and latency over a labelled list instead of the pipeline */
+    if (!list.empty()) {
+        vector<BenchImage> samples;
+        if (!LoadBenchList(list, samples) || samples.empty()) {
+            cerr << "\nError: Not images exist in " << list << endl;
+            return;
+        }
+
+        bench.model = cascade ? "mobilenet+resnet50" : "mobilenet";
+        bench.dir = path;
+        bench.input_size = inputSize;
+        bench.channel = channel;
+        bench.threads = threadnum;
+        bench.cache = cache.empty() ? nullptr : &tensorCache;
+
+        ClassifyBench classifyBench(bench);
+        classifyBench.Run(samples, infer);
+        classifyBench.Report();
+        if (cascade) {
+            cascade->Report();
+        }
+        return;
+    }
+
+    pipeline.Run(path, images, count, infer,
+        [&](ClassifyJob &job) {
+            if (argmax) {
+                _T(ClassifyArgmax(job.logits.data(), channel));
+            } else {
+                _T(ClassifyTopK(job.logits.data(), channel, job.scale, 5, top5));
+            }
+        });
+
+    pipeline.Report();
+    if (cascade) {
+        cascade->Report();
+    }
+}
+
+/**
+ * @brief Print usage of the sample
+ *
+ */
+void usage(const char *name) {
+    cout << "Usage: " << name << " [-d image_dir] [-n count] [-q depth] [-c cache] [-e margin] [-a] [-p]" << endl;
+    cout << "       [-b list [-w warmup] [-s seconds] [-o report] [-r record]] thread_num" << endl;
+    cout << "\t-d image_dir: run the decode/preprocess/DPU/postprocess pipeline" << endl;
+    cout << "\t              over the images, e.g. ../common/image500_640_480/" << endl;
+    cout << "\t-n count: number of images for the pipeline (default: each image once)" << endl;
+    cout << "\t-q depth: capacity of the queues between stages (default: 8)" << endl;
+    cout << "\t-c cache: take preprocessed input Tensors from a cache file built by" << endl;
+    cout << "\t          common/tools/tensor_cache_build" << endl;
+    cout << "\t-b list: benchmark top-1/top-5 accuracy, throughput and latency over a" << endl;
+    cout << "\t         list of \"name label\" lines, images are read from -d image_dir" << endl;
+    cout << "\t-w warmup: images run before measuring the benchmark (default: 10)" << endl;
+    cout << "\t-s seconds: measure the benchmark for a fixed duration instead of -n count" << endl;
+    cout << "\t-o report: write the benchmark results to a .json file or append them" << endl;
+    cout << "\t           to a .csv file" << endl;
+    cout << "\t-r record: record the logits of each image, for common/tools/classify_replay" << endl;
+    cout << "\t-e margin: cascade, run ResNet50 on the images whose top-1 softmax margin" << endl;
+    cout << "\t           over the top-2 class is below margin, needs -d and a build with" << endl;
+    cout << "\t           make CASCADE=1; see common/tools/cascade_sweep to choose it" << endl;
+    cout << "\t-a: argmax only, skip the softmax normalization" << endl;
+    cout << "\t-p: pin each DPU worker thread to its own CPU" << endl;
+}
+
 /**
  * @brief Entry for running MobileNet neural network
  *
@@ -314,11 +453,80 @@ void classifyEntry(DPUKernel *kernelMobilenet) {
  */
 int main(int argc ,char** argv) {
     DPUKernel *kernelMobilenet;
+    DPUKernel *kernelResnet50 = nullptr;
+
+    string imagePath;
+    string cache;
+    string list;
+    BenchConfig bench;
+    int count = 0;
+    int depth = 8;
+    float margin = -1;
+    bool argmax = false;
+    bool pin = false;
+    int opt;
+
+    /* Dump the per-stage latency histograms at exit and on SIGUSR1 */
+    InstallStageDump();
+
+    while ((opt = getopt(argc, argv, "d:n:q:c:b:w:s:o:r:e:ap")) != -1) {
+        switch (opt) {
+        case 'd':
+            imagePath = optarg;
+            break;
+        case 'n':
+            count = stoi(optarg);
+            break;
+        case 'q':
+            depth = stoi(optarg);
+            break;
+        case 'c':
+            cache = optarg;
+            break;
+        case 'b':
+            list = optarg;
+            break;
+        case 'w':
+            bench.warmup = stoi(optarg);
+            break;
+        case 's':
+            bench.duration = stod(optarg);
+            break;
+        case 'o':
+            bench.output = optarg;
+            break;
+        case 'r':
+            bench.record = optarg;
+            break;
+        case 'e':
+            margin = stof(optarg);
+            break;
+        case 'a':
+            argmax = true;
+            break;
+        case 'p':
+            pin = true;
+            break;
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    bench.count = count;
 
-    if(argc == 2)
-        threadnum = stoi(argv[1]);
-    else {
-        cout << "please input thread number!" << endl;
+    if (optind == argc - 1) {
+        threadnum = stoi(argv[optind]);
+    } else {
+        cerr << "please input thread number!" << endl;
+        usage(argv[0]);
+        exit(-1);
+    }
+
+    /* The cascade needs the decoded images, which cached Tensors skip */
+    if (margin >= 0 && (imagePath.empty() || !cache.empty())) {
+        cerr << "-e margin needs -d image_dir and no -c cache" << endl;
+        usage(argv[0]);
         exit(-1);
     }
 
@@ -327,12 +535,26 @@ int main(int argc ,char** argv) {
 
     /* Create DPU Task for MobileNet */
     kernelMobilenet = dpuLoadKernel(KRENEL_MOBILNET);
+    inputTensors.AddInput(CONV_INPUT_NODE);
+    unique_ptr<ClassifyCascade> cascade;
+    if (margin >= 0) {
+        kernelResnet50 = dpuLoadKernel(KRENEL_RESNET50);
+        cascade.reset(new ClassifyCascade(margin));
+    }
 
     /* Entry of classify using Mobilenet */
-    classifyEntry(kernelMobilenet);
+    if (imagePath.empty()) {
+        classifyEntry(kernelMobilenet, pin);
+    } else {
+        pipelineEntry(kernelMobilenet, kernelResnet50, cascade.get(), imagePath, count, depth,
+                      argmax, pin, cache, list, bench);
+    }
 
     /* Destroy DPU Task & free resources */
     dpuDestroyKernel(kernelMobilenet);
+    if (kernelResnet50) {
+        dpuDestroyKernel(kernelResnet50);
+    }
 
     /* Dettach from DPU driver & free resources */
     dpuClose();
@@ -68,8 +68,11 @@
 /* header file for DNNDK APIs */
 #include <dnndk/dnndk.h>
 
+#include "classify_result.h"
+
 using namespace std;
 using namespace cv;
+using namespace deephi;
 
 /* 7.71 GOP MAdds for ResNet50 */
 #define RESNET50_WORKLOAD (7.71f)
@@ -145,55 +148,6 @@ void LoadWords(string const &path, vector<string> &kinds) {
     fkinds.close();
 }
 
-/**
- * @brief calculate softmax
- *
- * @param data - pointer to input buffer
- * @param size - size of input buffer
- * @param result - calculation result
- *
- * @return none
- */
-void CPUCalcSoftmax(const float *data, size_t size, float *result) {
-    assert(data && result);
-    double sum = 0.0f;
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] = exp(data[i]);
-        sum += result[i];
-    }
-
-    for (size_t i = 0; i < size; i++) {
-        result[i] /= sum;
-    }
-}
-
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("top[%d] prob = %-8f  name = %s\n", i, d[ki.second],
-        vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Run DPU Task for ResNet50
  *
@@ -223,8 +177,7 @@ void runResnet50(DPUTask *taskResnet50) {
 
     /* Get channel count of the output Tensor for ResNet50 Task  */
     int channel = dpuGetOutputTensorChannel(taskResnet50, OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult top5;
 
     for (auto &imageName : images) {
         cout << "\nLoad image : " << imageName << endl;
@@ -242,20 +195,16 @@ void runResnet50(DPUTask *taskResnet50) {
         float prof = (RESNET50_WORKLOAD / timeProf) * 1000000.0f;
         cout << "  DPU Task Performance: " << prof << "GOPS\n";
 
-        /* Get FC result and convert from INT8 to FP32 format */
-        dpuGetOutputTensorInHWCFP32(taskResnet50, OUTPUT_NODE, FCResult, channel);
-
-        /* Calculate softmax on CPU and display TOP-5 classification results */
-        CPUCalcSoftmax(FCResult, channel, softmax);
-        TopK(softmax, channel, 5, kinds);
+        /* Select TOP-5 on the INT8 FC result and display the classification results */
+        int8_t *outAddr = dpuGetOutputTensorAddress(taskResnet50, OUTPUT_NODE);
+        float outScale = dpuGetOutputTensorScale(taskResnet50, OUTPUT_NODE);
+        ClassifyTopK(outAddr, channel, outScale, 5, top5);
+        PrintClassifyResult(top5, kinds);
 
         /* Display the impage */
         cv::imshow("Classification of ResNet50", image);
         cv::waitKey(1);
     }
-
-    delete[] softmax;
-    delete[] FCResult;
 }
 
 /**
@@ -66,8 +66,12 @@
 /* header file for DNNDK APIs */
 #include <dnndk/dnndk.h>
 
+#include "avg_pool.h"
+#include "classify_result.h"
+
 using namespace std;
 using namespace cv;
+using namespace deephi;
 
 /* 3.16GOP times calculation for GoogLeNet CONV */
 #define GOOGLENET_WORKLOAD_CONV (3.16f)
@@ -148,32 +152,6 @@ void LoadWords(std::string const &path, std::vector<std::string> &kinds) {
 }
 
 
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, std::vector<std::string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    std::priority_queue<std::pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(std::pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        std::pair<float, int> ki = q.top();
-        fprintf(stdout, "top[%d] prob = %-8f  name = %s\n", i, d[ki.second],
-        vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Compute average pooling on CPU
  *
@@ -185,42 +163,20 @@ void TopK(const float *d, int size, int k, std::vector<std::string> &vkinds) {
 void CPUCalcAvgPool(DPUTask *conv, DPUTask *fc) {
     assert(conv && fc);
 
-    DPUTensor *conv_out_tensor = dpuGetOutputTensor(conv, TASK_CONV_OUTPUT);
-
-    /* Get size of the output Tensor */
-    int tensorSize = dpuGetTensorSize(conv_out_tensor);
-    /* Get height dimension of the output Tensor */
-    int outHeight = dpuGetTensorHeight(conv_out_tensor);
-    /* Get width dimension of the output Tensor */
-    int outWidth = dpuGetTensorWidth(conv_out_tensor);
-
-    /**
-    * Get the channels of the last inception to compute the output Node's
-    * actual output channel.
-    */
-    int outChannel = dpuGetTensorChannel(conv_out_tensor);
-
-    /* Allocate the memory and store conv's output after conversion */
-    float *outBuffer = new float[tensorSize];
-    dpuGetOutputTensorInHWCFP32(conv, TASK_CONV_OUTPUT, outBuffer, tensorSize);
-
-    /* Get the input address to the first Node of FC Task */
-    int8_t *fcInput = dpuGetInputTensorAddress(fc, TASK_FC_INPUT);
-    /* Get scale value for the first input Node of FC task */
-    float scaleFC = dpuGetInputTensorScale(fc, TASK_FC_INPUT);
+    /* Get output Tensor to the last Node of CONV Task */
+    DPUTensor *outTensor = dpuGetOutputTensor(conv, TASK_CONV_OUTPUT);
+    int outHeight = dpuGetTensorHeight(outTensor);
+    int outWidth = dpuGetTensorWidth(outTensor);
+    int outChannel = dpuGetTensorChannel(outTensor);
     int length = outHeight * outWidth;
-    float avg = static_cast<float>(length);
-    for (int i = 0; i < outChannel; i++) {
-        float sum = 0.0f;
-        for (int j = 0; j < length; j++) {
-            sum += outBuffer[outChannel * j + i];
-        }
 
-        /* Compute average and set into the first input Node of FC Task */
-        fcInput[i] = static_cast<int8_t>(sum / avg * scaleFC);
-    }
-
-    delete[] outBuffer;
+    /**
+     * Pool the INT8 output in place and requantize the averages with the
+     * scales of both Tensors straight into the input Node of FC Task
+     */
+    float factor = dpuGetTensorScale(outTensor) * dpuGetInputTensorScale(fc, TASK_FC_INPUT) / length;
+    AvgPoolInt8(dpuGetTensorAddress(outTensor), length, outChannel, factor,
+                dpuGetInputTensorAddress(fc, TASK_FC_INPUT));
 }
 
 /**
@@ -248,8 +204,7 @@ void runGoogLeNet(DPUTask *taskConv, DPUTask *taskFC) {
     LoadWords(baseImagePath + "words.txt", kinds);
     /* Get channel count of the output Tensor for FC Task  */
     int channel = dpuGetOutputTensorChannel(taskFC, TASK_FC_OUTPUT);
-    float *softmax = new float[channel];
-    float *result = new float[channel];
+    ClassifyResult top5;
     for (auto &image_name : images) {
         cout << "\nLoad image : " << image_name << endl;
         /* Load image and Set image into DPU Task for GoogLeNet */
@@ -282,19 +237,14 @@ void runGoogLeNet(DPUTask *taskConv, DPUTask *taskFC) {
         DPUTensor *outTensor = dpuGetOutputTensor(taskFC, TASK_FC_OUTPUT);
         int8_t *outAddr = dpuGetTensorAddress(outTensor);
         float convScale=dpuGetOutputTensorScale(taskFC, TASK_FC_OUTPUT,  0);
-        int size = dpuGetOutputTensorSize(taskFC, TASK_FC_OUTPUT);
-        /* Calculate softmax on CPU and display TOP-5 classification results */
-        dpuRunSoftmax(outAddr, softmax, channel, size/channel ,convScale );
-
-        TopK(softmax, channel, 5, kinds);
+        /* Select TOP-5 on the INT8 output and display the classification results */
+        ClassifyTopK(outAddr, channel, convScale, 5, top5);
+        PrintClassifyResult(top5, kinds);
 
         /* Display the image */
         cv::imshow("Image", image);
         cv::waitKey(1);
     }
-
-    delete[] softmax;
-    delete[] result;
 }
 
 /**
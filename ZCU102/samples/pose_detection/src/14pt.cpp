@@ -47,6 +47,8 @@
 */
 
 #include "14pt.h"
+#include "avg_pool.h"
+#include "input_quantize.h"
 
 namespace deephi {
 
@@ -114,74 +116,52 @@ void dpuOutputIn2F32(DPUTask* task, const char* nodeName, float* buffer, int siz
  */
 void CPUCalcAvgPool(DPUTask* conv, DPUTask* fc) {
     assert(conv && fc);
+
+    /* Get output Tensor to the last Node of CONV Task */
     DPUTensor* outTensor = dpuGetOutputTensor(conv, PT_CONV_OUTPUT_NODE);
     int outHeight = dpuGetTensorHeight(outTensor);
     int outWidth = dpuGetTensorWidth(outTensor);
     int outChannel = dpuGetTensorChannel(outTensor);
-    int tensorSize = dpuGetTensorSize(outTensor);
-
-    float* outBuffer = new float[tensorSize];
-    dpuGetOutputTensorInHWCFP32(conv, PT_CONV_OUTPUT_NODE, outBuffer, tensorSize);
-
-    int8_t* fcInput = dpuGetInputTensorAddress(fc, PT_FC_NODE);
-    float scaleFC = dpuGetInputTensorScale(fc, PT_FC_NODE);
     int length = outHeight * outWidth;
-    float avg = static_cast<float>(length);
-
-    for (int i = 0; i < outChannel; i++) {
-        float sum = 0.0f;
-        for (int j = 0; j < length; j++) {
-            sum += outBuffer[outChannel * j + i];
-        }
-        fcInput[i] = static_cast<int8_t>(sum / avg * scaleFC);
-    }
 
-    delete[] outBuffer;
+    /**
+     * Pool the INT8 output in place and requantize the averages with the
+     * scales of both Tensors straight into the input Node of FC Task
+     */
+    float factor = dpuGetTensorScale(outTensor) * dpuGetInputTensorScale(fc, PT_FC_NODE) / length;
+    AvgPoolInt8(dpuGetTensorAddress(outTensor), length, outChannel, factor,
+                dpuGetInputTensorAddress(fc, PT_FC_NODE));
 }
 
 /**
  * construction  of GestureDetect
- *      initialize the DPU Kernels
  */
 GestureDetect::GestureDetect() {
 }
 
 /**
- * destroy the DPU Kernels and Tasks
+ * destruction of GestureDetect
  */
 GestureDetect::~GestureDetect() {
 }
 
 /**
  * @brief Init - initialize the 14pt model
+ *
+ * @param executor - runs the CONV and FC kernels, shared by all threads
  */
-void GestureDetect::Init() {
-    kernel_conv_PT = dpuLoadKernel(PT_KRENEL_CONV);
-    kernel_fc_PT = dpuLoadKernel(PT_KRENEL_FC);
-
-    task_conv_PT = dpuCreateTask(kernel_conv_PT, 0);
-    task_fc_PT = dpuCreateTask(kernel_fc_PT, 0);
+void GestureDetect::Init(ConvFcExecutor& executor) {
+    executor_ = &executor;
+    conv_input_.AddInput(PT_CONV_INPUT_NODE);
 }
 
 /**
  * @brief Finalize - release resource
+ *
+ * The Tasks and the kernels belong to the caller, so nothing is left to
+ * release here.
  */
 void GestureDetect::Finalize() {
-    if(task_conv_PT) {
-        dpuDestroyTask(task_conv_PT);
-    }
-
-    if(kernel_conv_PT) {
-        dpuDestroyKernel(kernel_conv_PT);
-    }
-
-    if(task_fc_PT) {
-        dpuDestroyTask(task_fc_PT);
-    }
-
-    if(kernel_fc_PT) {
-        dpuDestroyKernel(kernel_fc_PT);
-    }
 }
 
 /**
@@ -190,18 +170,28 @@ void GestureDetect::Finalize() {
 void GestureDetect::Run(cv::Mat& img) {
     vector<float> results(28);
     float mean[3] = {104, 117, 123};
-    int width = dpuGetInputTensorWidth(task_conv_PT, PT_CONV_INPUT_NODE);
-    int height = dpuGetInputTensorHeight(task_conv_PT, PT_CONV_INPUT_NODE);
 
-    dpuSetInputImage(task_conv_PT,PT_CONV_INPUT_NODE,img,mean);
-
-    dpuRunTask(task_conv_PT);
-    CPUCalcAvgPool(task_conv_PT, task_fc_PT);
-    dpuRunTask(task_fc_PT);
-
-    int channel = dpuGetOutputTensorChannel(task_fc_PT, PT_FC_NODE);
-
-    dpuOutputIn2F32(task_fc_PT, PT_FC_NODE, results.data(), channel);
+    int width = 0;
+    int height = 0;
+
+    // the CONV of this person overlaps pooling and FC of another one
+    int status = executor_->Run(
+        [&](DPUTask* conv) {
+            const TensorHandle* input = conv_input_.Get(conv);
+            width = input->width;
+            height = input->height;
+
+            // resize and quantize the person crop straight into the input Tensor
+            SetInputImageFused(*input, img, mean);
+        },
+        [&](DPUTask* fc) {
+            int channel = dpuGetOutputTensorChannel(fc, PT_FC_NODE);
+            dpuOutputIn2F32(fc, PT_FC_NODE, results.data(), channel);
+        });
+    // no joint points to draw if the DPU failed
+    if (status != 0 || width == 0 || height == 0) {
+        return;
+    }
 
     float scale_w = (float)img.cols / (float)width;
     float scale_h = (float)img.rows / (float)height;
@@ -48,12 +48,14 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <mutex>
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <queue>
 #include <string>
 #include <thread>
@@ -63,6 +65,9 @@
 #include <dnndk/dnndk.h>
 
 #include "14pt.h"
+#include "fc_int8.h"
+#include "frame_source.h"
+#include "reorder_buffer.h"
 #include "ssd.h"
 
 using namespace std;
@@ -70,62 +75,34 @@ using namespace std::chrono;
 using namespace cv;
 using namespace deephi;
 
-// comparison algorithm for priority_queue
-class Compare {
-    public:
-    bool operator()(const pair<int, Mat> &n1, const pair<int, Mat> &n2) const {
-        return n1.first > n2.first;
-    }
-};
-
-// input video
-VideoCapture video;
+// detection threads
+#define THREAD_NUM 2
 
-// flags for each thread
-bool is_reading = true;
-bool is_running_1 = true;
-bool is_displaying = true;
+FrameSource video(1, 30);                                                       // input video, decoded 30 frames ahead
+ReorderBuffer<Mat> display_queue(30 + THREAD_NUM);                              // display queue, in frame order
+atomic<int> running_num(THREAD_NUM);                                            // detection threads still running
 
-queue<pair<int, Mat>> read_queue;                                               // read queue
-priority_queue<pair<int, Mat>, vector<pair<int, Mat>>, Compare> display_queue;  // display queue
-mutex mtx_read_queue;                                                           // mutex of read queue
-mutex mtx_display_queue;                                                        // mutex of display queue
-int read_index = 0;                                                             // frame index of input video
-int display_index = 0;                                                          // frame index to display
+TaskPool task_pool;                                                             // DPU Tasks of all threads
+unique_ptr<ConvFcExecutor> gesture_executor;                                    // CONV and FC of the joint points
+FcInt8 gesture_fc;                                                              // FC of the joint points on the CPU
+DPUKernel *kernel_ssd, *kernel_conv_PT, *kernel_fc_PT;                          // DPU Kernels of the models
 
 /**
  * @brief entry routine of segmentation, and put image into display queue
  *
- * @param is_running - status flag of the thread
- *
  * @return none
  */
-void runGestureDetect(bool &is_running) {
+void runGestureDetect() {
     SSD ssd;
     GestureDetect gesture;
-    ssd.Init("ssd_person");
-    gesture.Init();
+    ssd.Init(task_pool, kernel_ssd, "ssd_person");
+    gesture.Init(*gesture_executor);
 
-    // Run detection for images in read queue
-    while (is_running) {
-        // Get an image from read queue
-        int index;
-        Mat img;
-        mtx_read_queue.lock();
-        if (read_queue.empty()) {
-            mtx_read_queue.unlock();
-            if (is_reading) {
-                continue;
-            } else {
-                is_running = false;
-                break;
-            }
-        } else {
-            index = read_queue.front().first;
-            img = read_queue.front().second;
-            read_queue.pop();
-            mtx_read_queue.unlock();
-        }
+    // Run detection for the frames of the video, at full size for the
+    // joint points
+    int index;
+    Mat img;
+    while (video.Read(index, img)) {
 
         // detect persons using ssd
         vector<tuple<int, float, cv::Rect_<float>>> results;
@@ -147,74 +124,39 @@ void runGestureDetect(bool &is_running) {
             gesture.Run(sub_img);
         }
 
-        // Put image into display queue
-        mtx_display_queue.lock();
-        display_queue.push(make_pair(index, img));
-        mtx_display_queue.unlock();
+        // Put image into display queue, closed if the display has quit
+        if (!display_queue.Put(index, img)) {
+            break;
+        }
     }
 
     ssd.Finalize();
     gesture.Finalize();
-}
 
-/**
- * @brief Read frames into read queue from a video
- *
- * @param is_reading - status flag of Read thread
- *
- * @return none
- */
-void Read(bool &is_reading) {
-    while (is_reading) {
-        Mat img;
-        if (read_queue.size() < 30) {
-            if (!video.read(img)) {
-                cout << "Finish reading the video." << endl;
-                is_reading = false;
-                break;
-            }
-            mtx_read_queue.lock();
-            read_queue.push(make_pair(read_index++, img));
-            mtx_read_queue.unlock();
-        } else {
-            usleep(20);
-        }
+    // The last thread ends the display
+    if (--running_num == 0) {
+        display_queue.Close();
     }
 }
 
 /**
  * @brief Display frames in display queue
  *
- * @param is_displaying - status flag of Display thread
- *
  * @return none
  */
-void Display(bool &is_displaying) {
-    while (is_displaying) {
-        mtx_display_queue.lock();
-        if (display_queue.empty()) {
-            if (is_running_1 ) {
-                mtx_display_queue.unlock();
-                usleep(20);
-            } else {
-                mtx_display_queue.unlock();
-                is_displaying = false;
-                break;
-            }
-        } else if (display_index == display_queue.top().first) {
-            // Display image
-            imshow("PoseDetection @Deephi DPU", display_queue.top().second);
-            display_index++;
-            display_queue.pop();
-            mtx_display_queue.unlock();
-            if (waitKey(1) == 'q') {
-                is_reading = false;
-                is_running_1 = false;
-                is_displaying = false;
-                break;
-            }
-        } else {
-            mtx_display_queue.unlock();
+void Display() {
+    // frames in frame order, as soon as the next one is done
+    long index;
+    Mat img;
+
+    while (display_queue.Next(index, img)) {
+        // Display image
+        imshow("PoseDetection @Deephi DPU", img);
+        if (waitKey(1) == 'q') {
+            // Stop the decoder and the detection threads
+            video.Close();
+            display_queue.Close();
+            return;
         }
     }
 }
@@ -223,41 +165,99 @@ void Display(bool &is_displaying) {
  * @brief Entry for running pose detection neural network
  *
  * @arg file_name[string] - path to file for detection
+ * @arg fc_weights[string] - optional, weights to run FC on the CPU
  *
  */
 int main(int argc, char **argv) {
     // Check args
-    if (argc != 2) {
-        cout << "Usage of pose detection demo: ./pose_detection file_name[string]" << endl;
+    if (argc != 2 && argc != 3) {
+        cout << "Usage of pose detection demo: ./pose_detection file_name[string] [fc_weights[string]]" << endl;
         cout << "\tfile_name: path to your video file" << endl;
+        cout << "\tfc_weights: run FC on the CPU with INT8 weights written by" << endl;
+        cout << "\t            common/tools/fc_pack, instead of the FC Kernel" << endl;
         return -1;
     }
 
+    // Dump the per-stage latency histograms at exit and on SIGUSR1
+    InstallStageDump();
+
     // Attach to DPU driver and prepare for running
     dpuOpen();
 
     // Initializations
     string file_name = argv[1];
     cout << "Detect video: " << file_name << endl;
-    video.open(file_name);
-    if (!video.isOpened()) {
+    if (!video.Open(file_name)) {
         cout << "Failed to open video: " << file_name;
         return -1;
     }
 
+    // Load the DPU Kernels once and share their Tasks between the threads
+    kernel_ssd = dpuLoadKernel("ssd_person");
+    kernel_conv_PT = dpuLoadKernel(PT_KRENEL_CONV);
+    kernel_fc_PT = dpuLoadKernel(PT_KRENEL_FC);
+    task_pool.Add(kernel_ssd, THREAD_NUM, THREAD_NUM, "ssd_person");
+
+    // CONV of one person overlaps pooling and FC of another: a CONV Task
+    // per detection thread, plus one to pool from
+    vector<DPUTask *> tasks_conv_PT, tasks_fc_PT;
+    for (int i = 0; i < 3; ++i) {
+        tasks_conv_PT.push_back(dpuCreateTask(kernel_conv_PT, 0));
+    }
+    tasks_fc_PT.push_back(dpuCreateTask(kernel_fc_PT, 0));
+
+    // With weights, FC runs on the CPU from the pooled input of the FC Task
+    // into its output Tensor, at the scale of the FC Kernel
+    ConvFcExecutor::FcBatchFunc fc_batch;
+    if (argc == 3) {
+        if (!gesture_fc.Load(argv[2])) {
+            return -1;
+        }
+        if (gesture_fc.input_size() != dpuGetInputTensorSize(tasks_fc_PT[0], PT_FC_NODE) ||
+            gesture_fc.output_size() != dpuGetOutputTensorSize(tasks_fc_PT[0], PT_FC_NODE)) {
+            cout << "Weights " << argv[2] << " are not those of " << PT_KRENEL_FC << endl;
+            return -1;
+        }
+        gesture_fc.set_output_scale(dpuGetOutputTensorScale(tasks_fc_PT[0], PT_FC_NODE));
+        fc_batch = [](DPUTask *const *fc, int n) {
+            for (int i = 0; i < n; ++i) {
+                gesture_fc.Run(dpuGetInputTensorAddress(fc[i], PT_FC_NODE),
+                               dpuGetInputTensorScale(fc[i], PT_FC_NODE),
+                               dpuGetOutputTensorAddress(fc[i], PT_FC_NODE));
+            }
+            return 0;
+        };
+    }
+    gesture_executor.reset(
+        new ConvFcExecutor(tasks_conv_PT, tasks_fc_PT, CPUCalcAvgPool, dpuRunTask, fc_batch));
+
     // Run tasks for SSD
-    array<thread, 4> threads = {thread(Read, ref(is_reading)),
-                                thread(runGestureDetect, ref(is_running_1)),
-                                thread(runGestureDetect, ref(is_running_1)),
-                                thread(Display, ref(is_displaying))};
+    array<thread, 3> threads = {thread(runGestureDetect),
+                                thread(runGestureDetect),
+                                thread(Display)};
 
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < 3; ++i) {
         threads[i].join();
     }
 
+    // Destroy DPU Tasks and Kernels
+    video.Report();
+    display_queue.Report("display");
+    task_pool.Report();
+    task_pool.Release();
+    gesture_executor->Report();
+    gesture_executor.reset();
+    for (auto task : tasks_conv_PT) {
+        dpuDestroyTask(task);
+    }
+    dpuDestroyTask(tasks_fc_PT[0]);
+    dpuDestroyKernel(kernel_ssd);
+    dpuDestroyKernel(kernel_conv_PT);
+    dpuDestroyKernel(kernel_fc_PT);
+
     // Detach from DPU driver and release resources
     dpuClose();
-    video.release();
+    video.Close();
 
     return 0;
 }
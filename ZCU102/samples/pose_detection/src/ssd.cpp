@@ -509,6 +509,8 @@ void PriorBoxes::Create(vector<shared_ptr<vector<float>>> & vec_priors, SSD_TYPE
 /**
  * @brief Init - initialize SSD model
  *
+ * @param pool - pool the Tasks of the kernel are taken from
+ * @param kernel - the DPU kernel loaded by the caller
  * @param kernel_name - the kernel name which is generated by DNNC
  * @param input_node - name of the input node in SSD model
  * @param output_loc - name of the location node in SSD model
@@ -517,14 +519,17 @@ void PriorBoxes::Create(vector<shared_ptr<vector<float>>> & vec_priors, SSD_TYPE
  * @param top_k - the number of top_k
  * @param class_k - the number of class
  */
-void SSD::Init(const string& kernel_name, const string& input_node, const string& output_loc,
+void SSD::Init(TaskPool& pool, DPUKernel* kernel, const string& kernel_name,
+               const string& input_node, const string& output_loc,
                const string& output_conf, float th_nms, int top_k, int class_k) {
     input_node_ = input_node;
+    output_loc_ = output_loc;
+    output_conf_ = output_conf;
 
     kernel_name_ = kernel_name;
 
-    kernel_conv = dpuLoadKernel(kernel_name_.c_str());
-    task = dpuCreateTask(kernel_conv, 0);
+    pool_ = &pool;
+    kernel_ = kernel;
 
     if ((kernel_name_ == "ssd") || (kernel_name_ == "vehicle")) {
         type_ = SSD_TYPE::VEHICLE;
@@ -538,12 +543,13 @@ void SSD::Init(const string& kernel_name, const string& input_node, const string
 
     PriorBoxes::Create(priors_, type_);
 
-    // initialize some parameters
-    loc = (int8_t*)dpuGetOutputTensorAddress(task, output_loc.c_str());
-    conf = (int8_t*)dpuGetOutputTensorAddress(task, output_conf.c_str());
-    loc_scale = dpuGetOutputTensorScale(task, output_loc.c_str());
-    conf_scale = dpuGetOutputTensorScale(task, output_conf.c_str());
-    conf_size = dpuGetOutputTensorSize(task, output_conf.c_str());
+    // initialize some parameters, the same for every Task of the kernel
+    {
+        TaskLease task(pool, kernel);
+        loc_scale = dpuGetOutputTensorScale(task, output_loc.c_str());
+        conf_scale = dpuGetOutputTensorScale(task, output_conf.c_str());
+        conf_size = dpuGetOutputTensorSize(task, output_conf.c_str());
+    }
     softmax_data_ = new float[priors_.size() * num_classes_];
 
     detector_ = new SSDdetector(num_classes_, SSDdetector::CodeType::CENTER_SIZE, false,
@@ -558,6 +564,10 @@ void SSD::Init(const string& kernel_name, const string& input_node, const string
  *
  */
 void SSD::Run(Mat & img, MultiDetObjects * results) {
+    // any free Task of the kernel runs the image, until its output is decoded
+    TaskLease task(*pool_, kernel_);
+    int8_t* loc = dpuGetOutputTensorAddress(task, output_loc_.c_str());
+    int8_t* conf = dpuGetOutputTensorAddress(task, output_conf_.c_str());
 
     _T(dpuSetInputImage2(task, input_node_.c_str(), img));
 
@@ -575,8 +585,10 @@ void SSD::Run(Mat & img, MultiDetObjects * results) {
  *
  */
 void SSD::Finalize() {
-    if(task) dpuDestroyTask(task);
-    if(kernel_conv) dpuDestroyKernel(kernel_conv);
+    delete detector_;
+    detector_ = nullptr;
+    delete[] softmax_data_;
+    softmax_data_ = nullptr;
 }
 
 /**
@@ -66,25 +66,16 @@
 
 #include <dnndk/dnndk.h>
 
+#include "stage_timer.h"
+#include "task_pool.h"
+
 using namespace std;
 using namespace std::chrono;
 using namespace cv;
 
-#ifdef MEASURE_PERFORMANCE
-#define _T(func)                                                              \
-    {                                                                         \
-        auto _start = system_clock::now();                                    \
-        func;                                                                 \
-        auto _end = system_clock::now();                                      \
-        auto duration = (duration_cast<microseconds>(_end - _start)).count(); \
-        string tmp = #func;                                                   \
-        tmp = tmp.substr(0, tmp.find('('));                                   \
-        cout << "[TimeMeasure]" << left << setw(30) << tmp;                   \
-        cout << right << setw(10) << duration << " us" << endl;               \
-    }
-#else
-#define _T(func) func;
-#endif
+/* Time every _T() call into per-stage latency histograms, dumped at exit
+   and on SIGUSR1 */
+#define _T(func) STAGE_TIME(func)
 
 namespace deephi {
 
@@ -240,6 +231,8 @@ public:
     /*
      * @brief Init - initialize SSD model
      *
+     * @param pool - pool the Tasks of the kernel are taken from
+     * @param kernel - the DPU kernel loaded by the caller
      * @param kernel_name - the kernel name which is generated by DNNC
      * @param input_node - name of the input node in SSD model
      * @param output_loc - name of the location node in SSD model
@@ -248,7 +241,8 @@ public:
      * @param top_k - the IOU threshold
      * @param class_k - the tiling dimension
      */
-    void Init(const string& kernel_name,
+    void Init(TaskPool& pool, DPUKernel* kernel,
+            const string& kernel_name,
             const string& input_node = "conv1_1",
             const string& output_loc = "mbox_loc",
             const string& output_conf = "mbox_conf",
@@ -294,11 +288,9 @@ private:
     float* softmax_data_;
     SSDdetector* detector_;
 
-    DPUKernel* kernel_conv;
-    DPUTask* task;
+    TaskPool* pool_;
+    DPUKernel* kernel_;
 
-    int8_t* loc;
-    int8_t* conf;
     float loc_scale, conf_scale;
     int conf_size;
     SSD_TYPE type_;
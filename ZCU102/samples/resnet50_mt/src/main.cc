@@ -48,6 +48,7 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <atomic>
@@ -57,9 +58,11 @@
 #include <chrono>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <string>
@@ -73,11 +76,26 @@
 /* header file OpenCV for image processing */
 #include <opencv2/opencv.hpp>
 
+#include "avg_pool.h"
+#include "classify_bench.h"
+#include "classify_pipeline.h"
+#include "classify_result.h"
+#include "conv_fc_executor.h"
+#include "fc_int8.h"
+#include "stage_timer.h"
+#include "tensor_cache.h"
+#include "worker_context.h"
+
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
+using namespace deephi;
 
 int threadnum;
+/* B, G and R mean the Kernel was compiled with, for the tensor cache:
+   dpuSetInputImage2() applies the mean stored in the Kernel, which N2Cube
+   does not expose, so it has to be given with -m when it differs */
+float cacheMean[3] = {104, 117, 123};
 #define RESNET50_WORKLOAD_CONV (7.71f)
 #define RESNET50_WORKLOAD_FC (4.0f / 1000)
 
@@ -92,22 +110,9 @@ int threadnum;
 
 const string baseImagePath = "./image/";
 
-/*#define SHOWTIME*/
-#ifdef SHOWTIME
-#define _T(func)                                                          \
-{                                                                         \
-    auto _start = system_clock::now();                                    \
-    func;                                                                 \
-    auto _end = system_clock::now();                                      \
-    auto duration = (duration_cast<microseconds>(_end - _start)).count(); \
-    string tmp = #func;                                                   \
-    tmp = tmp.substr(0, tmp.find('('));                                   \
-    cout << "[TimeTest]" << left << setw(30) << tmp;                      \
-    cout << left << setw(10) << duration << "us" << endl;                 \
-}
-#else
-#define _T(func) func;
-#endif
+/* Time every _T() call into per-stage latency histograms, dumped at exit
+   and on SIGUSR1 */
+#define _T(func) STAGE_TIME(func)
 
 /**
  * @brief put image names to a vector
@@ -173,31 +178,6 @@ void LoadWords(string const &path, vector<string> &kinds) {
 }
 
 
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("[Top]%d prob = %-8f  name = %s\n", i, d[ki.second], vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Compute average pooling on CPU
  *
@@ -209,52 +189,37 @@ void TopK(const float *d, int size, int k, vector<string> &vkinds) {
 void CPUCalcAvgPool(DPUTask *conv, DPUTask *fc) {
     assert(conv && fc);
 
-    /* Get output Tensor to the last Node of ResNet50 CONV Task */
+    /* Get output Tensor to the last Node of CONV Task */
     DPUTensor *outTensor = dpuGetOutputTensor(conv, CONV_OUTPUT_NODE);
-    /* Get size, height, width and channel of the output Tensor */
-    int tensorSize = dpuGetTensorSize(outTensor);
     int outHeight = dpuGetTensorHeight(outTensor);
     int outWidth = dpuGetTensorWidth(outTensor);
     int outChannel = dpuGetTensorChannel(outTensor);
-
-    /* allocate memory buffer */
-    int8_t *outBuffer = new int8_t[tensorSize];
-
-    /* Get the input address to the first Node of FC Task */
-    int8_t *fcInput = dpuGetInputTensorAddress(fc, FC_INPUT_NODE);
-
-    /* Copy the last Node's output from DPU memory buffer to CPU memory buffer */
-    memcpy(outBuffer, dpuGetTensorAddress(outTensor), tensorSize);
     int length = outHeight * outWidth;
 
-    int sum;
-    for (int i = 0; i < outChannel; i++) {
-        sum = 0;
-        for (int j = 0; j < length; j++) {
-            sum += outBuffer[outChannel * j + i];
-        }
-
-        /* compute average and set into the first input Node of FC Task */
-        fcInput[i] = (int8_t)((float)(sum) / (float)length * 2);
-    }
-
-    delete[] outBuffer;
+    /**
+     * Pool the INT8 output in place and requantize the averages with the
+     * scales of both Tensors straight into the input Node of FC Task
+     */
+    float factor = dpuGetTensorScale(outTensor) * dpuGetInputTensorScale(fc, FC_INPUT_NODE) / length;
+    AvgPoolInt8(dpuGetTensorAddress(outTensor), length, outChannel, factor,
+                dpuGetInputTensorAddress(fc, FC_INPUT_NODE));
 }
 
 /**
  * @brief Run CONV Task and FC Task for ResNet50
  *
- * @param taskConv - pointer to ResNet50 CONV Task
- * @param taskFC - pointer to ResNet50 FC Task
+ * @param ctx - context of the worker, owning its DPU Tasks
+ * @param img - input image
  *
  * @return none
  */
-void runResnet50(DPUTask *taskConv, DPUTask *taskFC, Mat &img) {
-    assert(taskConv && taskFC);
+void runResnet50(WorkerContext &ctx, Mat &img) {
+    DPUTask *taskConv = ctx.task(0);
+    DPUTask *taskFC = ctx.task(1);
 
     int channel = dpuGetOutputTensorChannel(taskFC, FC_OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult &top5 = ctx.result();
+
     _T(dpuSetInputImage2(taskConv, CONV_INPUT_NODE, img));
 
     _T(dpuRunTask(taskConv));
@@ -264,11 +229,7 @@ void runResnet50(DPUTask *taskConv, DPUTask *taskFC, Mat &img) {
     DPUTensor *outTensor = dpuGetOutputTensor(taskFC, FC_OUTPUT_NODE);
     int8_t *outAddr = dpuGetTensorAddress(outTensor);
     float convScale=dpuGetOutputTensorScale(taskFC, FC_OUTPUT_NODE,  0);
-    int size = dpuGetOutputTensorSize(taskFC, FC_OUTPUT_NODE);
-    _T(dpuRunSoftmax(outAddr, softmax, channel, size/channel ,convScale ));
-
-    delete[] softmax;
-    delete[] FCResult;
+    _T(ClassifyTopK(outAddr, channel, convScale, 5, top5));
 }
 
 /**
@@ -276,10 +237,11 @@ void runResnet50(DPUTask *taskConv, DPUTask *taskFC, Mat &img) {
  *
  * @param kernelconv - point to DPU Kernel
  * @param kernelfc - point to DPU Kernel
+ * @param pin - pin each worker thread to its own CPU
  *
  * @return none
  */
-void classifyEntry(DPUKernel *kernelconv, DPUKernel *kernelfc) {
+void classifyEntry(DPUKernel *kernelconv, DPUKernel *kernelfc, bool pin) {
     vector<string> kinds, images;
     ListImages(baseImagePath, images);
     if (images.size() == 0) {
@@ -303,18 +265,14 @@ void classifyEntry(DPUKernel *kernelconv, DPUKernel *kernelfc) {
 
     for (auto i = 0; i < threadnum; i++) {
         workers[i] = thread([&,i]() {
-            // Create DPU Tasks from DPU Kernel
-            DPUTask *taskconv = dpuCreateTask(kernelconv, 0);
-            DPUTask *taskfc = dpuCreateTask(kernelfc, 0);
+            // Create the context owning the DPU Tasks of this worker
+            WorkerContext ctx(i, {kernelconv, kernelfc}, pin ? i : -1);
+            ctx.Attach();
 
             for(unsigned int ind = i  ;ind < IMAGE_COUNT;ind+=threadnum) {
                 // Process the image using DenseBox model
-                runResnet50(taskconv, taskfc, img);
+                runResnet50(ctx, img);
             }
-
-            // Destroy DPU Tasks & free resources
-            dpuDestroyTask(taskconv);
-            dpuDestroyTask(taskfc);
         });
     }
 
@@ -329,6 +287,250 @@ void classifyEntry(DPUKernel *kernelconv, DPUKernel *kernelfc) {
     cout << "[FPS]" << IMAGE_COUNT*1000000.0/duration  << endl;
 }
 
+/**
+ * @brief  - Entry of the staged classification pipeline over an image directory
+ *
+ * @param kernelconv - point to DPU Kernel
+ * @param kernelfc - point to DPU Kernel
+ * @param path - directory of the images
+ * @param count - number of images to classify, 0 for each image once
+ * @param depth - capacity of the queues between two stages
+ * @param argmax - only pick the most probable class, without softmax
+ * @param pin - pin each DPU worker thread to its own CPU
+ * @param cache - Tensor cache file of the preprocessed images, empty to
+ *                decode every image
+ * @param list - labelled image list to benchmark, empty to run the pipeline
+ * @param bench - warmup, count, duration and outputs of the benchmark
+ * @param overlap - largest FC batch of a ConvFcExecutor overlapping CONV
+ *                  and FC across images, 0 to run them in sequence
+ * @param fcWeights - weights written by common/tools/fc_pack to run FC on
+ *                    the CPU, empty to run the FC Kernel
+ *
+ * @return none
+ */
+void pipelineEntry(DPUKernel *kernelconv, DPUKernel *kernelfc, string path,
+                   int count, int depth, bool argmax, bool pin, string cache,
+                   string list, BenchConfig bench, int overlap, string fcWeights) {
+    vector<string> kinds, images;
+    if (path.back() != '/') {
+        path += '/';
+    }
+
+    ListImages(path, images);
+    if (images.size() == 0) {
+        cerr << "\nError: Not images exist in " << path << endl;
+        return;
+    }
+
+    /* Load all kinds words.*/
+    LoadWords(path + "words.txt", kinds);
+    if (kinds.size() == 0) {
+        cerr << "\nError: Not words exist in words.txt." << endl;
+        return;
+    }
+
+    if (count <= 0) {
+        count = images.size();
+    }
+    cout << "total image : " << count << endl;
+
+    /* Create the context, owning the DPU Tasks, of each DPU worker */
+    vector<unique_ptr<WorkerContext>> contexts;
+    for (auto i = 0; i < threadnum; i++) {
+        contexts.emplace_back(new WorkerContext(i, {kernelconv, kernelfc}, pin ? i : -1));
+    }
+
+    Size inputSize(dpuGetInputTensorWidth(contexts[0]->task(0), CONV_INPUT_NODE),
+                   dpuGetInputTensorHeight(contexts[0]->task(0), CONV_INPUT_NODE));
+    int channel = dpuGetOutputTensorChannel(contexts[0]->task(1), FC_OUTPUT_NODE);
+    ClassifyResult top5;
+
+    ClassifyPipeline pipeline(threadnum, inputSize, depth);
+
+    /* Images in the cache skip decoding and preprocessing */
+    TensorCache tensorCache;
+    if (!cache.empty()) {
+        TensorCacheKey key = {inputSize.width, inputSize.height,
+                              dpuGetInputTensorChannel(contexts[0]->task(0), CONV_INPUT_NODE),
+                              {cacheMean[0], cacheMean[1], cacheMean[2]},
+                              dpuGetInputTensorScale(contexts[0]->task(0), CONV_INPUT_NODE)};
+        if (!tensorCache.Open(cache)) {
+            return;
+        }
+        if (!tensorCache.Matches(key)) {
+            cerr << "\nError: " << cache << " is not built for this input Tensor, rebuild it with" << endl;
+            cerr << "  tensor_cache_build " << path << " " << cache << " " << key.width << " "
+                 << key.height << " " << key.scale << " " << key.mean[0] << " "
+                 << key.mean[1] << " " << key.mean[2] << endl;
+            return;
+        }
+        pipeline.UseCache(&tensorCache);
+    }
+
+    /* FC on the CPU, from the pooled input of the FC Task to the logits */
+    FcInt8 fcInt8;
+    if (!fcWeights.empty()) {
+        if (!fcInt8.Load(fcWeights)) {
+            return;
+        }
+        if (fcInt8.input_size() != dpuGetInputTensorSize(contexts[0]->task(1), FC_INPUT_NODE) ||
+            fcInt8.output_size() != channel) {
+            cerr << "\nError: " << fcWeights << " holds " << fcInt8.output_size() << " x "
+                 << fcInt8.input_size() << " weights, not those of " << KERNEL_FC << endl;
+            return;
+        }
+        /* same logits as the FC Kernel, for the benchmark to compare */
+        fcInt8.set_output_scale(dpuGetOutputTensorScale(contexts[0]->task(1), FC_OUTPUT_NODE));
+    }
+
+    /* Set the input of a CONV Task */
+    auto setInput = [&](DPUTask *taskConv, ClassifyJob &job) {
+        if (job.tensor) {
+            _T(memcpy(dpuGetInputTensorAddress(taskConv, CONV_INPUT_NODE), job.tensor,
+                      dpuGetInputTensorSize(taskConv, CONV_INPUT_NODE)));
+        } else {
+            _T(dpuSetInputImage2(taskConv, CONV_INPUT_NODE, job.image));
+        }
+    };
+
+    /* Keep the FC output so that the Tasks can take the next image */
+    auto getOutput = [&](DPUTask *taskFC, ClassifyJob &job) {
+        int8_t *outAddr = dpuGetOutputTensorAddress(taskFC, FC_OUTPUT_NODE);
+        int size = dpuGetOutputTensorSize(taskFC, FC_OUTPUT_NODE);
+        job.logits.assign(outAddr, outAddr + size);
+        job.scale = dpuGetOutputTensorScale(taskFC, FC_OUTPUT_NODE);
+    };
+
+    /* FC of a batch of pooled FC Tasks on the CPU, reading the weights once
+       and writing the logits into the output Tensors */
+    ConvFcExecutor::FcBatchFunc fcBatch;
+    if (!fcWeights.empty()) {
+        fcBatch = [&](DPUTask *const *taskFC, int n) {
+            vector<const int8_t *> inputs(n);
+            vector<int8_t *> outputs(n);
+            for (int i = 0; i < n; i++) {
+                inputs[i] = dpuGetInputTensorAddress(taskFC[i], FC_INPUT_NODE);
+                outputs[i] = dpuGetOutputTensorAddress(taskFC[i], FC_OUTPUT_NODE);
+            }
+            _T(fcInt8.Run(inputs.data(), n, dpuGetInputTensorScale(taskFC[0], FC_INPUT_NODE),
+                          outputs.data()));
+            return 0;
+        };
+    }
+
+    /* With overlap, the Tasks of the workers are run by a ConvFcExecutor:
+       CONV of one image runs while another one is pooled and run on FC */
+    unique_ptr<ConvFcExecutor> executor;
+    if (overlap > 0) {
+        vector<DPUTask *> convTasks, fcTasks;
+        for (auto &ctx : contexts) {
+            convTasks.push_back(ctx->task(0));
+            if ((int)fcTasks.size() < overlap) {
+                fcTasks.push_back(ctx->task(1));
+            }
+        }
+        executor.reset(new ConvFcExecutor(convTasks, fcTasks, CPUCalcAvgPool, dpuRunTask, fcBatch));
+    }
+
+    /* DPU stage, shared by the pipeline and the benchmark */
+    ClassifyPipeline::InferFunc infer = [&](int id, ClassifyJob &job) {
+        WorkerContext &ctx = *contexts[id];
+        ctx.Attach();
+
+        if (executor) {
+            /* a failed image keeps no logits, for the result stage to drop it */
+            if (executor->Run([&](DPUTask *taskConv) { setInput(taskConv, job); },
+                              [&](DPUTask *taskFC) { getOutput(taskFC, job); }) != 0) {
+                job.logits.clear();
+            }
+            return;
+        }
+
+        setInput(ctx.task(0), job);
+        _T(dpuRunTask(ctx.task(0)));
+        _T(CPUCalcAvgPool(ctx.task(0), ctx.task(1)));
+        if (!fcWeights.empty()) {
+            job.logits.resize(channel);
+            _T(fcInt8.Run(dpuGetInputTensorAddress(ctx.task(1), FC_INPUT_NODE),
+                          dpuGetInputTensorScale(ctx.task(1), FC_INPUT_NODE), job.logits.data()));
+            job.scale = fcInt8.output_scale();
+            return;
+        }
+        _T(dpuRunTask(ctx.task(1)));
+        getOutput(ctx.task(1), job);
+    };
+
+    /* Accuracy and latency over a labelled list instead of the pipeline */
+    if (!list.empty()) {
+        vector<BenchImage> samples;
+        if (!LoadBenchList(list, samples) || samples.empty()) {
+            cerr << "\nError: Not images exist in " << list << endl;
+            return;
+        }
+
+        bench.model = "resnet50";
+        bench.dir = path;
+        bench.input_size = inputSize;
+        bench.channel = channel;
+        bench.threads = threadnum;
+        bench.cache = cache.empty() ? nullptr : &tensorCache;
+
+        ClassifyBench classifyBench(bench);
+        classifyBench.Run(samples, infer);
+        classifyBench.Report();
+        if (executor) {
+            executor->Report();
+        }
+        return;
+    }
+
+    pipeline.Run(path, images, count, infer,
+        [&](ClassifyJob &job) {
+            if (argmax) {
+                _T(ClassifyArgmax(job.logits.data(), channel));
+            } else {
+                _T(ClassifyTopK(job.logits.data(), channel, job.scale, 5, top5));
+            }
+        });
+
+    pipeline.Report();
+    if (executor) {
+        executor->Report();
+    }
+}
+
+/**
+ * @brief Print usage of the sample
+ *
+ */
+void usage(const char *name) {
+    cout << "Usage: " << name << " [-d image_dir] [-n count] [-q depth] [-c cache] [-m mean] [-x batch] [-F weights] [-a] [-p]" << endl;
+    cout << "       [-b list [-w warmup] [-s seconds] [-o report] [-r record]] thread_num" << endl;
+    cout << "\t-d image_dir: run the decode/preprocess/DPU/postprocess pipeline" << endl;
+    cout << "\t              over the images, e.g. ../common/image500_640_480/" << endl;
+    cout << "\t-n count: number of images for the pipeline (default: each image once)" << endl;
+    cout << "\t-q depth: capacity of the queues between stages (default: 8)" << endl;
+    cout << "\t-c cache: take preprocessed input Tensors from a cache file built by" << endl;
+    cout << "\t          common/tools/tensor_cache_build" << endl;
+    cout << "\t-m mean: B,G,R mean of the Kernel, the one given to tensor_cache_build" << endl;
+    cout << "\t         (default: 104,117,123)" << endl;
+    cout << "\t-b list: benchmark top-1/top-5 accuracy, throughput and latency over a" << endl;
+    cout << "\t         list of \"name label\" lines, images are read from -d image_dir" << endl;
+    cout << "\t-w warmup: images run before measuring the benchmark (default: 10)" << endl;
+    cout << "\t-s seconds: measure the benchmark for a fixed duration instead of -n count" << endl;
+    cout << "\t-o report: write the benchmark results to a .json file or append them" << endl;
+    cout << "\t           to a .csv file" << endl;
+    cout << "\t-r record: record the logits of each image, for common/tools/classify_replay" << endl;
+    cout << "\t-x batch: overlap CONV of one image with pooling and FC of another," << endl;
+    cout << "\t          running FC for up to batch images at once, needs thread_num" << endl;
+    cout << "\t          of at least 2 and batch of at most thread_num" << endl;
+    cout << "\t-F weights: run FC on the CPU with INT8 weights written by" << endl;
+    cout << "\t            common/tools/fc_pack, instead of the FC Kernel; with -x," << endl;
+    cout << "\t            for the whole FC batch at once" << endl;
+    cout << "\t-a: argmax only, skip the softmax normalization" << endl;
+    cout << "\t-p: pin each DPU worker thread to its own CPU" << endl;
+}
+
 /**
  * @brief Entry for running ResNet50 neural network
  *
@@ -337,11 +539,88 @@ int main(int argc ,char** argv) {
     DPUKernel *kernelConv;
     DPUKernel *kernelFC;
 
-    if(argc == 2) {
-        threadnum = stoi(argv[1]);
+    string imagePath;
+    string cache;
+    string list;
+    BenchConfig bench;
+    int count = 0;
+    int depth = 8;
+    int overlap = 0;
+    string fcWeights;
+    bool argmax = false;
+    bool pin = false;
+    int opt;
+
+    /* Dump the per-stage latency histograms at exit and on SIGUSR1 */
+    InstallStageDump();
+
+    while ((opt = getopt(argc, argv, "d:n:q:c:m:b:w:s:o:r:x:F:ap")) != -1) {
+        switch (opt) {
+        case 'd':
+            imagePath = optarg;
+            break;
+        case 'n':
+            count = stoi(optarg);
+            break;
+        case 'q':
+            depth = stoi(optarg);
+            break;
+        case 'c':
+            cache = optarg;
+            break;
+        case 'm':
+            if (sscanf(optarg, "%f,%f,%f", &cacheMean[0], &cacheMean[1], &cacheMean[2]) != 3) {
+                usage(argv[0]);
+                exit(-1);
+            }
+            break;
+        case 'b':
+            list = optarg;
+            break;
+        case 'w':
+            bench.warmup = stoi(optarg);
+            break;
+        case 's':
+            bench.duration = stod(optarg);
+            break;
+        case 'o':
+            bench.output = optarg;
+            break;
+        case 'r':
+            bench.record = optarg;
+            break;
+        case 'x':
+            overlap = stoi(optarg);
+            break;
+        case 'F':
+            fcWeights = optarg;
+            break;
+        case 'a':
+            argmax = true;
+            break;
+        case 'p':
+            pin = true;
+            break;
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+
+    bench.count = count;
+
+    if (optind == argc - 1) {
+        threadnum = stoi(argv[optind]);
+    } else {
+        cerr << "please input thread number!" << endl;
+        usage(argv[0]);
+        exit(-1);
     }
-    else {
-        cout << "please input thread number!" << endl;
+
+    /* The executor runs one CONV Task less than there are workers */
+    if (overlap > 0 && (threadnum < 2 || overlap > threadnum)) {
+        cerr << "-x batch needs thread_num of at least 2 and batch of at most thread_num" << endl;
+        usage(argv[0]);
         exit(-1);
     }
 
@@ -349,7 +628,12 @@ int main(int argc ,char** argv) {
     kernelConv = dpuLoadKernel(KRENEL_CONV);
     kernelFC = dpuLoadKernel(KERNEL_FC);
 
-    classifyEntry(kernelConv, kernelFC);
+    if (imagePath.empty()) {
+        classifyEntry(kernelConv, kernelFC, pin);
+    } else {
+        pipelineEntry(kernelConv, kernelFC, imagePath, count, depth, argmax, pin, cache, list,
+                      bench, overlap, fcWeights);
+    }
 
     dpuDestroyKernel(kernelConv);
     dpuDestroyKernel(kernelFC);
@@ -68,8 +68,12 @@
 /* header file for DNNDK APIs */
 #include <dnndk/dnndk.h>
 
+#include "avg_pool.h"
+#include "classify_result.h"
+
 using namespace std;
 using namespace cv;
+using namespace deephi;
 
 /* 7.71GOP computation for ResNet50 Convolution layers */
 #define RESNET50_WORKLOAD_CONV (7.71f)
@@ -153,32 +157,6 @@ void LoadWords(string const &path, vector<string> &kinds) {
 }
 
 
-/**
- * @brief Get top k results according to its probability
- *
- * @param d - pointer to input data
- * @param size - size of input data
- * @param k - calculation result
- * @param vkinds - vector of kinds
- *
- * @return none
- */
-void TopK(const float *d, int size, int k, vector<string> &vkinds) {
-    assert(d && size > 0 && k > 0);
-    priority_queue<pair<float, int>> q;
-
-    for (auto i = 0; i < size; ++i) {
-        q.push(pair<float, int>(d[i], i));
-    }
-
-    for (auto i = 0; i < k; ++i) {
-        pair<float, int> ki = q.top();
-        printf("top[%d] prob = %-8f  name = %s\n", i, d[ki.second],
-        vkinds[ki.second].c_str());
-        q.pop();
-    }
-}
-
 /**
  * @brief Compute average pooling on CPU
  *
@@ -190,40 +168,20 @@ void TopK(const float *d, int size, int k, vector<string> &vkinds) {
 void CPUCalcAvgPool(DPUTask *conv, DPUTask *fc) {
     assert(conv && fc);
 
-    /* Get output Tensor to the last Node of ResNet50 CONV Task */
+    /* Get output Tensor to the last Node of CONV Task */
     DPUTensor *outTensor = dpuGetOutputTensor(conv, CONV_OUTPUT_NODE);
-    /* Get size, height, width and channel of the output Tensor */
-    int tensorSize = dpuGetTensorSize(outTensor);
     int outHeight = dpuGetTensorHeight(outTensor);
     int outWidth = dpuGetTensorWidth(outTensor);
     int outChannel = dpuGetTensorChannel(outTensor);
-
-    /* allocate memory buffer */
-    float *outBuffer = new float[tensorSize];
-
-    /* Get the input address to the first Node of FC Task */
-    int8_t *fcInput = dpuGetInputTensorAddress(fc, FC_INPUT_NODE);
-
-    /* Copy the last Node's output and convert them from IN8 to FP32 format */
-    dpuGetOutputTensorInHWCFP32(conv, CONV_OUTPUT_NODE, outBuffer, tensorSize);
-
-    /* Get scale value for the first input Node of FC task */
-    float scaleFC = dpuGetInputTensorScale(fc, FC_INPUT_NODE);
     int length = outHeight * outWidth;
-    float avg = (float)(length * 1.0f);
 
-    float sum;
-    for (int i = 0; i < outChannel; i++) {
-        sum = 0.0f;
-        for (int j = 0; j < length; j++) {
-            sum += outBuffer[outChannel * j + i];
-        }
-
-        /* compute average and set into the first input Node of FC Task */
-        fcInput[i] = (int8_t)(sum / avg * scaleFC);
-    }
-
-    delete[] outBuffer;
+    /**
+     * Pool the INT8 output in place and requantize the averages with the
+     * scales of both Tensors straight into the input Node of FC Task
+     */
+    float factor = dpuGetTensorScale(outTensor) * dpuGetInputTensorScale(fc, FC_INPUT_NODE) / length;
+    AvgPoolInt8(dpuGetTensorAddress(outTensor), length, outChannel, factor,
+                dpuGetInputTensorAddress(fc, FC_INPUT_NODE));
 }
 
 /**
@@ -254,8 +212,7 @@ void runResnet50(DPUTask *taskConv, DPUTask *taskFC) {
 
     /* Get channel count of the output Tensor for FC Task  */
     int channel = dpuGetOutputTensorChannel(taskFC, FC_OUTPUT_NODE);
-    float *softmax = new float[channel];
-    float *FCResult = new float[channel];
+    ClassifyResult top5;
     for (auto &imageName : images) {
         cout << "\nLoad image : " << imageName << endl;
         /* Load image and Set image into CONV Task with mean value */
@@ -287,18 +244,14 @@ void runResnet50(DPUTask *taskConv, DPUTask *taskFC) {
         DPUTensor *outTensor = dpuGetOutputTensor(taskFC, FC_OUTPUT_NODE);
         int8_t *outAddr = dpuGetTensorAddress(outTensor);
         float convScale=dpuGetOutputTensorScale(taskFC, FC_OUTPUT_NODE,  0);
-        int size = dpuGetOutputTensorSize(taskFC, FC_OUTPUT_NODE);
-        /* Calculate softmax on CPU and show TOP5 classification result */
-        dpuRunSoftmax(outAddr, softmax, channel, size/channel ,convScale );
-        TopK(softmax, channel, 5, kinds);
+        /* Select TOP5 on the INT8 output and show the classification result */
+        ClassifyTopK(outAddr, channel, convScale, 5, top5);
+        PrintClassifyResult(top5, kinds);
 
         /* Show the impage */
         cv::imshow("Classification of ResNet50", image);
         cv::waitKey(1);
     }
-
-    delete[] softmax;
-    delete[] FCResult;
 }
 
 /**
@@ -48,6 +48,7 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -65,6 +66,8 @@
 // Header files for DNNDK APIs
 #include <dnndk/dnndk.h>
 
+#include "frame_source.h"
+#include "reorder_buffer.h"
 #include "ssd_detector.h"
 #include "prior_boxes.h"
 
@@ -87,28 +90,9 @@ const int KEEP_TOP_K = 200;
 int num_classes = 4;
 const int TNUM = 6;
 
-// input video
-VideoCapture video;
-
-// flags for each thread
-bool is_reading = true;
-array<bool, TNUM> is_running;
-bool is_displaying = true;
-
-// comparison algorithm for priority_queue
-class Compare {
-    public:
-    bool operator()(const pair<int, Mat> &n1, const pair<int, Mat> &n2) const {
-        return n1.first > n2.first;
-    }
-};
-
-queue<pair<int, Mat>> read_queue;                                               // read queue
-priority_queue<pair<int, Mat>, vector<pair<int, Mat>>, Compare> display_queue;  // display queue
-mutex mtx_read_queue;                                                           // mutex of read queue
-mutex mtx_display_queue;                                                        // mutex of display queue
-int read_index = 0;                                                             // frame index of input video
-int display_index = 0;                                                          // frame index to display
+FrameSource video(2, 30);                              // input video, decoded 30 frames ahead
+ReorderBuffer<Mat> display_queue(30 + TNUM);           // display queue, in frame order
+atomic<int> running_num(TNUM);                         // RunSSD threads still running
 
 /**
  * @brief Create prior boxes for feature maps of one scale
@@ -155,12 +139,11 @@ void CreatePriors(vector<shared_ptr<vector<float>>> *priors) {
  * @brief Run DPU and ARM Tasks for SSD, and put image into display queue
  *
  * @param task_conv - pointer to SSD CONV Task
- * @param running - status flag of RunSSD thread
  * @param priors - pointer to prior box
  *
  * @return none
  */
-void RunSSD(DPUTask *task_conv, bool &running, vector<shared_ptr<vector<float>>> &priors) {
+void RunSSD(DPUTask *task_conv, vector<shared_ptr<vector<float>>> &priors) {
     // Initializations
     int8_t* loc =
         (int8_t*)dpuGetOutputTensorAddress(task_conv, CONV_OUTPUT_NODE_LOC);
@@ -173,26 +156,10 @@ void RunSSD(DPUTask *task_conv, bool &running, vector<shared_ptr<vector<float>>>
 
     float* conf_softmax = new float[size];
 
-    // Run detection for images in read queue
-    while (running) {
-        // Get an image from read queue
-        int index;
-        Mat img;
-        mtx_read_queue.lock();
-        if (read_queue.empty()) {
-            mtx_read_queue.unlock();
-            if (is_reading) {
-                continue;
-            } else {
-                running = false;
-                break;
-            }
-        } else {
-            index = read_queue.front().first;
-            img = read_queue.front().second;
-            read_queue.pop();
-            mtx_read_queue.unlock();
-        }
+    // Run detection for the frames of the video, already at the input size
+    int index;
+    Mat img;
+    while (video.Read(index, img)) {
 
         // Set image and run CONV Task
         dpuSetInputImage2(task_conv, (char *)CONV_INPUT_NODE, img);
@@ -231,76 +198,41 @@ void RunSSD(DPUTask *task_conv, bool &running, vector<shared_ptr<vector<float>>>
             }
         }
 
-        // Put image into display queue
-        mtx_display_queue.lock();
-        display_queue.push(make_pair(index, img));
-        mtx_display_queue.unlock();
+        // Put image into display queue, closed if the display has quit
+        if (!display_queue.Put(index, img)) {
+            break;
+        }
     }
 
     delete[] conf_softmax;
-}
 
-/**
- * @brief Read frames into read queue from a video
- *
- * @param is_reading - status flag of Read thread
- *
- * @return none
- */
-void Read(bool &is_reading) {
-    while (is_reading) {
-        Mat img;
-        if (read_queue.size() < 30) {
-            if (!video.read(img)) {
-                cout << "Video end." << endl;
-                is_reading = false;
-                break;
-            }
-            mtx_read_queue.lock();
-            read_queue.push(make_pair(read_index++, img));
-            mtx_read_queue.unlock();
-        } else {
-            usleep(20);
-        }
+    // The last thread ends the display
+    if (--running_num == 0) {
+        display_queue.Close();
     }
 }
 
 /**
  * @brief Display frames in display queue
  *
- * @param is_displaying - status flag of Display thread
- *
  * @return none
  */
-void Display(bool &is_displaying) {
+void Display() {
     Mat image(360, 480, CV_8UC3);
     imshow("Video Analysis@Deephi DPU", image);
-    while (is_displaying) {
-        mtx_display_queue.lock();
-        if (display_queue.empty()) {
-            if (any_of(is_running.begin(), is_running.end(), [](bool cond){return cond;})) {
-                mtx_display_queue.unlock();
-                usleep(20);
-            } else {
-                is_displaying = false;
-                break;
-            }
-        } else if (display_index == display_queue.top().first) {
-            // Display image
-            imshow("Video Analysis@Deephi DPU", display_queue.top().second);
-            display_index++;
-            display_queue.pop();
-            mtx_display_queue.unlock();
-            if (waitKey(1) == 'q') {
-                is_reading = false;
-                for(int i = 0; i < TNUM; ++i) {
-                    is_running[i] = false;
-                }
-                is_displaying = false;
-                break;
-            }
-        } else {
-            mtx_display_queue.unlock();
+
+    // frames in frame order, as soon as the next one is done
+    long index;
+    Mat img;
+
+    while (display_queue.Next(index, img)) {
+        // Display image
+        imshow("Video Analysis@Deephi DPU", img);
+        if (waitKey(1) == 'q') {
+            // Stop the decoder and the RunSSD threads
+            video.Close();
+            display_queue.Close();
+            return;
         }
     }
 }
@@ -333,30 +265,35 @@ int main(int argc, char** argv) {
     vector<shared_ptr<vector<float>>> priors;
     CreatePriors(&priors);
 
-    // Initializations
+    for(int i = 0; i < TNUM; ++i) {
+        task_conv[i] = dpuCreateTask(kernel_conv, 0);
+    }
+
+    // Initializations, the frames are decoded and resized to the input of
+    // the network ahead of the RunSSD threads
     string file_name = argv[1];
     cout << "Detect video: " << file_name << endl;
-    video.open(file_name);
-    if (!video.isOpened()) {
+    Size inSize(dpuGetInputTensorWidth(task_conv[0], CONV_INPUT_NODE),
+                dpuGetInputTensorHeight(task_conv[0], CONV_INPUT_NODE));
+    if (!video.Open(file_name, inSize)) {
         cout << "Failed to open video: " << file_name;
         return -1;
     }
 
     // Run DPU Tasks for SSD
     vector<thread> threads(TNUM);
-    is_running.fill(true);
     for(int i = 0; i < TNUM; ++i) {
-        task_conv[i] = dpuCreateTask(kernel_conv, 0);
-        threads[i] = thread(RunSSD, ref(task_conv[i]), ref(is_running[i]), ref(priors));
+        threads[i] = thread(RunSSD, ref(task_conv[i]), ref(priors));
     }
-    threads.push_back(thread(Read, ref(is_reading)));
-    threads.push_back(thread(Display, ref(is_displaying)));
+    threads.push_back(thread(Display));
 
-    for (int i = 0; i < 2+TNUM; ++i) {
+    for (int i = 0; i < 1+TNUM; ++i) {
         threads[i].join();
     }
 
     // Destroy DPU Tasks and Kernel and free resources
+    video.Report();
+    display_queue.Report("display");
     for(int i = 0; i < TNUM; ++i) {
         dpuDestroyTask(task_conv[i]);
     }
@@ -365,6 +302,6 @@ int main(int argc, char** argv) {
     // Detach from DPU driver and release resources
     dpuClose();
 
-    video.release();
+    video.Close();
     return 0;
 }
@@ -0,0 +1,681 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* header file OpenCV for image processing */
+#include <opencv2/opencv.hpp>
+
+/* header file for DNNDK APIs */
+#include <dnndk/dnndk.h>
+
+#include "bounded_queue.h"
+#include "dpu_scheduler.h"
+#include "infer_protocol.h"
+#include "input_quantize.h"
+#include "stage_timer.h"
+#include "task_pool.h"
+#include "tensor_handle.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/* set by SIGINT and SIGTERM */
+volatile sig_atomic_t stopping = 0;
+
+/**
+ * @brief Connection of one client and its shared slots
+ */
+struct Client {
+    int fd;
+    mutex send_mtx;
+
+    struct Kernel *kernel;
+    uint8_t *base;
+    size_t length;
+    uint32_t slots;
+    uint32_t slot_size;
+    uint32_t output_offset;
+
+    explicit Client(int sock) : fd(sock), kernel(nullptr), base(nullptr), length(0), slots(0) {}
+
+    /* requests hold a reference, so the slots stay mapped until the last
+       reply even if the client is gone */
+    ~Client() {
+        if (base) {
+            munmap(base, length);
+        }
+        close(fd);
+    }
+
+    void Reply(const InferReply &reply) {
+        lock_guard<mutex> lock(send_mtx);
+        send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+    }
+};
+
+struct Request {
+    shared_ptr<Client> client;
+    InferRequest msg;
+    steady_clock::time_point received;
+    int batch;
+};
+
+/**
+ * @brief A Kernel kept loaded by the daemon with its pool of Tasks
+ *
+ * Requests of all clients wait in one queue of at most max_pending. The
+ * batcher takes as many of them as there are idle workers, waiting up to
+ * the batch window for more to arrive once the first is there, and hands
+ * the micro-batch to the workers, each running a Task leased from the pool.
+ * The Tasks of all Kernels share the DPU cores through one DpuScheduler,
+ * each Kernel being a workload with its own priority, weight and deadline.
+ */
+struct Kernel {
+    string name;
+    string input_node;
+    string output_node;
+    int tasks;
+    float mean[3];
+    float scale;
+    int priority;
+    int weight;
+    int deadline_us;
+    int max_pending;
+
+    DPUKernel *kernel;
+    DpuScheduler *sched;
+    int workload;
+    TaskPool pool;
+    TaskTensors tensors;         // slot 0 input, slot 1 output
+    InferKernel info;
+
+    mutex mtx;
+    condition_variable cv;
+    deque<Request> pending;
+    int idle;
+    bool closed;
+    thread batcher;
+    vector<thread> workers;
+    unique_ptr<BoundedQueue<Request>> ready;
+
+    /* statistics, with mtx held */
+    long requests;
+    long batches;
+    long failed;
+    long rejected;
+    LatencyHistogram queue_ns;
+    LatencyHistogram run_ns;
+};
+
+/**
+ * @brief Parse name:input_node:output_node[:tasks[:mean_b,mean_g,mean_r[:scale
+ *        [:priority[,weight[,deadline_us]]]]]]
+ */
+bool ParseKernel(const string &spec, Kernel &k) {
+    vector<string> fields;
+    stringstream ss(spec);
+    string field;
+    while (getline(ss, field, ':')) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 3) {
+        return false;
+    }
+
+    k.name = fields[0];
+    k.input_node = fields[1];
+    k.output_node = fields[2];
+    k.tasks = (fields.size() > 3) ? atoi(fields[3].c_str()) : 2;
+    k.mean[0] = k.mean[1] = k.mean[2] = 0;
+    k.scale = 1.0f;
+    if (fields.size() > 4 &&
+        sscanf(fields[4].c_str(), "%f,%f,%f", &k.mean[0], &k.mean[1], &k.mean[2]) != 3) {
+        return false;
+    }
+    if (fields.size() > 5) {
+        k.scale = atof(fields[5].c_str());
+    }
+    k.priority = 0;
+    k.weight = 1;
+    k.deadline_us = 0;
+    if (fields.size() > 6 &&
+        sscanf(fields[6].c_str(), "%d,%d,%d", &k.priority, &k.weight, &k.deadline_us) < 1) {
+        return false;
+    }
+    return k.tasks > 0 && k.weight > 0 && k.deadline_us >= 0 && k.name.size() < INFERD_NAME_LEN;
+}
+
+/**
+ * @brief Reply to a request, with the status and times left to fill
+ */
+InferReply MakeReply(const InferRequest &msg) {
+    InferReply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.header.magic = INFERD_MAGIC;
+    reply.header.type = INFER_REPLY;
+    reply.id = msg.id;
+    reply.slot = msg.slot;
+    return reply;
+}
+
+/**
+ * @brief Run one request on a Task of the Kernel and reply to its client
+ */
+void RunRequest(Kernel &k, Request &r) {
+    Client &c = *r.client;
+    InferReply reply = MakeReply(r.msg);
+    reply.batch = r.batch;
+
+    auto start = steady_clock::now();
+    TaskLease task(k.pool, k.kernel);
+    const TensorHandle *t = k.tensors.Get(task);
+
+    uint8_t *slot = c.base + (size_t)r.msg.slot * c.slot_size;
+    int status = -1;
+    if (t) {
+        switch (r.msg.format) {
+        case INFER_TENSOR:
+            memcpy(t[0].addr, slot, t[0].size);
+            status = 0;
+            break;
+        case INFER_BGR: {
+            cv::Mat frame(r.msg.height, r.msg.width, CV_8UC3, slot, r.msg.stride);
+            status = SetInputImageFused(t[0], frame, k.mean, k.scale) ? 0 : -1;
+            break;
+        }
+        default:
+            status = -1;
+            break;
+        }
+    }
+    if (status == 0) {
+        status = k.sched->Run(k.workload, task);
+    }
+    /* the output area keeps its contents unless the run succeeded */
+    if (status == 0) {
+        memcpy(slot + c.output_offset, t[1].addr, t[1].size);
+    }
+    auto end = steady_clock::now();
+
+    reply.status = status < 0 ? -1 : 0;
+    reply.queue_us = duration_cast<microseconds>(start - r.received).count();
+    reply.run_us = duration_cast<microseconds>(end - start).count();
+    c.Reply(reply);
+
+    lock_guard<mutex> lock(k.mtx);
+    k.queue_ns.Record(duration_cast<nanoseconds>(start - r.received).count());
+    k.run_ns.Record(duration_cast<nanoseconds>(end - start).count());
+    if (reply.status < 0) {
+        k.failed++;
+    }
+    k.idle++;
+    k.cv.notify_one();
+}
+
+/**
+ * @brief Form micro-batches from the queued requests of all clients
+ */
+void RunBatcher(Kernel &k, int window_us) {
+    unique_lock<mutex> lock(k.mtx);
+    while (true) {
+        /* once closed, the pending requests still wait for an idle Task */
+        k.cv.wait(lock, [&] { return (k.closed && k.pending.empty()) || (!k.pending.empty() && k.idle > 0); });
+        if (k.pending.empty()) {
+            break;
+        }
+
+        /* give concurrent clients the window to fill the idle Tasks */
+        auto deadline = k.pending.front().received + microseconds(window_us);
+        k.cv.wait_until(lock, deadline, [&] { return k.closed || (int)k.pending.size() >= k.idle; });
+
+        int n = min((int)k.pending.size(), k.idle);
+        if (n == 0) {
+            continue;
+        }
+        vector<Request> batch;
+        for (int i = 0; i < n; i++) {
+            batch.push_back(move(k.pending.front()));
+            k.pending.pop_front();
+        }
+        k.idle -= n;
+        k.batches++;
+
+        lock.unlock();
+        for (auto &r : batch) {
+            r.batch = n;
+            k.ready->Push(move(r));
+        }
+        lock.lock();
+    }
+    k.ready->Close();
+}
+
+bool LoadKernel(Kernel &k, DpuScheduler &sched, int window_us) {
+    k.kernel = dpuLoadKernel(k.name.c_str());
+    if (!k.kernel) {
+        fprintf(stderr, "Error: Fail to load Kernel %s.\n", k.name.c_str());
+        return false;
+    }
+    k.sched = &sched;
+    k.workload = sched.AddWorkload(k.name, dpuRunTask, k.priority, k.weight, k.deadline_us);
+    if (!k.pool.Add(k.kernel, k.tasks, k.tasks, k.name)) {
+        return false;
+    }
+    k.tensors.AddInput(k.input_node);
+    k.tensors.AddOutput(k.output_node);
+
+    const TensorHandle *t;
+    {
+        TaskLease task(k.pool, k.kernel);
+        t = k.tensors.Get(task);
+    }
+    if (!t) {
+        return false;
+    }
+
+    memset(&k.info, 0, sizeof(k.info));
+    k.info.header.magic = INFERD_MAGIC;
+    k.info.header.type = INFER_KERNEL;
+    k.info.input_size = t[0].size;
+    k.info.output_size = t[1].size;
+    k.info.height = t[0].height;
+    k.info.width = t[0].width;
+    k.info.channel = t[0].channel;
+    k.info.input_scale = t[0].scale;
+    k.info.output_scale = t[1].scale;
+
+    k.idle = k.tasks;
+    k.closed = false;
+    k.requests = k.batches = k.failed = k.rejected = 0;
+    k.ready.reset(new BoundedQueue<Request>(k.tasks));
+    k.batcher = thread(RunBatcher, ref(k), window_us);
+    for (int i = 0; i < k.tasks; i++) {
+        k.workers.emplace_back([&k]() {
+            Request r;
+            while (k.ready->Pop(r)) {
+                RunRequest(k, r);
+                r.client.reset();
+            }
+        });
+    }
+
+    printf("[Inferd] %-16s tasks %d  input %dx%dx%d  output %d\n", k.name.c_str(), k.tasks,
+           k.info.height, k.info.width, k.info.channel, k.info.output_size);
+    return true;
+}
+
+void StopKernel(Kernel &k) {
+    {
+        lock_guard<mutex> lock(k.mtx);
+        k.closed = true;
+    }
+    k.cv.notify_all();
+    k.batcher.join();
+    for (auto &t : k.workers) {
+        t.join();
+    }
+
+    printf("[Inferd] %-16s requests %ld failed %ld rejected %ld batches %ld avg batch %.2f"
+           "  queue p50 %.1fus p99 %.1fus  run p50 %.1fus p99 %.1fus\n",
+           k.name.c_str(), k.requests, k.failed, k.rejected, k.batches,
+           k.batches ? (double)k.requests / k.batches : 0.0, k.queue_ns.Percentile(0.5) / 1000.0,
+           k.queue_ns.Percentile(0.99) / 1000.0, k.run_ns.Percentile(0.5) / 1000.0,
+           k.run_ns.Percentile(0.99) / 1000.0);
+    k.pool.Report();
+    k.pool.Release();
+    dpuDestroyKernel(k.kernel);
+}
+
+/**
+ * @brief Collect the file descriptors passed with a received message
+ *
+ * @return false if the control data was truncated, i.e. some were lost
+ */
+bool TakeFds(struct msghdr &mh, vector<int> &fds) {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    return !(mh.msg_flags & MSG_CTRUNC);
+}
+
+/**
+ * @brief Handle one message of a client
+ *
+ * @return false to drop the client
+ */
+bool HandleMessage(const shared_ptr<Client> &client, map<string, unique_ptr<Kernel>> &kernels) {
+    union {
+        InferHeader header;
+        InferHello hello;
+        InferAttach attach;
+        InferRequest request;
+    } msg;
+    char control[CMSG_SPACE(sizeof(int))];
+
+    struct iovec iov;
+    iov.iov_base = &msg;
+    iov.iov_len = sizeof(msg);
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = control;
+    mh.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(client->fd, &mh, MSG_CMSG_CLOEXEC);
+
+    /* the daemon keeps no descriptor past the message: the slots stay
+       mapped once the one of INFER_ATTACH is closed */
+    vector<int> fds;
+    bool complete = n >= 0 && TakeFds(mh, fds);
+    struct FdCloser {
+        vector<int> &fds;
+        ~FdCloser() {
+            for (int fd : fds) {
+                close(fd);
+            }
+        }
+    } closer{fds};
+
+    if (!complete || n < (ssize_t)sizeof(InferHeader) || msg.header.magic != INFERD_MAGIC) {
+        return false;
+    }
+
+    Client &c = *client;
+    switch (msg.header.type) {
+    case INFER_HELLO: {
+        if (n != sizeof(InferHello) || c.base) {
+            return false;
+        }
+        msg.hello.kernel[INFERD_NAME_LEN - 1] = '\0';
+        auto it = kernels.find(msg.hello.kernel);
+        InferKernel info;
+        memset(&info, 0, sizeof(info));
+        info.header.magic = INFERD_MAGIC;
+        info.header.type = INFER_KERNEL;
+        info.status = -1;
+        if (it != kernels.end()) {
+            c.kernel = it->second.get();
+            info = c.kernel->info;
+        }
+        send(c.fd, &info, sizeof(info), MSG_NOSIGNAL);
+        return true;
+    }
+
+    case INFER_ATTACH: {
+        if (fds.size() != 1 || n != sizeof(InferAttach) || !c.kernel || c.base) {
+            return false;
+        }
+        int fd = fds[0];
+
+        /* the output area must hold the output Tensor, the input area the
+           input Tensor, and the file behind fd all the slots; the sizes are
+           summed in 64 bits so that no client value can wrap them */
+        InferAttach &a = msg.attach;
+        uint64_t output_end = (uint64_t)a.output_offset + (uint32_t)c.kernel->info.output_size;
+        uint64_t length = (uint64_t)a.slots * a.slot_size;
+        struct stat st;
+        bool fits = a.slots > 0 && a.output_offset >= (uint32_t)c.kernel->info.input_size &&
+                    output_end <= a.slot_size && length <= SIZE_MAX &&
+                    fstat(fd, &st) == 0 && (uint64_t)st.st_size >= length;
+        void *base = fits ? mmap(nullptr, (size_t)length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "Error: Fail to map the slots of a client.\n");
+            return false;
+        }
+        c.base = (uint8_t *)base;
+        c.length = (size_t)length;
+        c.slots = a.slots;
+        c.slot_size = a.slot_size;
+        c.output_offset = a.output_offset;
+        return true;
+    }
+
+    case INFER_REQUEST: {
+        InferRequest &r = msg.request;
+        if (n != sizeof(InferRequest) || !c.base || r.slot >= c.slots) {
+            return false;
+        }
+        /* a frame must be of a known format and lie within the input area
+           of its slot */
+        if (r.format != INFER_TENSOR && r.format != INFER_BGR) {
+            return false;
+        }
+        if (r.format == INFER_BGR &&
+            (r.width <= 0 || r.height <= 0 || r.stride < (int64_t)r.width * 3 ||
+             (uint64_t)r.stride * r.height > c.output_offset)) {
+            return false;
+        }
+
+        /* past max_pending the client is told to retry rather than
+           queueing without bound behind a slow Kernel */
+        Kernel &k = *c.kernel;
+        bool queued;
+        {
+            lock_guard<mutex> lock(k.mtx);
+            queued = (int)k.pending.size() < k.max_pending;
+            if (queued) {
+                k.pending.push_back(Request{client, r, steady_clock::now(), 0});
+                k.requests++;
+            } else {
+                k.rejected++;
+            }
+        }
+        if (!queued) {
+            InferReply reply = MakeReply(r);
+            reply.status = INFERD_BUSY;
+            c.Reply(reply);
+            return true;
+        }
+        k.cv.notify_one();
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void Stop(int) {
+    stopping = 1;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-s socket] [-w window_us] [-q depth] [-c cores] -k kernel_spec [-k kernel_spec ...]\n", name);
+    printf("\tKeep DPU Kernels loaded and run requests of local clients\n");
+    printf("\t-s socket: path of the Unix socket (default: %s)\n", INFERD_SOCKET);
+    printf("\t-w window_us: time to wait for a micro-batch to fill (default: 500)\n");
+    printf("\t-q depth: requests queued per Kernel, more are rejected as busy (default: 64)\n");
+    printf("\t-c cores: DPU cores of the board, shared by the Kernels (default: 1)\n");
+    printf("\t-k kernel_spec: name:input_node:output_node[:tasks[:mean_b,mean_g,mean_r[:scale\n");
+    printf("\t                [:priority[,weight[,deadline_us]]]]]], mean and scale are\n");
+    printf("\t                applied to BGR frames, priority, weight and deadline to the\n");
+    printf("\t                share of the DPU cores (default tasks: 2, priority 0, weight 1)\n");
+}
+
+int main(int argc, char **argv) {
+    string path = INFERD_SOCKET;
+    int window = 500;
+    int depth = 64;
+    int cores = 1;
+    vector<string> specs;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:w:q:c:k:")) != -1) {
+        switch (opt) {
+        case 's': path = optarg; break;
+        case 'w': window = atoi(optarg); break;
+        case 'q': depth = atoi(optarg); break;
+        case 'c': cores = atoi(optarg); break;
+        case 'k': specs.push_back(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (specs.empty() || depth <= 0 || cores <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Attach to DPU driver and prepare for running */
+    dpuOpen();
+
+    DpuScheduler sched(cores);
+    map<string, unique_ptr<Kernel>> kernels;
+    for (auto &spec : specs) {
+        unique_ptr<Kernel> k(new Kernel);
+        if (!ParseKernel(spec, *k)) {
+            fprintf(stderr, "Error: Bad Kernel spec %s.\n", spec.c_str());
+            return -1;
+        }
+        k->max_pending = depth;
+        if (!LoadKernel(*k, sched, window)) {
+            return -1;
+        }
+        string name = k->name;
+        kernels[name] = move(k);
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 64) != 0) {
+        fprintf(stderr, "Error: Fail to listen on %s.\n", path.c_str());
+        return -1;
+    }
+    printf("[Inferd] listening on %s\n", path.c_str());
+
+    /* poll the listener and the clients; the workers reply directly */
+    vector<shared_ptr<Client>> clients;
+    while (!stopping) {
+        vector<struct pollfd> fds(1 + clients.size());
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < clients.size(); i++) {
+            fds[i + 1].fd = clients[i]->fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        if (poll(fds.data(), fds.size(), 200) <= 0) {
+            continue;
+        }
+
+        vector<shared_ptr<Client>> alive;
+        for (size_t i = 0; i < clients.size(); i++) {
+            short ev = fds[i + 1].revents;
+            if ((ev & POLLIN) ? HandleMessage(clients[i], kernels) : !(ev & (POLLHUP | POLLERR))) {
+                alive.push_back(clients[i]);
+            }
+        }
+        clients.swap(alive);
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                clients.push_back(make_shared<Client>(fd));
+            }
+        }
+    }
+
+    close(listener);
+    unlink(path.c_str());
+    clients.clear();
+
+    for (auto &k : kernels) {
+        StopKernel(*k.second);
+    }
+    sched.Report();
+    sched.Close();
+
+    /* Dettach from DPU driver & free resources */
+    dpuClose();
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+/*
+ * Stand-in for the part of N2Cube used by dpu_inferd, for running the
+ * daemon and its clients on a host without a DPU (make FAKE=1).
+ *
+ * Every Kernel has a 224x224x3 input Tensor and a 1000 element output
+ * Tensor. dpuRunTask() sleeps for DPU_FAKE_US microseconds (default 5000)
+ * on one of DPU_FAKE_CORES cores (default 2). Output element i is the low
+ * 7 bits of the sum of input elements i, i + 1000, i + 2000 and so on, so
+ * that clients can check that they got the output of their own input.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dnndk/dnndk.h>
+
+struct task_tensor {
+    std::vector<int8_t> data;
+    int height;
+    int width;
+    int channel;
+    float scale;
+};
+
+struct dpu_kernel {
+    std::string name;
+};
+
+struct dpu_task {
+    task_tensor input;
+    task_tensor output;
+};
+
+namespace {
+
+std::mutex mtx;
+std::condition_variable core_cv;
+int cores = -1;
+int latency_us;
+int exception_mode = N2CUBE_EXCEPTION_MODE_PRINT_AND_EXIT;
+
+int EnvInt(const char *name, int value) {
+    const char *s = getenv(name);
+    return s ? atoi(s) : value;
+}
+
+}
+
+int dpuOpen() {
+    std::lock_guard<std::mutex> lock(mtx);
+    cores = EnvInt("DPU_FAKE_CORES", 2);
+    latency_us = EnvInt("DPU_FAKE_US", 5000);
+    return 0;
+}
+
+int dpuClose() {
+    return 0;
+}
+
+int dpuSetExceptionMode(int mode) {
+    exception_mode = mode;
+    return 0;
+}
+
+int dpuGetExceptionMode() {
+    return exception_mode;
+}
+
+const char *dpuGetExceptionMessage(int error_code) {
+    return "fake N2Cube error";
+}
+
+DPUKernel *dpuLoadKernel(const char *netName) {
+    DPUKernel *kernel = new DPUKernel;
+    kernel->name = netName;
+    return kernel;
+}
+
+int dpuDestroyKernel(DPUKernel *kernel) {
+    delete kernel;
+    return 0;
+}
+
+DPUTask *dpuCreateTask(DPUKernel *kernel, int mode) {
+    DPUTask *task = new DPUTask;
+    task->input.data.resize(224 * 224 * 3);
+    task->input.height = task->input.width = 224;
+    task->input.channel = 3;
+    task->input.scale = 64;
+    task->output.data.resize(1000);
+    task->output.height = task->output.width = 1;
+    task->output.channel = 1000;
+    task->output.scale = 0.25f;
+    return task;
+}
+
+int dpuDestroyTask(DPUTask *task) {
+    delete task;
+    return 0;
+}
+
+int dpuRunTask(DPUTask *task) {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        core_cv.wait(lock, [] { return cores > 0; });
+        cores--;
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(latency_us));
+
+    std::vector<int8_t> &in = task->input.data;
+    std::vector<int8_t> &out = task->output.data;
+    std::vector<int> sum(out.size(), 0);
+    for (size_t i = 0; i < in.size(); i++) {
+        sum[i % out.size()] += in[i];
+    }
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = (int8_t)(sum[i] & 0x7f);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        cores++;
+    }
+    core_cv.notify_one();
+    return 0;
+}
+
+int dpuGetInputTensorCnt(DPUTask *task, const char *nodeName) {
+    return 1;
+}
+
+DPUTensor *dpuGetInputTensor(DPUTask *task, const char *nodeName, int idx) {
+    return &task->input;
+}
+
+int dpuGetOutputTensorCnt(DPUTask *task, const char *nodeName) {
+    return 1;
+}
+
+DPUTensor *dpuGetOutputTensor(DPUTask *task, const char *nodeName, int idx) {
+    return &task->output;
+}
+
+int dpuGetTensorSize(DPUTensor *tensor) {
+    return tensor->data.size();
+}
+
+int8_t *dpuGetTensorAddress(DPUTensor *tensor) {
+    return tensor->data.data();
+}
+
+float dpuGetTensorScale(DPUTensor *tensor) {
+    return tensor->scale;
+}
+
+int dpuGetTensorHeight(DPUTensor *tensor) {
+    return tensor->height;
+}
+
+int dpuGetTensorWidth(DPUTensor *tensor) {
+    return tensor->width;
+}
+
+int dpuGetTensorChannel(DPUTensor *tensor) {
+    return tensor->channel;
+}
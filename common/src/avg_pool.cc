@@ -0,0 +1,243 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AVGPOOL_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define AVGPOOL_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AVGPOOL_SSE2
+#endif
+
+#include "avg_pool.h"
+
+namespace deephi {
+
+/* channels pooled together in registers */
+static const int kBlock = 32;
+/* INT16 partial sums hold 256 INT8 values without overflow */
+static const int kChunk = 256;
+
+/*
+ * Reference path for the channels left over by the SIMD blocks (and for
+ * targets without SIMD); walks the rows once for up to kBlock channels.
+ */
+static void PoolBlockScalar(const int8_t *input, int length, int stride, int channel,
+                            float factor, int8_t *output) {
+    int32_t sum[kBlock] = {0};
+
+    for (int j = 0; j < length; j++) {
+        const int8_t *p = input + (long)j * stride;
+        for (int c = 0; c < channel; c++) {
+            sum[c] += p[c];
+        }
+    }
+
+    for (int c = 0; c < channel; c++) {
+        float v = std::min(std::max(sum[c] * factor, -128.0f), 127.0f);
+        output[c] = static_cast<int8_t>(v);
+    }
+}
+
+#if defined(AVGPOOL_NEON)
+
+static void PoolBlock(const int8_t *input, int length, int stride, float factor,
+                      int8_t *output) {
+    int32x4_t a0 = vdupq_n_s32(0), a1 = a0, a2 = a0, a3 = a0;
+    int32x4_t a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+
+    for (int j0 = 0; j0 < length; j0 += kChunk) {
+        int rows = std::min(kChunk, length - j0);
+        const int8_t *p = input + (long)j0 * stride;
+        int16x8_t s0 = vdupq_n_s16(0), s1 = s0, s2 = s0, s3 = s0;
+
+        for (int j = 0; j < rows; j++, p += stride) {
+            int8x16_t x0 = vld1q_s8(p);
+            int8x16_t x1 = vld1q_s8(p + 16);
+            s0 = vaddw_s8(s0, vget_low_s8(x0));
+            s1 = vaddw_s8(s1, vget_high_s8(x0));
+            s2 = vaddw_s8(s2, vget_low_s8(x1));
+            s3 = vaddw_s8(s3, vget_high_s8(x1));
+        }
+
+        a0 = vaddw_s16(a0, vget_low_s16(s0));
+        a1 = vaddw_s16(a1, vget_high_s16(s0));
+        a2 = vaddw_s16(a2, vget_low_s16(s1));
+        a3 = vaddw_s16(a3, vget_high_s16(s1));
+        a4 = vaddw_s16(a4, vget_low_s16(s2));
+        a5 = vaddw_s16(a5, vget_high_s16(s2));
+        a6 = vaddw_s16(a6, vget_low_s16(s3));
+        a7 = vaddw_s16(a7, vget_high_s16(s3));
+    }
+
+    /* vcvtq_s32_f32 truncates toward zero, vqmovn saturates */
+    float32x4_t f = vdupq_n_f32(factor);
+#define REQUANT(x) vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(x), f))
+    int16x8_t q0 = vcombine_s16(vqmovn_s32(REQUANT(a0)), vqmovn_s32(REQUANT(a1)));
+    int16x8_t q1 = vcombine_s16(vqmovn_s32(REQUANT(a2)), vqmovn_s32(REQUANT(a3)));
+    int16x8_t q2 = vcombine_s16(vqmovn_s32(REQUANT(a4)), vqmovn_s32(REQUANT(a5)));
+    int16x8_t q3 = vcombine_s16(vqmovn_s32(REQUANT(a6)), vqmovn_s32(REQUANT(a7)));
+#undef REQUANT
+    vst1q_s8(output, vcombine_s8(vqmovn_s16(q0), vqmovn_s16(q1)));
+    vst1q_s8(output + 16, vcombine_s8(vqmovn_s16(q2), vqmovn_s16(q3)));
+}
+
+#elif defined(AVGPOOL_AVX2)
+
+static void PoolBlock(const int8_t *input, int length, int stride, float factor,
+                      int8_t *output) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+
+    for (int j0 = 0; j0 < length; j0 += kChunk) {
+        int rows = std::min(kChunk, length - j0);
+        const int8_t *p = input + (long)j0 * stride;
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0;
+
+        for (int j = 0; j < rows; j++, p += stride) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            s0 = _mm256_add_epi16(s0, _mm256_cvtepi8_epi16(_mm256_castsi256_si128(x)));
+            s1 = _mm256_add_epi16(s1, _mm256_cvtepi8_epi16(_mm256_extracti128_si256(x, 1)));
+        }
+
+        a0 = _mm256_add_epi32(a0, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s0)));
+        a1 = _mm256_add_epi32(a1, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s0, 1)));
+        a2 = _mm256_add_epi32(a2, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(s1)));
+        a3 = _mm256_add_epi32(a3, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(s1, 1)));
+    }
+
+    /* _mm256_cvttps_epi32 truncates toward zero, the packs saturate */
+    __m256 f = _mm256_set1_ps(factor);
+#define REQUANT(x) _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(x), f))
+#define PACK16(x) _mm_packs_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1))
+    __m256i r0 = REQUANT(a0), r1 = REQUANT(a1), r2 = REQUANT(a2), r3 = REQUANT(a3);
+    __m128i lo = _mm_packs_epi16(PACK16(r0), PACK16(r1));
+    __m128i hi = _mm_packs_epi16(PACK16(r2), PACK16(r3));
+#undef PACK16
+#undef REQUANT
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 16), hi);
+}
+
+#elif defined(AVGPOOL_SSE2)
+
+static void PoolBlock(const int8_t *input, int length, int stride, float factor,
+                      int8_t *output) {
+    __m128i a0 = _mm_setzero_si128(), a1 = a0, a2 = a0, a3 = a0;
+    __m128i a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+
+    /* sign extension by unpacking a register with itself and shifting */
+#define WIDEN_LO8(x) _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8)
+#define WIDEN_HI8(x) _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8)
+#define WIDEN_LO16(x) _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)
+#define WIDEN_HI16(x) _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)
+    for (int j0 = 0; j0 < length; j0 += kChunk) {
+        int rows = std::min(kChunk, length - j0);
+        const int8_t *p = input + (long)j0 * stride;
+        __m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+
+        for (int j = 0; j < rows; j++, p += stride) {
+            __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16));
+            s0 = _mm_add_epi16(s0, WIDEN_LO8(x0));
+            s1 = _mm_add_epi16(s1, WIDEN_HI8(x0));
+            s2 = _mm_add_epi16(s2, WIDEN_LO8(x1));
+            s3 = _mm_add_epi16(s3, WIDEN_HI8(x1));
+        }
+
+        a0 = _mm_add_epi32(a0, WIDEN_LO16(s0));
+        a1 = _mm_add_epi32(a1, WIDEN_HI16(s0));
+        a2 = _mm_add_epi32(a2, WIDEN_LO16(s1));
+        a3 = _mm_add_epi32(a3, WIDEN_HI16(s1));
+        a4 = _mm_add_epi32(a4, WIDEN_LO16(s2));
+        a5 = _mm_add_epi32(a5, WIDEN_HI16(s2));
+        a6 = _mm_add_epi32(a6, WIDEN_LO16(s3));
+        a7 = _mm_add_epi32(a7, WIDEN_HI16(s3));
+    }
+#undef WIDEN_HI16
+#undef WIDEN_LO16
+#undef WIDEN_HI8
+#undef WIDEN_LO8
+
+    /* _mm_cvttps_epi32 truncates toward zero, the packs saturate */
+    __m128 f = _mm_set1_ps(factor);
+#define REQUANT(x) _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(x), f))
+    __m128i q0 = _mm_packs_epi32(REQUANT(a0), REQUANT(a1));
+    __m128i q1 = _mm_packs_epi32(REQUANT(a2), REQUANT(a3));
+    __m128i q2 = _mm_packs_epi32(REQUANT(a4), REQUANT(a5));
+    __m128i q3 = _mm_packs_epi32(REQUANT(a6), REQUANT(a7));
+#undef REQUANT
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), _mm_packs_epi16(q0, q1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 16), _mm_packs_epi16(q2, q3));
+}
+
+#else
+
+static void PoolBlock(const int8_t *input, int length, int stride, float factor,
+                      int8_t *output) {
+    PoolBlockScalar(input, length, stride, kBlock, factor, output);
+}
+
+#endif
+
+void AvgPoolInt8(const int8_t *input, int length, int channel, float factor,
+                 int8_t *output) {
+    int c = 0;
+    for (; c + kBlock <= channel; c += kBlock) {
+        PoolBlock(input + c, length, channel, factor, output + c);
+    }
+    if (c < channel) {
+        PoolBlockScalar(input + c, length, channel, channel - c, factor, output + c);
+    }
+}
+
+}
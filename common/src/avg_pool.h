@@ -0,0 +1,78 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_AVG_POOL_H_
+#define DEEPHI_AVG_POOL_H_
+
+#include <cstdint>
+
+namespace deephi {
+
+/*
+ * @brief AvgPoolInt8 - global average pooling of an INT8 tensor in HWC order
+ *
+ * The channel sums are accumulated in integer registers straight from the
+ * tensor memory, so no scratch buffer and no FP32 conversion of the whole
+ * tensor is needed. Each sum is requantized as trunc(sum * factor) and
+ * saturated to INT8.
+ *
+ * @param input - address of the HWC tensor, length * channel values
+ * @param length - number of pooled positions, i.e. height * width
+ * @param channel - number of channels
+ * @param factor - requantization factor, usually
+ *                 input scale * output scale / length
+ * @param output - channel INT8 results, e.g. the input Tensor of FC Task
+ *
+ * @return none
+ */
+void AvgPoolInt8(const int8_t *input, int length, int channel, float factor,
+                 int8_t *output);
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_BOUNDED_QUEUE_H_
+#define DEEPHI_BOUNDED_QUEUE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace deephi {
+
+/*
+ * class BoundedQueue: blocking FIFO with a fixed capacity joining two
+ * pipeline stages, any number of threads on each side. Push() blocks while
+ * the queue is full and Pop() blocks while it is empty; Close() lets the
+ * consumers drain what is left and then makes Pop() return false.
+ *
+ * Waiting threads sleep on a condition variable instead of polling, and
+ * are only signalled when one of them actually waits, so an uncontended
+ * Push() or Pop() costs a lock and no system call.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity_(capacity ? capacity : 1), closed_(false),
+          push_waiters_(0), pop_waiters_(0), pushes_(0), depth_sum_(0), depth_max_(0) {}
+
+    /*
+     * @brief Push - append an item, waiting for free space
+     *
+     * @return false if the queue has been closed
+     */
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!closed_ && items_.size() >= capacity_) {
+            push_waiters_++;
+            not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+            push_waiters_--;
+        }
+        if (closed_) {
+            return false;
+        }
+
+        Append(std::move(item), lock);
+        return true;
+    }
+
+    /*
+     * @brief TryPush - append an item if there is free space, without waiting
+     *
+     * @return false if the queue is full or closed, item is left untouched
+     */
+    bool TryPush(T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (closed_ || items_.size() >= capacity_) {
+            return false;
+        }
+
+        Append(std::move(item), lock);
+        return true;
+    }
+
+    /*
+     * @brief Pop - remove the oldest item, waiting for one to arrive
+     *
+     * @return false once the queue is closed and drained
+     */
+    bool Pop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!closed_ && items_.empty()) {
+            pop_waiters_++;
+            not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+            pop_waiters_--;
+        }
+        if (items_.empty()) {
+            return false;
+        }
+
+        Remove(item, lock);
+        return true;
+    }
+
+    /*
+     * @brief TryPop - remove the oldest item if there is one, without waiting
+     *
+     * @return false if the queue is empty
+     */
+    bool TryPop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (items_.empty()) {
+            return false;
+        }
+
+        Remove(item, lock);
+        return true;
+    }
+
+    /*
+     * @brief Close - mark the end of the stream and wake all waiters
+     */
+    void Close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    bool closed() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return closed_;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return items_.size();
+    }
+
+    /* average number of queued items seen by Push() */
+    double AverageDepth() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return pushes_ ? (double)depth_sum_ / pushes_ : 0.0;
+    }
+
+    /* largest number of queued items seen by Push() */
+    size_t MaxDepth() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return depth_max_;
+    }
+
+private:
+    /* append under lock and wake a consumer if one waits */
+    void Append(T &&item, std::unique_lock<std::mutex> &lock) {
+        items_.push_back(std::move(item));
+
+        /* sample the occupancy right after each push */
+        depth_sum_ += items_.size();
+        if (items_.size() > depth_max_) {
+            depth_max_ = items_.size();
+        }
+        pushes_++;
+
+        bool wake = pop_waiters_ > 0;
+        lock.unlock();
+        if (wake) {
+            not_empty_.notify_one();
+        }
+    }
+
+    /* take the oldest item under lock and wake a producer if one waits */
+    void Remove(T &item, std::unique_lock<std::mutex> &lock) {
+        item = std::move(items_.front());
+        items_.pop_front();
+
+        bool wake = push_waiters_ > 0;
+        lock.unlock();
+        if (wake) {
+            not_full_.notify_one();
+        }
+    }
+
+    const size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    int push_waiters_;
+    int pop_waiters_;
+
+    unsigned long long pushes_;
+    unsigned long long depth_sum_;
+    size_t depth_max_;
+};
+
+}
+
+#endif
@@ -0,0 +1,369 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "classify_bench.h"
+#include "classify_result.h"
+#include "image_loader.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace deephi {
+
+/*
+ * Logit record layout:
+ *   LogitRecordHeader
+ *   count x (LogitRecordEntry, channel INT8 logits)
+ */
+#define LOGIT_RECORD_MAGIC      "DPULOGIT"
+#define LOGIT_RECORD_VERSION    1
+#define LOGIT_RECORD_NAME_LEN   120
+
+struct LogitRecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t channel;
+    uint32_t reserved;
+};
+
+struct LogitRecordEntry {
+    char name[LOGIT_RECORD_NAME_LEN];
+    int32_t label;
+    float scale;
+};
+
+bool LoadBenchList(const string &file, vector<BenchImage> &images) {
+    ifstream fs(file);
+    if (!fs) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        return false;
+    }
+
+    string line;
+    while (getline(fs, line)) {
+        istringstream is(line);
+        BenchImage image;
+        if (!(is >> image.name)) {
+            continue;
+        }
+        if (!(is >> image.label)) {
+            image.label = -1;
+        }
+        images.push_back(image);
+    }
+
+    return true;
+}
+
+ClassifyBench::ClassifyBench(const BenchConfig &config)
+    : config_(config), labelled_(0), top1_(0), top5_(0), seconds_(0) {
+    config_.threads = max(config_.threads, 1);
+    config_.warmup = max(config_.warmup, 0);
+}
+
+int ClassifyBench::Run(const vector<BenchImage> &images, const ClassifyPipeline::InferFunc &infer) {
+    latency_us_.clear();
+    labelled_ = top1_ = top5_ = 0;
+    seconds_ = 0;
+    if (images.empty() || config_.channel <= 0) {
+        return 0;
+    }
+
+    int total = images.size();
+    int count = (config_.count > 0) ? config_.count : total;
+    if (!config_.record.empty()) {
+        logits_.assign((size_t)total * config_.channel, 0);
+        scales_.assign(total, 0);
+        recorded_.assign(total, 0);
+    }
+
+    atomic<int> next(0);
+    steady_clock::time_point deadline;
+
+    /* Each worker runs whole images, from decoding to the top-5 */
+    auto work = [&](int id, bool measure, WorkerStats &stats) {
+        ClassifyJob job;
+        ClassifyResult top5;
+        int i;
+        while (true) {
+            i = next++;
+            if (!measure ? i >= config_.warmup
+                : (config_.duration > 0 ? steady_clock::now() >= deadline : i >= count)) {
+                break;
+            }
+
+            auto t0 = steady_clock::now();
+            const BenchImage &image = images[i % total];
+            job.index = i;
+            job.name = image.name;
+            job.tensor = config_.cache ? config_.cache->Find(image.name) : nullptr;
+            if (!job.tensor && !config_.dir.empty()
+                && !LoadImageScaled(config_.dir + image.name, config_.input_size, job.image)) {
+                fprintf(stderr, "Error: Fail to decode %s.\n", image.name.c_str());
+                continue;
+            }
+            infer(id, job);
+            if (job.logits.empty()) {
+                fprintf(stderr, "Error: Fail to run %s on DPU.\n", image.name.c_str());
+                continue;
+            }
+            ClassifyTopK(job.logits.data(), config_.channel, job.scale, 5, top5);
+            auto t1 = steady_clock::now();
+
+            if (!measure) {
+                continue;
+            }
+            stats.latency_us.push_back(duration_cast<nanoseconds>(t1 - t0).count() / 1000.0f);
+            if (image.label >= 0) {
+                stats.labelled++;
+                stats.top1 += (top5.k > 0 && top5.index[0] == image.label);
+                stats.top5 += (find(top5.index, top5.index + top5.k, image.label)
+                               != top5.index + top5.k);
+            }
+            if (i < total && !recorded_.empty()) {
+                copy(job.logits.begin(), job.logits.begin() + config_.channel,
+                     logits_.begin() + (size_t)i * config_.channel);
+                scales_[i] = job.scale;
+                recorded_[i] = 1;
+            }
+        }
+    };
+
+    vector<WorkerStats> stats(config_.threads);
+    for (int measure = 0; measure < 2; measure++) {
+        if (!measure && config_.warmup == 0) {
+            continue;
+        }
+        next = 0;
+        auto start = steady_clock::now();
+        deadline = start + microseconds((long long)(config_.duration * 1000000));
+
+        vector<thread> workers;
+        for (int id = 0; id < config_.threads; id++) {
+            stats[id] = WorkerStats();
+            workers.emplace_back(work, id, (bool)measure, ref(stats[id]));
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        seconds_ = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000000.0;
+    }
+
+    for (auto &s : stats) {
+        latency_us_.insert(latency_us_.end(), s.latency_us.begin(), s.latency_us.end());
+        labelled_ += s.labelled;
+        top1_ += s.top1;
+        top5_ += s.top5;
+    }
+    sort(latency_us_.begin(), latency_us_.end());
+
+    if (!config_.record.empty()) {
+        WriteRecord(images);
+    }
+
+    return latency_us_.size();
+}
+
+double ClassifyBench::Percentile(double p) const {
+    if (latency_us_.empty()) {
+        return 0;
+    }
+    /* nearest rank */
+    size_t rank = (size_t)ceil(p * latency_us_.size());
+    return latency_us_[min(max(rank, (size_t)1), latency_us_.size()) - 1];
+}
+
+void ClassifyBench::Report() const {
+    size_t images = latency_us_.size();
+    double fps = (seconds_ > 0) ? images / seconds_ : 0;
+    double mean = 0;
+    for (auto l : latency_us_) {
+        mean += l;
+    }
+    mean = images ? mean / images : 0;
+    double top1 = labelled_ ? (double)top1_ / labelled_ : 0;
+    double top5 = labelled_ ? (double)top5_ / labelled_ : 0;
+    double p50 = Percentile(0.5), p90 = Percentile(0.9), p99 = Percentile(0.99);
+    double p999 = Percentile(0.999), slowest = images ? latency_us_.back() : 0;
+
+    printf("[Bench] model %s  threads %d  warmup %d  images %zu  time %.2fs  FPS %.2f\n",
+           config_.model.c_str(), config_.threads, config_.warmup, images, seconds_, fps);
+    printf("[Accuracy] labelled %ld  top1 %.4f  top5 %.4f\n", labelled_, top1, top5);
+    printf("[Latency] mean %.1fus  p50 %.1fus  p90 %.1fus  p99 %.1fus  p999 %.1fus  max %.1fus\n",
+           mean, p50, p90, p99, p999, slowest);
+
+    const string &out = config_.output;
+    if (out.empty()) {
+        return;
+    }
+
+    bool csv = out.size() >= 4 && out.compare(out.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        /* one row per run, so that runs can be collected in one file */
+        FILE *fp = fopen(out.c_str(), "a+");
+        if (!fp) {
+            fprintf(stderr, "Error: Fail to open %s.\n", out.c_str());
+            return;
+        }
+        fseek(fp, 0, SEEK_END);
+        if (ftell(fp) == 0) {
+            fprintf(fp, "model,threads,warmup,images,seconds,fps,labelled,top1,top5,"
+                        "mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+        }
+        fprintf(fp, "%s,%d,%d,%zu,%.3f,%.2f,%ld,%.4f,%.4f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                config_.model.c_str(), config_.threads, config_.warmup, images, seconds_, fps,
+                labelled_, top1, top5, mean, p50, p90, p99, p999, slowest);
+        fclose(fp);
+    } else {
+        FILE *fp = fopen(out.c_str(), "w");
+        if (!fp) {
+            fprintf(stderr, "Error: Fail to open %s.\n", out.c_str());
+            return;
+        }
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"model\": \"%s\",\n", config_.model.c_str());
+        fprintf(fp, "  \"threads\": %d,\n", config_.threads);
+        fprintf(fp, "  \"warmup\": %d,\n", config_.warmup);
+        fprintf(fp, "  \"images\": %zu,\n", images);
+        fprintf(fp, "  \"seconds\": %.3f,\n", seconds_);
+        fprintf(fp, "  \"fps\": %.2f,\n", fps);
+        fprintf(fp, "  \"labelled\": %ld,\n", labelled_);
+        fprintf(fp, "  \"top1\": %.4f,\n", top1);
+        fprintf(fp, "  \"top5\": %.4f,\n", top5);
+        fprintf(fp, "  \"latency_us\": {\"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+                    "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}\n",
+                mean, p50, p90, p99, p999, slowest);
+        fprintf(fp, "}\n");
+        fclose(fp);
+    }
+}
+
+void ClassifyBench::WriteRecord(const vector<BenchImage> &images) const {
+    FILE *fp = fopen(config_.record.c_str(), "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Fail to open %s.\n", config_.record.c_str());
+        return;
+    }
+
+    LogitRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOGIT_RECORD_MAGIC, sizeof(header.magic));
+    header.version = LOGIT_RECORD_VERSION;
+    header.count = count(recorded_.begin(), recorded_.end(), 1);
+    header.channel = config_.channel;
+    fwrite(&header, sizeof(header), 1, fp);
+
+    for (size_t i = 0; i < images.size(); i++) {
+        if (!recorded_[i]) {
+            continue;
+        }
+        LogitRecordEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        strncpy(entry.name, images[i].name.c_str(), LOGIT_RECORD_NAME_LEN - 1);
+        entry.label = images[i].label;
+        entry.scale = scales_[i];
+        fwrite(&entry, sizeof(entry), 1, fp);
+        fwrite(&logits_[i * config_.channel], 1, config_.channel, fp);
+    }
+
+    if (fclose(fp) != 0) {
+        fprintf(stderr, "Error: Fail to write %s.\n", config_.record.c_str());
+    }
+}
+
+bool LoadLogitRecord(const string &file, vector<BenchImage> &images, int &channel,
+                     vector<float> &scales, vector<int8_t> &logits) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        return false;
+    }
+
+    LogitRecordHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1
+        || memcmp(header.magic, LOGIT_RECORD_MAGIC, sizeof(header.magic)) != 0
+        || header.version != LOGIT_RECORD_VERSION || header.channel == 0) {
+        fprintf(stderr, "Error: %s is not a logit record.\n", file.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    channel = header.channel;
+    images.resize(header.count);
+    scales.resize(header.count);
+    logits.resize((size_t)header.count * channel);
+    for (uint32_t i = 0; i < header.count; i++) {
+        LogitRecordEntry entry;
+        if (fread(&entry, sizeof(entry), 1, fp) != 1
+            || fread(&logits[(size_t)i * channel], 1, channel, fp) != (size_t)channel) {
+            fprintf(stderr, "Error: %s is truncated.\n", file.c_str());
+            fclose(fp);
+            return false;
+        }
+        entry.name[LOGIT_RECORD_NAME_LEN - 1] = '\0';
+        images[i].name = entry.name;
+        images[i].label = entry.label;
+        scales[i] = entry.scale;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+}
@@ -0,0 +1,170 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_CLASSIFY_BENCH_H_
+#define DEEPHI_CLASSIFY_BENCH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "classify_pipeline.h"
+#include "tensor_cache.h"
+
+namespace deephi {
+
+/*
+ * One image of a benchmark list
+ */
+struct BenchImage {
+    std::string name;            // image file name
+    int label;                   // ground truth class, -1 if unknown
+};
+
+/*
+ * @brief LoadBenchList - read a labelled image list of "name label" lines,
+ *        e.g. an ImageNet val.txt. A line without label gets label -1.
+ *
+ * @param file - path of the list
+ * @param images - images of the list
+ *
+ * @return true on success
+ */
+bool LoadBenchList(const std::string &file, std::vector<BenchImage> &images);
+
+/*
+ * Settings of one benchmark run
+ */
+struct BenchConfig {
+    std::string model;           // model name in the report
+    std::string dir;             // image directory, empty to skip decoding
+    cv::Size input_size;         // size of the DPU input Tensor
+    int channel;                 // number of classes
+    int threads;                 // number of workers
+    int warmup;                  // images run before measuring
+    int count;                   // images to measure, 0 for each image once
+    double duration;             // seconds to measure, overrides count if > 0
+    const TensorCache *cache;    // preprocessed input Tensors, or nullptr
+    std::string output;          // report file, .json or .csv
+    std::string record;          // file to record the logits of every image
+
+    BenchConfig()
+        : channel(0), threads(1), warmup(10), count(0), duration(0), cache(nullptr) {}
+};
+
+/*
+ * class ClassifyBench: accuracy and throughput of a classifier
+ *
+ * Every worker takes the next image of the list, decodes it (or takes it
+ * from the TensorCache), runs the caller's DPU function and selects the
+ * top-5 classes, then records the latency of the whole image and whether
+ * its label is in the top-1/top-5. Images are only measured after the
+ * warmup. The logits of the first pass over the list can be recorded, and
+ * replayed on the host by common/tools/classify_replay in place of the DPU.
+ */
+class ClassifyBench {
+public:
+    explicit ClassifyBench(const BenchConfig &config);
+
+    /*
+     * @brief Run - warm up, then measure images until count or duration
+     *
+     * @param images - images of the benchmark, cycled through if needed
+     * @param infer - DPU stage, as for ClassifyPipeline
+     *
+     * @return number of images measured
+     */
+    int Run(const std::vector<BenchImage> &images, const ClassifyPipeline::InferFunc &infer);
+
+    /*
+     * @brief Report - print the results of the last Run() and write them to
+     *        config.output, as JSON or as a CSV row according to its suffix
+     */
+    void Report() const;
+
+private:
+    /* results of one worker */
+    struct WorkerStats {
+        std::vector<float> latency_us;
+        long labelled;
+        long top1;
+        long top5;
+    };
+
+    void WriteRecord(const std::vector<BenchImage> &images) const;
+    double Percentile(double p) const;
+
+    BenchConfig config_;
+    std::vector<float> latency_us_;     // sorted latencies of the measured images
+    std::vector<int8_t> logits_;        // recorded logits, channel per image
+    std::vector<float> scales_;         // recorded output Tensor scales
+    std::vector<char> recorded_;        // whether an image has been recorded
+    long labelled_;
+    long top1_;
+    long top5_;
+    double seconds_;
+};
+
+/*
+ * @brief LoadLogitRecord - read logits recorded by ClassifyBench
+ *
+ * @param file - path of the record
+ * @param images - recorded images and labels
+ * @param channel - number of classes
+ * @param scales - output Tensor scale of every image
+ * @param logits - channel INT8 logits per image
+ *
+ * @return true on success
+ */
+bool LoadLogitRecord(const std::string &file, std::vector<BenchImage> &images, int &channel,
+                     std::vector<float> &scales, std::vector<int8_t> &logits);
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "classify_cascade.h"
+
+#include <unordered_map>
+
+#include "classify_bench.h"
+#include "classify_result.h"
+
+namespace deephi {
+
+float ClassifyMargin(const int8_t *logits, int channel, float scale) {
+    ClassifyResult top2;
+    ClassifyTopK(logits, channel, scale, 2, top2);
+    if (top2.k < 2) {
+        return top2.k ? top2.prob[0] : 0.0f;
+    }
+    return top2.prob[0] - top2.prob[1];
+}
+
+ClassifyCascade::ClassifyCascade(float threshold)
+    : threshold_(threshold), images_(0), escalated_(0) {}
+
+bool ClassifyCascade::Escalate(const int8_t *logits, int channel, float scale) {
+    images_++;
+    if (ClassifyMargin(logits, channel, scale) >= threshold_) {
+        return false;
+    }
+    escalated_++;
+    return true;
+}
+
+void ClassifyCascade::Report(FILE *out) const {
+    long n = images_.load(), e = escalated_.load();
+    fprintf(out, "[Cascade] margin threshold %.3f  images %ld  escalated %ld (%.2f%%)\n",
+            threshold_, n, e, n ? e * 100.0 / n : 0.0);
+}
+
+/* outcome of one labelled image under both models */
+struct CascadeImage {
+    float margin;                // of the fast model
+    bool fast_top1, fast_top5;
+    bool accurate_top1, accurate_top5;
+};
+
+static void Hits(const int8_t *logits, int channel, float scale, int label, bool &top1,
+                 bool &top5) {
+    ClassifyResult result;
+    ClassifyTopK(logits, channel, scale, 5, result);
+    top1 = top5 = false;
+    for (int i = 0; i < result.k; i++) {
+        if (result.index[i] == label) {
+            top1 = (i == 0);
+            top5 = true;
+        }
+    }
+}
+
+bool EvaluateCascade(const std::string &fast, const std::string &accurate,
+                     const std::vector<float> &thresholds, double fast_fps,
+                     double accurate_fps, std::vector<CascadePoint> &points) {
+    std::vector<BenchImage> fastImages, accurateImages;
+    std::vector<float> fastScales, accurateScales;
+    std::vector<int8_t> fastLogits, accurateLogits;
+    int fastChannel, accurateChannel;
+
+    if (!LoadLogitRecord(fast, fastImages, fastChannel, fastScales, fastLogits) ||
+        !LoadLogitRecord(accurate, accurateImages, accurateChannel, accurateScales,
+                         accurateLogits)) {
+        return false;
+    }
+    if (fastChannel != accurateChannel) {
+        fprintf(stderr, "Error: %s has %d classes but %s has %d.\n", fast.c_str(), fastChannel,
+                accurate.c_str(), accurateChannel);
+        return false;
+    }
+
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < accurateImages.size(); i++) {
+        index[accurateImages[i].name] = i;
+    }
+
+    /* only images labelled and recorded by both models count */
+    int channel = fastChannel;
+    std::vector<CascadeImage> images;
+    for (size_t i = 0; i < fastImages.size(); i++) {
+        auto it = index.find(fastImages[i].name);
+        if (fastImages[i].label < 0 || it == index.end()) {
+            continue;
+        }
+        const int8_t *f = &fastLogits[i * channel];
+        const int8_t *a = &accurateLogits[it->second * channel];
+        CascadeImage image;
+        image.margin = ClassifyMargin(f, channel, fastScales[i]);
+        Hits(f, channel, fastScales[i], fastImages[i].label, image.fast_top1, image.fast_top5);
+        Hits(a, channel, accurateScales[it->second], fastImages[i].label, image.accurate_top1,
+             image.accurate_top5);
+        images.push_back(image);
+    }
+    if (images.empty()) {
+        fprintf(stderr, "Error: No labelled image is recorded in both %s and %s.\n",
+                fast.c_str(), accurate.c_str());
+        return false;
+    }
+
+    points.clear();
+    double n = images.size();
+    for (float threshold : thresholds) {
+        long escalated = 0, top1 = 0, top5 = 0;
+        for (auto &image : images) {
+            bool escalate = image.margin < threshold;
+            escalated += escalate;
+            top1 += escalate ? image.accurate_top1 : image.fast_top1;
+            top5 += escalate ? image.accurate_top5 : image.fast_top5;
+        }
+        CascadePoint point;
+        point.threshold = threshold;
+        point.escalation = escalated / n;
+        point.top1 = top1 / n;
+        point.top5 = top5 / n;
+        point.fps = (fast_fps > 0 && accurate_fps > 0)
+                        ? 1.0 / (1.0 / fast_fps + point.escalation / accurate_fps)
+                        : 0.0;
+        points.push_back(point);
+    }
+
+    CascadePoint alone = {1.0f, 1.0, 0.0, 0.0, accurate_fps > 0 ? accurate_fps : 0.0};
+    for (auto &image : images) {
+        alone.top1 += image.accurate_top1;
+        alone.top5 += image.accurate_top5;
+    }
+    alone.top1 /= n;
+    alone.top5 /= n;
+    points.push_back(alone);
+    return true;
+}
+
+}
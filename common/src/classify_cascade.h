@@ -0,0 +1,139 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_CLASSIFY_CASCADE_H_
+#define DEEPHI_CLASSIFY_CASCADE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace deephi {
+
+/*
+ * @brief ClassifyMargin - softmax probability of the top-1 class minus that
+ *        of the top-2 class, in [0, 1]
+ *
+ * @param logits - INT8 output of the last FC Node
+ * @param channel - number of classes
+ * @param scale - scale value of the output Tensor
+ *
+ * @return margin of the most probable class
+ */
+float ClassifyMargin(const int8_t *logits, int channel, float scale);
+
+/*
+ * class ClassifyCascade: escalate the images a fast classifier is unsure of
+ *
+ * Every image is first classified by the fast model, e.g. MobileNet. If
+ * the margin of its top-1 class is below the threshold, the image is run
+ * again on the accurate model, e.g. ResNet50, whose result is kept. Easy
+ * images then only cost the fast model. Thread-safe.
+ */
+class ClassifyCascade {
+public:
+    explicit ClassifyCascade(float threshold);
+
+    /*
+     * @brief Escalate - decide on the output of the fast model
+     *
+     * @return true if the image must be run on the accurate model
+     */
+    bool Escalate(const int8_t *logits, int channel, float scale);
+
+    float threshold() const { return threshold_; }
+    long images() const { return images_.load(); }
+    long escalated() const { return escalated_.load(); }
+
+    /* print the number of images and the escalation rate */
+    void Report(FILE *out = stdout) const;
+
+private:
+    float threshold_;
+    std::atomic<long> images_;
+    std::atomic<long> escalated_;
+};
+
+/*
+ * One threshold of a cascade evaluated on recorded logits
+ */
+struct CascadePoint {
+    float threshold;
+    double escalation;           // share of the images run on the accurate model
+    double top1;                 // accuracy of the cascade
+    double top5;
+    double fps;                  // images/s if the DPU is the bottleneck, 0 if unknown
+};
+
+/*
+ * @brief EvaluateCascade - sweep thresholds over the logits the fast and the
+ *        accurate model recorded with ClassifyBench for the same labelled
+ *        images
+ *
+ * The throughput is derived from the fps of each model alone, as every
+ * image costs 1 / fast_fps plus, if escalated, 1 / accurate_fps of DPU time.
+ *
+ * @param fast - record of the fast model
+ * @param accurate - record of the accurate model
+ * @param thresholds - margins to evaluate
+ * @param fast_fps - images/s of the fast model alone, 0 if unknown
+ * @param accurate_fps - images/s of the accurate model alone, 0 if unknown
+ * @param points - one result per threshold, then one for the accurate
+ *                 model alone, with threshold 1
+ *
+ * @return true on success
+ */
+bool EvaluateCascade(const std::string &fast, const std::string &accurate,
+                     const std::vector<float> &thresholds, double fast_fps,
+                     double accurate_fps, std::vector<CascadePoint> &points);
+
+}
+
+#endif
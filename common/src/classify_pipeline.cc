@@ -0,0 +1,232 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "classify_pipeline.h"
+#include "image_loader.h"
+
+namespace deephi {
+
+using namespace std;
+using namespace std::chrono;
+
+ClassifyPipeline::ClassifyPipeline(int dpu_threads, const cv::Size &input_size,
+                                   size_t queue_depth, int decode_threads)
+    : dpu_threads_(dpu_threads > 0 ? dpu_threads : 1),
+      decode_threads_(decode_threads > 0 ? decode_threads : 1),
+      input_size_(input_size),
+      queue_depth_(queue_depth),
+      cache_(nullptr),
+      cache_hits_(0),
+      elapsed_us_(0) {
+    const char *names[STAGE_NUM] = {"decode", "preprocess", "DPU", "postprocess"};
+    const int threads[STAGE_NUM] = {decode_threads_, 1, dpu_threads_, 1};
+    const char *queues[STAGE_NUM - 1] = {"decode->preprocess", "preprocess->DPU",
+                                         "DPU->postprocess"};
+
+    for (int i = 0; i < STAGE_NUM; i++) {
+        stages_[i].name = names[i];
+        stages_[i].threads = threads[i];
+        stages_[i].items = 0;
+        stages_[i].busy_us = 0;
+    }
+    for (int i = 0; i < STAGE_NUM - 1; i++) {
+        queues_[i].name = queues[i];
+        queues_[i].avg_depth = 0;
+        queues_[i].max_depth = 0;
+    }
+}
+
+void ClassifyPipeline::Account(StageType stage, long long busy_us) {
+    stages_[stage].items++;
+    stages_[stage].busy_us += busy_us;
+}
+
+int ClassifyPipeline::Run(const string &dir, const vector<string> &images, int count,
+                          const InferFunc &infer, const ResultFunc &result) {
+    BoundedQueue<ClassifyJob> decoded(queue_depth_);
+    BoundedQueue<ClassifyJob> ready(queue_depth_);
+    BoundedQueue<ClassifyJob> done(queue_depth_);
+    atomic<int> next(0);
+
+    for (auto &s : stages_) {
+        s.items = 0;
+        s.busy_us = 0;
+    }
+    cache_hits_ = 0;
+
+    auto start = steady_clock::now();
+
+    /* 1. decode: read images from disk, JPEGs at a reduced DCT scale; images
+          in the cache go straight to the DPU stage */
+    vector<thread> decoders;
+    for (int i = 0; i < decode_threads_; i++) {
+        decoders.emplace_back([&]() {
+            int idx;
+            while ((idx = next++) < count) {
+                auto t0 = steady_clock::now();
+                ClassifyJob job;
+                job.index = idx;
+                job.name = images[idx % images.size()];
+                job.tensor = cache_ ? cache_->Find(job.name) : nullptr;
+                if (job.tensor) {
+                    cache_hits_++;
+                    ready.Push(move(job));
+                    continue;
+                }
+
+                bool ok = DecodeImageScaled(dir + job.name, input_size_, job.image);
+                Account(STAGE_DECODE, duration_cast<microseconds>(steady_clock::now() - t0).count());
+
+                if (!ok) {
+                    fprintf(stderr, "Error: Fail to decode %s.\n", job.name.c_str());
+                    continue;
+                }
+                decoded.Push(move(job));
+            }
+        });
+    }
+
+    /* 2. preprocess: scale images to the size of DPU input Tensor */
+    thread preprocessor([&]() {
+        ClassifyJob job;
+        while (decoded.Pop(job)) {
+            auto t0 = steady_clock::now();
+            if (job.image.size() != input_size_) {
+                cv::Mat resized;
+                cv::resize(job.image, resized, input_size_);
+                job.image = resized;
+            }
+            Account(STAGE_PREPROCESS, duration_cast<microseconds>(steady_clock::now() - t0).count());
+            ready.Push(move(job));
+        }
+        ready.Close();
+    });
+
+    /* 3. DPU: one worker per set of DPU Tasks */
+    vector<thread> workers;
+    for (int i = 0; i < dpu_threads_; i++) {
+        workers.emplace_back([&, i]() {
+            ClassifyJob job;
+            while (ready.Pop(job)) {
+                auto t0 = steady_clock::now();
+                infer(i, job);
+                Account(STAGE_DPU, duration_cast<microseconds>(steady_clock::now() - t0).count());
+                done.Push(move(job));
+            }
+        });
+    }
+
+    /* 4. postprocess: softmax, top-k and result handling */
+    thread postprocessor([&]() {
+        ClassifyJob job;
+        while (done.Pop(job)) {
+            if (job.logits.empty()) {
+                fprintf(stderr, "Error: Fail to run %s on DPU.\n", job.name.c_str());
+                continue;
+            }
+            auto t0 = steady_clock::now();
+            result(job);
+            Account(STAGE_POSTPROCESS, duration_cast<microseconds>(steady_clock::now() - t0).count());
+        }
+    });
+
+    /* drain the stages in order */
+    for (auto &t : decoders) {
+        t.join();
+    }
+    decoded.Close();
+    preprocessor.join();
+    for (auto &t : workers) {
+        t.join();
+    }
+    done.Close();
+    postprocessor.join();
+
+    elapsed_us_ = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    BoundedQueue<ClassifyJob> *queues[STAGE_NUM - 1] = {&decoded, &ready, &done};
+    for (int i = 0; i < STAGE_NUM - 1; i++) {
+        queues_[i].avg_depth = queues[i]->AverageDepth();
+        queues_[i].max_depth = queues[i]->MaxDepth();
+    }
+
+    return stages_[STAGE_POSTPROCESS].items;
+}
+
+void ClassifyPipeline::Report() const {
+    long processed = stages_[STAGE_POSTPROCESS].items;
+    double seconds = elapsed_us_ / 1000000.0;
+
+    printf("[Pipeline] images %ld  time %lldus  FPS %.2f\n", processed, elapsed_us_,
+           seconds > 0 ? processed / seconds : 0.0);
+
+    /* busy is the share of the stage's thread time spent on work, and
+       capacity the rate the stage could sustain if it never waited */
+    for (auto &s : stages_) {
+        double busy = (seconds > 0) ? s.busy_us / (elapsed_us_ * (double)s.threads) : 0.0;
+        double capacity = (s.busy_us > 0) ? s.items * s.threads * 1000000.0 / s.busy_us : 0.0;
+        printf("[Stage] %-12s threads %-2d items %-6ld fps %-9.2f busy %5.1f%%  capacity %.2f fps\n",
+               s.name, s.threads, s.items.load(), seconds > 0 ? s.items / seconds : 0.0,
+               busy * 100.0, capacity);
+    }
+
+    for (auto &q : queues_) {
+        printf("[Queue] %-20s capacity %-3zu avg %-6.2f max %zu\n", q.name, queue_depth_,
+               q.avg_depth, q.max_depth);
+    }
+
+    if (cache_) {
+        printf("[Cache] hits %ld of %ld images\n", cache_hits_.load(), processed);
+    }
+}
+
+}
@@ -0,0 +1,172 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_CLASSIFY_PIPELINE_H_
+#define DEEPHI_CLASSIFY_PIPELINE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "bounded_queue.h"
+#include "tensor_cache.h"
+
+namespace deephi {
+
+/*
+ * One image flowing through the classification pipeline
+ */
+struct ClassifyJob {
+    int index;                   // sequence number of the image
+    std::string name;            // image file name
+    cv::Mat image;               // decoded image, resized by the preprocess stage
+    const int8_t *tensor;        // INT8 input Tensor from the TensorCache, or nullptr
+    std::vector<int8_t> logits;  // INT8 output of the last DPU Node, empty on failure
+    float scale;                 // scale value of the output Tensor
+};
+
+/*
+ * class ClassifyPipeline: staged classification over an image directory
+ *
+ * Images go through four stages joined by bounded queues:
+ *   decode -> preprocess -> DPU -> postprocess
+ * so that decoding of image N+2 and post-processing of image N overlap the
+ * DPU execution of image N+1. The DPU and postprocess stages are supplied by
+ * the caller; the DPU stage runs one thread per set of DPU Tasks.
+ * JPEG images are decoded at the smallest DCT scale still covering the
+ * DPU input size, so the preprocess stage only has a small resize left.
+ * Images found in a TensorCache skip decoding and preprocessing entirely,
+ * the DPU stage then copies job.tensor into the input Tensor.
+ */
+class ClassifyPipeline {
+public:
+    /* run the DPU Tasks of worker `id` for one job and fill its logits,
+       or leave them empty if the DPU fails */
+    typedef std::function<void(int id, ClassifyJob &job)> InferFunc;
+    /* consume the logits of one finished job */
+    typedef std::function<void(ClassifyJob &job)> ResultFunc;
+
+    enum StageType {
+        STAGE_DECODE,
+        STAGE_PREPROCESS,
+        STAGE_DPU,
+        STAGE_POSTPROCESS,
+        STAGE_NUM
+    };
+
+    /*
+     * @param dpu_threads - number of DPU workers, one per set of DPU Tasks
+     * @param input_size - size of the DPU input Tensor
+     * @param queue_depth - capacity of each queue between two stages
+     * @param decode_threads - number of threads decoding images
+     */
+    ClassifyPipeline(int dpu_threads, const cv::Size &input_size,
+                     size_t queue_depth = 8, int decode_threads = 2);
+
+    /*
+     * @brief UseCache - take preprocessed input Tensors from cache
+     *
+     * @param cache - cache built for the DPU input Tensor, nullptr to decode
+     *                every image
+     */
+    void UseCache(const TensorCache *cache) { cache_ = cache; }
+
+    /*
+     * @brief Run - push images through the pipeline until all are classified
+     *
+     * @param dir - directory of the images
+     * @param images - image names under dir
+     * @param count - number of images to process, cycling through images
+     * @param infer - DPU stage
+     * @param result - postprocess stage
+     *
+     * @return number of images classified
+     */
+    int Run(const std::string &dir, const std::vector<std::string> &images,
+            int count, const InferFunc &infer, const ResultFunc &result);
+
+    /*
+     * @brief Report - print throughput of every stage and queue occupancy
+     *        of the last Run()
+     */
+    void Report() const;
+
+private:
+    struct StageStats {
+        const char *name;
+        int threads;
+        std::atomic<long> items;
+        std::atomic<long long> busy_us;
+    };
+
+    struct QueueStats {
+        const char *name;
+        double avg_depth;
+        size_t max_depth;
+    };
+
+    void Account(StageType stage, long long busy_us);
+
+    int dpu_threads_;
+    int decode_threads_;
+    cv::Size input_size_;
+    size_t queue_depth_;
+    const TensorCache *cache_;
+    std::atomic<long> cache_hits_;
+
+    StageStats stages_[STAGE_NUM];
+    QueueStats queues_[STAGE_NUM - 1];
+    long long elapsed_us_;
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "classify_result.h"
+
+namespace deephi {
+
+void ClassifyTopK(const int8_t *logits, int channel, float scale, int k,
+                  ClassifyResult &result) {
+    int index[CLASSIFY_MAX_TOPK];
+    int8_t value[CLASSIFY_MAX_TOPK];
+    int hist[256] = {0};
+    int n = 0;
+
+    if (channel <= 0) {
+        result.k = 0;
+        return;
+    }
+    k = std::max(1, std::min(k, std::min(channel, CLASSIFY_MAX_TOPK)));
+
+    /* one pass: value histogram and insertion into the sorted top-k */
+    for (int i = 0; i < channel; i++) {
+        int8_t v = logits[i];
+        hist[v + 128]++;
+
+        if (n < k || v > value[n - 1]) {
+            int j = (n < k) ? n++ : n - 1;
+            for (; j > 0 && value[j - 1] < v; j--) {
+                value[j] = value[j - 1];
+                index[j] = index[j - 1];
+            }
+            value[j] = v;
+            index[j] = i;
+        }
+    }
+
+    /* normalizer relative to the largest logit, one exp() per used value */
+    int top = value[0];
+    float sum = 0.0f;
+    for (int b = 0; b <= top + 128; b++) {
+        if (hist[b]) {
+            sum += hist[b] * expf((b - 128 - top) * scale);
+        }
+    }
+
+    result.k = n;
+    for (int j = 0; j < n; j++) {
+        result.index[j] = index[j];
+        result.prob[j] = expf((value[j] - top) * scale) / sum;
+    }
+}
+
+int ClassifyArgmax(const int8_t *logits, int channel) {
+    int best = 0;
+    for (int i = 1; i < channel; i++) {
+        if (logits[i] > logits[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void PrintClassifyResult(const ClassifyResult &result,
+                         const std::vector<std::string> &kinds) {
+    for (int i = 0; i < result.k; i++) {
+        int idx = result.index[i];
+        printf("top[%d] prob = %-8f  name = %s\n", i, result.prob[i],
+               idx < (int)kinds.size() ? kinds[idx].c_str() : "");
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_CLASSIFY_RESULT_H_
+#define DEEPHI_CLASSIFY_RESULT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace deephi {
+
+/* largest k a ClassifyResult can hold */
+#define CLASSIFY_MAX_TOPK 16
+
+/*
+ * Top-k classes of one image, most probable first
+ */
+struct ClassifyResult {
+    int k;                              // number of valid entries
+    int index[CLASSIFY_MAX_TOPK];       // class index, i.e. line in words.txt
+    float prob[CLASSIFY_MAX_TOPK];      // softmax probability of the class
+};
+
+/*
+ * @brief ClassifyTopK - select the top-k classes on the INT8 logits and
+ *        compute their softmax probabilities
+ *
+ * Softmax preserves order, so the classes are selected on the INT8 values
+ * directly. The same pass builds a histogram of the 256 possible values,
+ * from which the softmax normalizer is computed with at most 256 exp().
+ * Ties keep the lower class index first. No memory is allocated.
+ *
+ * @param logits - INT8 output of the last FC Node
+ * @param channel - number of classes
+ * @param scale - scale value of the output Tensor
+ * @param k - number of classes to select, at most CLASSIFY_MAX_TOPK
+ * @param result - selected classes
+ *
+ * @return none
+ */
+void ClassifyTopK(const int8_t *logits, int channel, float scale, int k,
+                  ClassifyResult &result);
+
+/*
+ * @brief ClassifyArgmax - index of the most probable class, skipping the
+ *        softmax normalization entirely
+ *
+ * @param logits - INT8 output of the last FC Node
+ * @param channel - number of classes
+ *
+ * @return index of the largest logit, the lowest one on ties
+ */
+int ClassifyArgmax(const int8_t *logits, int channel);
+
+/*
+ * @brief PrintClassifyResult - print the selected classes with their labels
+ *
+ * @param result - classes selected by ClassifyTopK()
+ * @param kinds - labels loaded from words.txt
+ *
+ * @return none
+ */
+void PrintClassifyResult(const ClassifyResult &result,
+                         const std::vector<std::string> &kinds);
+
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "conv_fc_executor.h"
+
+using namespace std::chrono;
+
+namespace deephi {
+
+ConvFcExecutor::ConvFcExecutor(const std::vector<DPUTask *> &conv,
+                               const std::vector<DPUTask *> &fc, const PoolFunc &pool,
+                               const DpuRunFunc &run, const FcBatchFunc &fc_batch)
+    : fc_(fc), pool_(pool), run_(run), fc_batch_(fc_batch), jobs_(conv.size()),
+      free_conv_(conv.size()), convolved_(conv.size()), closed_(false),
+      conv_threads_(conv.size() > 1 ? conv.size() - 1 : 1), batches_(0), conv_busy_us_(0),
+      tail_busy_us_(0), started_(false), images_(0), elapsed_us_(0) {
+    for (auto task : conv) {
+        free_conv_.Push(task);
+    }
+    if (fc_.size() > 1 && !fc_batch_) {
+        async_.reset(new DpuAsync(run_, fc_.size(), fc_.size()));
+    }
+
+    for (int i = 0; i < conv_threads_; i++) {
+        threads_.emplace_back(&ConvFcExecutor::ConvStage, this);
+    }
+    threads_.emplace_back(&ConvFcExecutor::TailStage, this);
+}
+
+ConvFcExecutor::~ConvFcExecutor() {
+    Close();
+}
+
+int ConvFcExecutor::Run(const InputFunc &input, const OutputFunc &output) {
+    Job job = {&input, &output, nullptr, 0, false};
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) {
+            return -1;
+        }
+        if (!started_) {
+            started_ = true;
+            start_ = steady_clock::now();
+        }
+    }
+
+    if (!jobs_.Push(&job)) {
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [&] { return job.done; });
+    return job.status;
+}
+
+void ConvFcExecutor::Account(std::atomic<long long> &busy, steady_clock::time_point start) {
+    busy += duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+void ConvFcExecutor::ConvStage() {
+    Job *job;
+    while (jobs_.Pop(job)) {
+        free_conv_.Pop(job->conv);
+
+        auto start = steady_clock::now();
+        (*job->input)(job->conv);
+        job->status = run_(job->conv);
+        Account(conv_busy_us_, start);
+
+        convolved_.Push(job);
+    }
+}
+
+void ConvFcExecutor::Finish(Job *job, int status) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        job->status = status;
+        job->done = true;
+        images_++;
+        elapsed_us_ = duration_cast<microseconds>(steady_clock::now() - start_).count();
+    }
+    done_cv_.notify_all();
+}
+
+void ConvFcExecutor::TailStage() {
+    std::vector<Job *> batch(fc_.size());
+    std::vector<DpuCompletion> completions(fc_.size());
+    std::vector<DPUTask *> pooled(fc_.size());
+
+    while (convolved_.Pop(batch[0])) {
+        /* take whatever else has been convolved meanwhile, without waiting */
+        int n = 1;
+        while (n < (int)fc_.size() && convolved_.TryPop(batch[n])) {
+            n++;
+        }
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            if (batch[i]->status == 0) {
+                pool_(batch[i]->conv, fc_[i]);
+            }
+            /* the CONV Task is free again once pooled */
+            free_conv_.Push(batch[i]->conv);
+        }
+
+        if (fc_batch_) {
+            int m = 0;
+            for (int i = 0; i < n; i++) {
+                if (batch[i]->status == 0) {
+                    pooled[m++] = fc_[i];
+                }
+            }
+            int status = (m > 0) ? fc_batch_(pooled.data(), m) : 0;
+            for (int i = 0; i < n; i++) {
+                if (batch[i]->status == 0) {
+                    batch[i]->status = status;
+                }
+            }
+        } else if (n == 1) {
+            if (batch[0]->status == 0) {
+                batch[0]->status = run_(fc_[0]);
+            }
+        } else {
+            int submitted = 0;
+            for (int i = 0; i < n; i++) {
+                if (batch[i]->status == 0) {
+                    async_->Submit(fc_[i], batch[i]);
+                    submitted++;
+                }
+            }
+            int collected = 0;
+            while (collected < submitted) {
+                collected += async_->WaitMany(completions.data() + collected,
+                                              submitted - collected, submitted - collected);
+            }
+            for (int i = 0; i < collected; i++) {
+                ((Job *)completions[i].user)->status = completions[i].status;
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (batch[i]->status == 0) {
+                (*batch[i]->output)(fc_[i]);
+            }
+        }
+        Account(tail_busy_us_, start);
+        batches_++;
+
+        for (int i = 0; i < n; i++) {
+            Finish(batch[i], batch[i]->status);
+        }
+    }
+}
+
+void ConvFcExecutor::Report(FILE *out) const {
+    long images;
+    long long elapsed;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        images = images_;
+        elapsed = elapsed_us_;
+    }
+    long batches = batches_.load();
+    double seconds = elapsed / 1000000.0;
+
+    /* busy is the share of the stage's thread time spent on work */
+    fprintf(out, "[ConvFc] images %ld  time %lldus  FPS %.2f  conv threads %d busy %.1f%%"
+                 "  tail busy %.1f%%  avg FC batch %.2f\n",
+            images, elapsed, seconds > 0 ? images / seconds : 0.0, conv_threads_,
+            elapsed > 0 ? conv_busy_us_.load() * 100.0 / (elapsed * (double)conv_threads_) : 0.0,
+            elapsed > 0 ? tail_busy_us_.load() * 100.0 / elapsed : 0.0,
+            batches ? (double)images / batches : 0.0);
+}
+
+void ConvFcExecutor::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+    }
+
+    /* the CONV threads drain the jobs, then the tail drains the rest */
+    jobs_.Close();
+    for (int i = 0; i < conv_threads_; i++) {
+        threads_[i].join();
+    }
+    convolved_.Close();
+    threads_.back().join();
+    threads_.clear();
+    if (async_) {
+        async_->Close();
+    }
+}
+
+}
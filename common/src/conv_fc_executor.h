@@ -0,0 +1,176 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_CONV_FC_EXECUTOR_H_
+#define DEEPHI_CONV_FC_EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "dpu_async.h"
+
+namespace deephi {
+
+/*
+ * class ConvFcExecutor: overlap the CONV and FC Kernels of split networks
+ *
+ * ResNet50, Inception-v1 and the pose network are compiled into a CONV
+ * Kernel and a tiny FC Kernel, with the average pooling in between done on
+ * the CPU. Run in sequence, the DPU idles while the CPU pools and each FC
+ * run waits for the whole CONV to finish. The executor runs them as two
+ * stages: CONV threads run the CONV Tasks while a tail thread pools and
+ * runs FC for the images whose CONV is done, so that CONV of image N+1
+ * overlaps pooling and FC of image N. Callers block in Run() until their
+ * image is finished, so several concurrent callers keep both stages busy.
+ *
+ * With more than one FC Task the tail takes up to that many images whose
+ * CONV is done, pools each into its own FC Task and submits them together
+ * through DpuAsync, waiting once for the batch. N2Cube has no batch
+ * dimension, so each FC still runs as its own Task, but the launches
+ * overlap and the tail wakes up once per batch instead of once per image.
+ * Given a batch function, the tail instead hands it the FC Tasks of the
+ * whole batch in one call, e.g. FcInt8 computing the logits of up to four
+ * images on the CPU for one read of the weights; the FC Tasks then only
+ * hold the pooled inputs and the logits.
+ *
+ * The Tasks are created and destroyed by the caller.
+ */
+class ConvFcExecutor {
+public:
+    /* set the input of the CONV Task */
+    typedef std::function<void(DPUTask *conv)> InputFunc;
+    /* pool the output of the CONV Task into the input of the FC Task */
+    typedef std::function<void(DPUTask *conv, DPUTask *fc)> PoolFunc;
+    /* read the output of the FC Task */
+    typedef std::function<void(DPUTask *fc)> OutputFunc;
+    /* run the FC of n pooled FC Tasks at once, return 0 or the failure */
+    typedef std::function<int(DPUTask *const *fc, int n)> FcBatchFunc;
+
+    /*
+     * @param conv - CONV Tasks: one per CONV thread, plus one for the tail
+     *               to pool from while the CONV threads run
+     * @param fc - FC Tasks, i.e. the largest FC batch
+     * @param pool - pooling between the two Kernels, e.g. CPUCalcAvgPool
+     * @param run - function running one Task, dpuRunTask or a FakeDpuRun
+     * @param fc_batch - FC of a batch in place of running the FC Tasks,
+     *                   empty to run them
+     */
+    ConvFcExecutor(const std::vector<DPUTask *> &conv, const std::vector<DPUTask *> &fc,
+                   const PoolFunc &pool, const DpuRunFunc &run,
+                   const FcBatchFunc &fc_batch = FcBatchFunc());
+    ~ConvFcExecutor();
+
+    ConvFcExecutor(const ConvFcExecutor &) = delete;
+    ConvFcExecutor &operator=(const ConvFcExecutor &) = delete;
+
+    /*
+     * @brief Run - run one image through CONV, pooling and FC, waiting for
+     *        it. input and output are called on the executor's threads.
+     *
+     * @return 0, or the failing return value of the run function
+     */
+    int Run(const InputFunc &input, const OutputFunc &output);
+
+    /* print images, busy time of both stages and the average FC batch */
+    void Report(FILE *out = stdout) const;
+
+    /* finish the queued images and stop the threads */
+    void Close();
+
+private:
+    struct Job {
+        const InputFunc *input;
+        const OutputFunc *output;
+        DPUTask *conv;
+        int status;
+        bool done;
+    };
+
+    void ConvStage();
+    void TailStage();
+    void Finish(Job *job, int status);
+    void Account(std::atomic<long long> &busy, std::chrono::steady_clock::time_point start);
+
+    std::vector<DPUTask *> fc_;
+    PoolFunc pool_;
+    DpuRunFunc run_;
+    FcBatchFunc fc_batch_;
+    std::unique_ptr<DpuAsync> async_;       // for FC batches run as Tasks only
+
+    BoundedQueue<Job *> jobs_;
+    BoundedQueue<DPUTask *> free_conv_;
+    BoundedQueue<Job *> convolved_;
+    std::vector<std::thread> threads_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable done_cv_;
+    bool closed_;
+
+    int conv_threads_;
+    std::atomic<long> batches_;
+    std::atomic<long long> conv_busy_us_;
+    std::atomic<long long> tail_busy_us_;
+
+    /* guarded by mtx_ */
+    bool started_;
+    std::chrono::steady_clock::time_point start_;
+    long images_;
+    long long elapsed_us_;
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "detections.h"
+
+namespace deephi {
+
+Detections::Detections(int classes) : classes_(0) {
+    set_classes(classes);
+}
+
+void Detections::set_classes(int classes) {
+    clear();
+    classes_ = classes;
+    class_score_.resize(classes);
+}
+
+void Detections::clear() {
+    for (auto &c : coord_) {
+        c.clear();
+    }
+    score_.clear();
+    label_.clear();
+    for (auto &s : class_score_) {
+        s.clear();
+    }
+}
+
+void Detections::reserve(size_t n) {
+    for (auto &c : coord_) {
+        c.reserve(n);
+    }
+    score_.reserve(n);
+    label_.reserve(n);
+    for (auto &s : class_score_) {
+        s.reserve(n);
+    }
+}
+
+size_t Detections::Add(float c0, float c1, float c2, float c3, float score, int label) {
+    coord_[0].push_back(c0);
+    coord_[1].push_back(c1);
+    coord_[2].push_back(c2);
+    coord_[3].push_back(c3);
+    score_.push_back(score);
+    label_.push_back(label);
+    for (auto &s : class_score_) {
+        s.push_back(0);
+    }
+    return score_.size() - 1;
+}
+
+size_t Detections::Add(const Detections &from, size_t i, int label) {
+    size_t n = Add(from.coord_[0][i], from.coord_[1][i], from.coord_[2][i], from.coord_[3][i],
+                   from.score_[i], label);
+    for (int k = 0; k < classes_ && k < from.classes_; k++) {
+        class_score_[k][n] = from.class_score_[k][i];
+    }
+    return n;
+}
+
+}
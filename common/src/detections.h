@@ -0,0 +1,117 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_DETECTIONS_H_
+#define DEEPHI_DETECTIONS_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace deephi {
+
+/*
+ * class Detections: the candidate or final boxes of one frame, as a
+ * structure of arrays
+ *
+ * Every box has four coordinates, a score, a class label and optionally
+ * one score per class. The meaning of the coordinates is up to the model:
+ * center and size for YOLO, corners for DenseBox. Each field is one
+ * contiguous array, so IoU loops over all boxes vectorize, and clear()
+ * keeps the memory: a Detections reused for every frame stops allocating
+ * once it has held the largest frame.
+ */
+class Detections {
+public:
+    explicit Detections(int classes = 0);
+
+    /* number of per-class scores of every box; clears the boxes */
+    void set_classes(int classes);
+    int classes() const { return classes_; }
+
+    size_t size() const { return score_.size(); }
+    bool empty() const { return score_.empty(); }
+
+    /* remove all boxes, keeping the memory */
+    void clear();
+    void reserve(size_t n);
+
+    /*
+     * @brief Add - append a box with zero class scores
+     *
+     * @return index of the box
+     */
+    size_t Add(float c0, float c1, float c2, float c3, float score, int label = -1);
+
+    /* append a copy of box i of another Detections with the given label */
+    size_t Add(const Detections &from, size_t i, int label);
+
+    /* coordinate k, 0 to 3, of every box */
+    float *coord(int k) { return coord_[k].data(); }
+    const float *coord(int k) const { return coord_[k].data(); }
+
+    float *score() { return score_.data(); }
+    const float *score() const { return score_.data(); }
+
+    int *label() { return label_.data(); }
+    const int *label() const { return label_.data(); }
+
+    /* score of class k of every box */
+    float *class_score(int k) { return class_score_[k].data(); }
+    const float *class_score(int k) const { return class_score_[k].data(); }
+
+private:
+    int classes_;
+    std::vector<float> coord_[4];
+    std::vector<float> score_;
+    std::vector<int> label_;
+    std::vector<std::vector<float>> class_score_;
+};
+
+}
+
+#endif
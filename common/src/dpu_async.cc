@@ -0,0 +1,197 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <chrono>
+#include <cstdlib>
+
+#include "dpu_async.h"
+
+namespace deephi {
+
+FakeDpuRun::FakeDpuRun(int latency_us, int jitter_us, int cores)
+    : latency_us_(latency_us), jitter_us_(jitter_us), state_(new State) {
+    state_->free = cores > 0 ? cores : 1;
+    state_->seed = 1;
+}
+
+int FakeDpuRun::operator()(DPUTask *) {
+    int us = latency_us_;
+    {
+        std::unique_lock<std::mutex> lock(state_->mtx);
+        state_->cv.wait(lock, [this] { return state_->free > 0; });
+        state_->free--;
+        if (jitter_us_ > 0) {
+            us += rand_r(&state_->seed) % (jitter_us_ + 1);
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        state_->free++;
+    }
+    state_->cv.notify_one();
+    return 0;
+}
+
+DpuAsync::DpuAsync(const DpuRunFunc &run, int cores, size_t depth)
+    : run_(run), submissions_(depth), next_ticket_(1), pending_(0), closed_(false) {
+    for (int i = 0; i < (cores > 0 ? cores : 1); i++) {
+        runners_.emplace_back(&DpuAsync::Runner, this);
+    }
+}
+
+DpuAsync::~DpuAsync() {
+    Close();
+}
+
+uint64_t DpuAsync::Submit(DPUTask *task, void *user) {
+    uint64_t ticket = next_ticket_++;
+    Submission s;
+    s.completion.ticket = ticket;
+    s.completion.task = task;
+    s.completion.user = user;
+    s.completion.status = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) {
+            return 0;
+        }
+        pending_++;
+    }
+
+    if (!submissions_.Push(std::move(s))) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        pending_--;
+        return 0;
+    }
+    return ticket;
+}
+
+std::future<int> DpuAsync::SubmitFuture(DPUTask *task) {
+    Submission s;
+    s.completion.ticket = next_ticket_++;
+    s.completion.task = task;
+    s.completion.user = nullptr;
+    s.completion.status = 0;
+    s.promise = std::make_shared<std::promise<int>>();
+
+    std::future<int> future = s.promise->get_future();
+    std::shared_ptr<std::promise<int>> promise = s.promise;
+    if (!submissions_.Push(std::move(s))) {
+        promise->set_value(-1);
+    }
+    return future;
+}
+
+void DpuAsync::Runner() {
+    Submission s;
+    while (submissions_.Pop(s)) {
+        s.completion.status = run_(s.completion.task);
+
+        if (s.promise) {
+            s.promise->set_value(s.completion.status);
+            s.promise.reset();
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            done_.push_back(s.completion);
+        }
+        /* waiters may ask for different minimums: wake them all so that
+           the one whose minimum is reached is not passed over */
+        done_cv_.notify_all();
+    }
+}
+
+bool DpuAsync::Wait(DpuCompletion &completion) {
+    return WaitMany(&completion, 1, 1) == 1;
+}
+
+int DpuAsync::WaitMany(DpuCompletion *completions, int max, int min) {
+    min = min < 1 ? 1 : (min > max ? max : min);
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    done_cv_.wait(lock, [&] {
+        return (int)done_.size() >= min || (int)done_.size() == pending_;
+    });
+
+    int n = 0;
+    while (n < max && !done_.empty()) {
+        completions[n++] = done_.front();
+        done_.pop_front();
+    }
+    pending_ -= n;
+    return n;
+}
+
+int DpuAsync::pending() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return pending_;
+}
+
+void DpuAsync::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+    }
+
+    submissions_.Close();
+    for (auto &t : runners_) {
+        t.join();
+    }
+    runners_.clear();
+}
+
+}
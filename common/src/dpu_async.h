@@ -0,0 +1,187 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_DPU_ASYNC_H_
+#define DEEPHI_DPU_ASYNC_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+/* as in n2cube.h, so that hosts without DNNDK can use the fake backend */
+struct dpu_task;
+typedef struct dpu_task DPUTask;
+
+namespace deephi {
+
+/* run one DPU Task to completion, e.g. dpuRunTask() */
+typedef std::function<int(DPUTask *task)> DpuRunFunc;
+
+/*
+ * class FakeDpuRun: stand-in for dpuRunTask() on hosts without a DPU
+ *
+ * Every call occupies one of `cores` fake DPU cores for latency_us, plus
+ * a uniform random jitter of up to jitter_us, and returns 0. Calls beyond
+ * the number of cores wait for a free one, as on the real DPU.
+ */
+class FakeDpuRun {
+public:
+    FakeDpuRun(int latency_us, int jitter_us = 0, int cores = 1);
+    int operator()(DPUTask *task);
+
+private:
+    struct State {
+        std::mutex mtx;
+        std::condition_variable cv;
+        int free;
+        unsigned seed;
+    };
+
+    int latency_us_;
+    int jitter_us_;
+    std::shared_ptr<State> state_;     // shared by the copies in DpuRunFunc
+};
+
+/*
+ * Result of one asynchronous DPU Task run
+ */
+struct DpuCompletion {
+    uint64_t ticket;             // returned by DpuAsync::Submit()
+    DPUTask *task;
+    void *user;                  // user pointer given to Submit()
+    int status;                  // return value of the run function
+};
+
+/*
+ * class DpuAsync: asynchronous submission of DPU Tasks
+ *
+ * The N2Cube API only offers the blocking dpuRunTask(), so DpuAsync runs
+ * Tasks on one runner thread per DPU core. Callers submit Tasks without
+ * blocking on them and collect the results from a completion queue, in
+ * completion order, or through a std::future. A single CPU thread can then
+ * keep all DPU cores busy instead of parking one thread per Task.
+ * A Task must not be submitted again before its completion is collected.
+ */
+class DpuAsync {
+public:
+    /*
+     * @param run - function running one Task, dpuRunTask or a FakeDpuRun
+     * @param cores - number of runner threads, i.e. DPU cores to keep busy
+     * @param depth - submissions queued before Submit() blocks
+     */
+    DpuAsync(const DpuRunFunc &run, int cores, size_t depth = 64);
+    ~DpuAsync();
+
+    /*
+     * @brief Submit - queue a Task, its completion goes to the completion
+     *        queue
+     *
+     * @return ticket of the run, 0 if DpuAsync is closed
+     */
+    uint64_t Submit(DPUTask *task, void *user = nullptr);
+
+    /*
+     * @brief SubmitFuture - queue a Task, its completion goes to the future
+     *        instead of the completion queue
+     */
+    std::future<int> SubmitFuture(DPUTask *task);
+
+    /*
+     * @brief Wait - collect the next completion, waiting for it
+     *
+     * @return false if no submitted Task is left to complete
+     */
+    bool Wait(DpuCompletion &completion);
+
+    /*
+     * @brief WaitMany - collect between min and max completions at once;
+     *        any number of threads may wait together
+     *
+     * @return number of completions, less than min only when no submitted
+     *         Task is left to complete
+     */
+    int WaitMany(DpuCompletion *completions, int max, int min = 1);
+
+    /* Tasks submitted to the completion queue and not collected yet */
+    int pending() const;
+
+    /* wait for the submitted Tasks and stop the runners */
+    void Close();
+
+private:
+    struct Submission {
+        DpuCompletion completion;
+        std::shared_ptr<std::promise<int>> promise;
+    };
+
+    void Runner();
+
+    DpuRunFunc run_;
+    BoundedQueue<Submission> submissions_;
+    std::vector<std::thread> runners_;
+    std::atomic<uint64_t> next_ticket_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable done_cv_;
+    std::deque<DpuCompletion> done_;
+    int pending_;
+    bool closed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <future>
+
+#include "dpu_scheduler.h"
+
+using namespace std::chrono;
+
+namespace deephi {
+
+/* weight of a new run time in the moving average */
+static const double kRunAlpha = 0.125;
+
+DpuScheduler::DpuScheduler(int cores)
+    : cores_(cores > 0 ? cores : 1), start_(steady_clock::now()), vclock_(0), queued_(0),
+      closed_(false) {
+    for (int i = 0; i < cores_; i++) {
+        runners_.emplace_back(&DpuScheduler::Runner, this);
+    }
+}
+
+DpuScheduler::~DpuScheduler() {
+    Close();
+}
+
+int DpuScheduler::AddWorkload(const std::string &name, const DpuRunFunc &run, int priority,
+                              int weight, int deadline_us) {
+    std::unique_ptr<Workload> w(new Workload);
+    w->name = name;
+    w->run = run;
+    w->priority = priority;
+    w->weight = weight > 0 ? weight : 1;
+    w->deadline_us = deadline_us > 0 ? deadline_us : 0;
+    w->vtime = 0;
+    w->run_us = 0;
+    w->runs = w->missed = 0;
+    w->busy_us = 0;
+    w->delay.reset(new LatencyHistogram);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    workloads_.push_back(std::move(w));
+    return workloads_.size() - 1;
+}
+
+bool DpuScheduler::Submit(int workload, DPUTask *task, const DpuDoneFunc &done) {
+    Job job;
+    job.task = task;
+    job.done = done;
+    job.submit = steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_ || workload < 0 || workload >= (int)workloads_.size()) {
+            return false;
+        }
+
+        Workload &w = *workloads_[workload];
+        job.deadline = job.submit + microseconds(w.deadline_us);
+
+        /* a workload coming back from idle starts at the current virtual
+           time instead of spending the credit it built up meanwhile */
+        if (w.queue.empty()) {
+            w.vtime = std::max(w.vtime, vclock_);
+        }
+        w.queue.push_back(std::move(job));
+        queued_++;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+int DpuScheduler::Run(int workload, DPUTask *task) {
+    std::shared_ptr<std::promise<int>> promise = std::make_shared<std::promise<int>>();
+    std::future<int> future = promise->get_future();
+
+    if (!Submit(workload, task, [promise](int status) { promise->set_value(status); })) {
+        return -1;
+    }
+    return future.get();
+}
+
+int DpuScheduler::Pick(TimePoint now) {
+    int best = -1;
+    int urgent = -1;
+
+    for (int i = 0; i < (int)workloads_.size(); i++) {
+        Workload &w = *workloads_[i];
+        if (w.queue.empty()) {
+            continue;
+        }
+
+        if (best >= 0 && w.priority < workloads_[best]->priority) {
+            continue;
+        }
+        if (best < 0 || w.priority > workloads_[best]->priority) {
+            /* a new highest priority, drop the choices made below it */
+            best = i;
+            urgent = -1;
+        } else if (w.vtime < workloads_[best]->vtime) {
+            best = i;
+        }
+
+        /* urgent once the slack left is no more than one run */
+        if (w.deadline_us > 0) {
+            const Job &job = w.queue.front();
+            if (job.deadline - now <= microseconds((long)w.run_us) &&
+                (urgent < 0 || job.deadline < workloads_[urgent]->queue.front().deadline)) {
+                urgent = i;
+            }
+        }
+    }
+
+    return urgent >= 0 ? urgent : best;
+}
+
+void DpuScheduler::Runner() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        cv_.wait(lock, [this] { return queued_ > 0 || closed_; });
+        if (queued_ == 0) {
+            return;
+        }
+
+        TimePoint now = steady_clock::now();
+        Workload &w = *workloads_[Pick(now)];
+        Job job = std::move(w.queue.front());
+        w.queue.pop_front();
+        queued_--;
+
+        /* charge the expected run time now, so that other cores see it,
+           and correct it once the run is over */
+        double charged = std::max(w.run_us, 1.0) / w.weight;
+        vclock_ = w.vtime;
+        w.vtime += charged;
+        w.delay->Record(duration_cast<nanoseconds>(now - job.submit).count());
+
+        lock.unlock();
+        int status = w.run(job.task);
+        TimePoint end = steady_clock::now();
+        if (job.done) {
+            job.done(status);
+        }
+        lock.lock();
+
+        double us = duration_cast<nanoseconds>(end - now).count() / 1000.0;
+        w.run_us = (w.runs == 0) ? us : w.run_us + kRunAlpha * (us - w.run_us);
+        w.vtime += us / w.weight - charged;
+        w.busy_us += us;
+        w.runs++;
+        if (w.deadline_us > 0 && end > job.deadline) {
+            w.missed++;
+        }
+    }
+}
+
+void DpuScheduler::Report(FILE *fp) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    double elapsed = duration_cast<microseconds>(steady_clock::now() - start_).count();
+    double capacity = elapsed * cores_;
+
+    for (auto &p : workloads_) {
+        const Workload &w = *p;
+        fprintf(fp, "[Sched] %-16s prio %-3d weight %-3d runs %-8ld queue avg %9.1fus p99 %9.1fus "
+                "max %9.1fus  share %5.1f%%",
+                w.name.c_str(), w.priority, w.weight, w.runs, w.delay->Mean() / 1000.0,
+                w.delay->Percentile(0.99) / 1000.0, w.delay->max() / 1000.0,
+                capacity > 0 ? 100.0 * w.busy_us / capacity : 0.0);
+        if (w.deadline_us > 0) {
+            fprintf(fp, "  deadline %dus missed %ld", w.deadline_us, w.missed);
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+void DpuScheduler::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+    }
+
+    cv_.notify_all();
+    for (auto &t : runners_) {
+        t.join();
+    }
+    runners_.clear();
+}
+
+}
@@ -0,0 +1,178 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_DPU_SCHEDULER_H_
+#define DEEPHI_DPU_SCHEDULER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dpu_async.h"
+#include "stage_timer.h"
+
+namespace deephi {
+
+/* called on a runner thread with the status of the run */
+typedef std::function<void(int status)> DpuDoneFunc;
+
+/*
+ * class DpuScheduler: DPU cores shared by several workloads, e.g. bulk
+ * classification beside real-time detection
+ *
+ * Each workload has its own run function, usually dpuRunTask() for Tasks
+ * of its Kernel or a FakeDpuRun with the Kernel's latency. One runner
+ * thread per core takes the next Task as follows:
+ *  - a higher priority always goes first;
+ *  - within a priority, a Task whose deadline would be missed unless it
+ *    starts now goes first, earliest deadline first;
+ *  - otherwise workloads share the cores in proportion to their weights,
+ *    by start-time fair queueing on the measured run times, so that a
+ *    workload idle for a while does not get the cores to itself after.
+ * Report() prints the queueing delay, share of the cores and deadline
+ * misses of each workload.
+ */
+class DpuScheduler {
+public:
+    explicit DpuScheduler(int cores);
+    ~DpuScheduler();
+
+    DpuScheduler(const DpuScheduler &) = delete;
+    DpuScheduler &operator=(const DpuScheduler &) = delete;
+
+    /*
+     * @brief AddWorkload - declare a workload, before any Submit()
+     *
+     * @param name - name in Report()
+     * @param run - function running one Task of the workload
+     * @param priority - higher priorities are always served first
+     * @param weight - share of the cores within a priority
+     * @param deadline_us - time from Submit() by which a run should be
+     *                      complete, 0 for none
+     *
+     * @return id of the workload
+     */
+    int AddWorkload(const std::string &name, const DpuRunFunc &run, int priority = 0,
+                    int weight = 1, int deadline_us = 0);
+
+    /*
+     * @brief Submit - queue a Task of a workload
+     *
+     * @param done - called after the run, may be empty
+     *
+     * @return false if the scheduler is closed
+     */
+    bool Submit(int workload, DPUTask *task, const DpuDoneFunc &done);
+
+    /*
+     * @brief Run - queue a Task and wait for its run, in place of
+     *        dpuRunTask()
+     *
+     * @return status of the run, -1 if the scheduler is closed
+     */
+    int Run(int workload, DPUTask *task);
+
+    /* print per workload runs, queueing delay, share and deadline misses */
+    void Report(FILE *fp = stdout) const;
+
+    /* run the queued Tasks and stop the runners */
+    void Close();
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Job {
+        DPUTask *task;
+        DpuDoneFunc done;
+        TimePoint submit;
+        TimePoint deadline;
+    };
+
+    struct Workload {
+        std::string name;
+        DpuRunFunc run;
+        int priority;
+        int weight;
+        int deadline_us;
+
+        std::deque<Job> queue;
+        double vtime;            // virtual start time of the next run
+        double run_us;           // moving average of the run time
+
+        long runs;
+        long missed;
+        double busy_us;
+        std::unique_ptr<LatencyHistogram> delay;
+    };
+
+    /* index of the workload to serve next, -1 if none; with mtx_ held */
+    int Pick(TimePoint now);
+    void Runner();
+
+    int cores_;
+    std::vector<std::unique_ptr<Workload>> workloads_;
+    std::vector<std::thread> runners_;
+    TimePoint start_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    double vclock_;              // virtual time of the last run started
+    int queued_;
+    bool closed_;
+};
+
+}
+
+#endif
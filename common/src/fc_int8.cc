@@ -0,0 +1,288 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FCINT8_NEON
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define FCINT8_AVX2
+#endif
+
+#include "fc_int8.h"
+
+namespace deephi {
+
+/* magic of the weight file, padded to 8 bytes */
+static const char kMagic[8] = {'F', 'C', 'I', 'N', 'T', '8', 0, 0};
+
+/* inputs multiplied with one pass over a weight row */
+static const int kBatch = 4;
+
+struct FcInt8Header {
+    char magic[8];
+    int32_t input_size;
+    int32_t output_size;
+    float output_scale;
+    int32_t reserved;
+};
+
+#if defined(FCINT8_NEON)
+
+static inline int32_t HorizontalSum(int32x4_t v) {
+#if defined(__aarch64__)
+    return vaddvq_s32(v);
+#else
+    int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    return vget_lane_s32(vpadd_s32(s, s), 0);
+#endif
+}
+
+/*
+ * Dot products of one weight row with B inputs. Weights are within
+ * [-127, 127], so two INT8 products always fit the INT16 lanes of vmlal
+ * before vpadal widens them into INT32.
+ */
+template <int B>
+static void DotRow(const int8_t *w, const int8_t *const *x, int n, int32_t *acc) {
+    int32x4_t a[B];
+    for (int b = 0; b < B; b++) {
+        a[b] = vdupq_n_s32(0);
+    }
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t wv = vld1q_s8(w + i);
+        for (int b = 0; b < B; b++) {
+            int8x16_t xv = vld1q_s8(x[b] + i);
+            int16x8_t p = vmull_s8(vget_low_s8(wv), vget_low_s8(xv));
+            p = vmlal_s8(p, vget_high_s8(wv), vget_high_s8(xv));
+            a[b] = vpadalq_s16(a[b], p);
+        }
+    }
+
+    for (int b = 0; b < B; b++) {
+        int32_t sum = HorizontalSum(a[b]);
+        for (int j = i; j < n; j++) {
+            sum += w[j] * x[b][j];
+        }
+        acc[b] = sum;
+    }
+}
+
+#elif defined(FCINT8_AVX2)
+
+static inline int32_t HorizontalSum(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+/*
+ * Dot products of one weight row with B inputs. maddubs multiplies unsigned
+ * by signed bytes, so |x| is multiplied by w carrying the sign of x; with
+ * weights within [-127, 127] neither the sign transfer nor the INT16 pair
+ * sums can overflow.
+ */
+template <int B>
+static void DotRow(const int8_t *w, const int8_t *const *x, int n, int32_t *acc) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i a[B];
+    for (int b = 0; b < B; b++) {
+        a[b] = _mm256_setzero_si256();
+    }
+
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + i));
+        for (int b = 0; b < B; b++) {
+            __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x[b] + i));
+            __m256i p = _mm256_maddubs_epi16(_mm256_abs_epi8(xv), _mm256_sign_epi8(wv, xv));
+            a[b] = _mm256_add_epi32(a[b], _mm256_madd_epi16(p, ones));
+        }
+    }
+
+    for (int b = 0; b < B; b++) {
+        int32_t sum = HorizontalSum(a[b]);
+        for (int j = i; j < n; j++) {
+            sum += w[j] * x[b][j];
+        }
+        acc[b] = sum;
+    }
+}
+
+#else
+
+template <int B>
+static void DotRow(const int8_t *w, const int8_t *const *x, int n, int32_t *acc) {
+    for (int b = 0; b < B; b++) {
+        int32_t sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += w[j] * x[b][j];
+        }
+        acc[b] = sum;
+    }
+}
+
+#endif
+
+FcInt8::FcInt8() : input_size_(0), output_size_(0), output_scale_(1.0f) {}
+
+bool FcInt8::Load(const std::string &file) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        return false;
+    }
+
+    FcInt8Header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.input_size <= 0 ||
+        header.output_size <= 0 || !(header.output_scale > 0)) {
+        fprintf(stderr, "Error: %s is not an FC weight file.\n", file.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    size_t in = header.input_size, out = header.output_size;
+    weight_scale_.resize(out);
+    bias_.resize(out);
+    weights_.resize(in * out);
+    bool ok = fread(weight_scale_.data(), sizeof(float), out, fp) == out &&
+              fread(bias_.data(), sizeof(float), out, fp) == out &&
+              fread(weights_.data(), 1, in * out, fp) == in * out;
+    fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "Error: %s is truncated.\n", file.c_str());
+        return false;
+    }
+
+    input_size_ = in;
+    output_size_ = out;
+    output_scale_ = header.output_scale;
+    return true;
+}
+
+void FcInt8::Run(const int8_t *const *inputs, int batch, float input_scale,
+                 int8_t *const *outputs) const {
+    float inverse = 1.0f / output_scale_;
+
+    for (int b0 = 0; b0 < batch; b0 += kBatch) {
+        int n = std::min(kBatch, batch - b0);
+        const int8_t *const *x = inputs + b0;
+        int8_t *const *y = outputs + b0;
+
+        for (int o = 0; o < output_size_; o++) {
+            const int8_t *w = &weights_[(size_t)o * input_size_];
+            int32_t acc[kBatch];
+            switch (n) {
+            case 1: DotRow<1>(w, x, input_size_, acc); break;
+            case 2: DotRow<2>(w, x, input_size_, acc); break;
+            case 3: DotRow<3>(w, x, input_size_, acc); break;
+            default: DotRow<4>(w, x, input_size_, acc); break;
+            }
+
+            /* real sum, biased, then requantized to the output scale */
+            float scale = weight_scale_[o] / input_scale;
+            for (int b = 0; b < n; b++) {
+                float v = (acc[b] * scale + bias_[o]) * inverse;
+                y[b][o] = (int8_t)std::min(std::max(lrintf(v), -128L), 127L);
+            }
+        }
+    }
+}
+
+bool PackFcInt8(const std::string &file, const float *weights, const float *bias,
+                int input_size, int output_size, float output_scale) {
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        return false;
+    }
+
+    FcInt8Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.input_size = input_size;
+    header.output_size = output_size;
+    header.output_scale = output_scale;
+    header.reserved = 0;
+
+    /* symmetric per-output quantization, -128 is left out */
+    std::vector<float> scales(output_size);
+    std::vector<int8_t> quantized((size_t)input_size * output_size);
+    for (int o = 0; o < output_size; o++) {
+        const float *row = weights + (size_t)o * input_size;
+        float range = 0;
+        for (int i = 0; i < input_size; i++) {
+            range = std::max(range, std::fabs(row[i]));
+        }
+        scales[o] = range > 0 ? range / 127.0f : 1.0f;
+        for (int i = 0; i < input_size; i++) {
+            long q = lrintf(row[i] / scales[o]);
+            quantized[(size_t)o * input_size + i] = (int8_t)std::min(std::max(q, -127L), 127L);
+        }
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(scales.data(), sizeof(float), output_size, fp) == (size_t)output_size &&
+              fwrite(bias, sizeof(float), output_size, fp) == (size_t)output_size &&
+              fwrite(quantized.data(), 1, quantized.size(), fp) == quantized.size();
+    if (fclose(fp) != 0 || !ok) {
+        fprintf(stderr, "Error: Fail to write %s.\n", file.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
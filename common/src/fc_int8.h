@@ -0,0 +1,143 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_FC_INT8_H_
+#define DEEPHI_FC_INT8_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace deephi {
+
+/*
+ * class FcInt8: fully connected layer run on the CPU with INT8 weights
+ *
+ * The last FC layer of a classifier is a GEMV small enough for the CPU:
+ * running it there saves the round trip of a second DPU Task and its
+ * input/output staging. The pooled INT8 activations are multiplied with
+ * INT8 weights into INT32 sums (NEON vmull/vpadal, AVX2 maddubs), which
+ * are scaled per output, biased and requantized to INT8 logits.
+ *
+ * N2Cube does not expose the parameters inside a DPU Kernel, so the
+ * weights are loaded from a file written by common/tools/fc_pack from the
+ * FP32 weights of the model:
+ *   "FCINT8\0\0", int32 input_size, int32 output_size, float output_scale,
+ *   int32 reserved, float weight_scale[output_size], float bias[output_size],
+ *   int8 weights[output_size][input_size]
+ * Real weights are weights * weight_scale of their output.
+ */
+class FcInt8 {
+public:
+    FcInt8();
+
+    /*
+     * @brief Load - read the weights written by fc_pack
+     *
+     * @return true on success
+     */
+    bool Load(const std::string &file);
+
+    int input_size() const { return input_size_; }
+    int output_size() const { return output_size_; }
+
+    /* scale of the logits, real value = logit * output_scale */
+    float output_scale() const { return output_scale_; }
+
+    /* requantize the logits to another scale, e.g. that of the DPU FC Kernel */
+    void set_output_scale(float scale) { output_scale_ = scale; }
+
+    /*
+     * @brief Run - compute the logits of a batch of inputs. Weights are read
+     *        once for up to four inputs, so batches save memory bandwidth.
+     *        Thread-safe.
+     *
+     * @param inputs - batch INT8 inputs of input_size() values
+     * @param batch - number of inputs
+     * @param input_scale - fixed-point scale of the inputs, i.e.
+     *                      input = real value * input_scale, as returned by
+     *                      dpuGetInputTensorScale()
+     * @param outputs - batch buffers of output_size() INT8 logits
+     *
+     * @return none
+     */
+    void Run(const int8_t *const *inputs, int batch, float input_scale,
+             int8_t *const *outputs) const;
+
+    void Run(const int8_t *input, float input_scale, int8_t *output) const {
+        Run(&input, 1, input_scale, &output);
+    }
+
+private:
+    int input_size_;
+    int output_size_;
+    float output_scale_;
+    std::vector<float> weight_scale_;
+    std::vector<float> bias_;
+    std::vector<int8_t> weights_;
+};
+
+/*
+ * @brief PackFcInt8 - quantize FP32 weights per output to [-127, 127] and
+ *        write them in the format read by FcInt8::Load()
+ *
+ * @param file - path of the output file
+ * @param weights - output_size rows of input_size FP32 weights
+ * @param bias - output_size FP32 biases
+ * @param input_size - number of inputs
+ * @param output_size - number of outputs
+ * @param output_scale - default scale of the logits
+ *
+ * @return true on success
+ */
+bool PackFcInt8(const std::string &file, const float *weights, const float *bias,
+                int input_size, int output_size, float output_scale);
+
+}
+
+#endif
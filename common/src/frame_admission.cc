@@ -0,0 +1,132 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "frame_admission.h"
+
+using namespace std::chrono;
+
+namespace deephi {
+
+/* weight of the newest sample in the service time average */
+static const double kServiceAlpha = 0.1;
+/* share of the service time estimate forgotten on each stale drop */
+static const double kStaleDecay = 0.1;
+
+FrameAdmission::FrameAdmission(int max_age_ms, int capacity)
+    : max_age_ns_(max_age_ms * 1000000LL), capacity_(capacity > 0 ? capacity : 1),
+      captured_(capacity_), admitted_(capacity_), start_(Clock::now()),
+      last_admit_(start_), service_ns_(0), captured_num_(0), shown_num_(0), stale_num_(0),
+      probe_num_(0), overflow_num_(0) {}
+
+void FrameAdmission::Capture(int index) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (captured_num_ == 0) {
+        start_ = now;
+        last_admit_ = now;
+    }
+    captured_[index % capacity_] = now;
+    admitted_[index % capacity_] = now;
+    captured_num_++;
+}
+
+bool FrameAdmission::Admit(int index) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    admitted_[index % capacity_] = now;
+    if (!enabled()) {
+        return true;
+    }
+
+    long long age = duration_cast<nanoseconds>(now - captured_[index % capacity_]).count();
+    if (age + service_ns_ > max_age_ns_) {
+        /* probe with a frame once per budget to measure the service
+           time anew, the estimate may be stuck on an outlier */
+        if (duration_cast<nanoseconds>(now - last_admit_).count() < max_age_ns_) {
+            service_ns_ -= kStaleDecay * service_ns_;
+            stale_num_++;
+            return false;
+        }
+        probe_num_++;
+    }
+    last_admit_ = now;
+    return true;
+}
+
+void FrameAdmission::Drop() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    overflow_num_++;
+}
+
+void FrameAdmission::Shown(int index) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    long long glass = duration_cast<nanoseconds>(now - captured_[index % capacity_]).count();
+    double service = duration_cast<nanoseconds>(now - admitted_[index % capacity_]).count();
+    service_ns_ = (shown_num_ == 0) ? service : service_ns_ + kServiceAlpha * (service - service_ns_);
+    glass_.Record(glass);
+    shown_num_++;
+}
+
+void FrameAdmission::Report(FILE *fp) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    double elapsed = duration_cast<microseconds>(Clock::now() - start_).count() / 1e6;
+    long dropped = stale_num_ + overflow_num_;
+
+    fprintf(fp, "[Admission] budget %lldms  captured %ld  shown %ld (%.1f FPS)  dropped %ld (%.1f%%):"
+            " stale %ld, queue full %ld  probes %ld\n",
+            max_age_ns_ / 1000000, captured_num_, shown_num_,
+            elapsed > 0 ? shown_num_ / elapsed : 0.0, dropped,
+            captured_num_ ? 100.0 * dropped / captured_num_ : 0.0, stale_num_, overflow_num_, probe_num_);
+    fprintf(fp, "[Admission] glass-to-glass p50 %.1fms  p90 %.1fms  p99 %.1fms  max %.1fms"
+            "  admit-to-show avg %.1fms\n",
+            glass_.Percentile(0.5) / 1e6, glass_.Percentile(0.9) / 1e6,
+            glass_.Percentile(0.99) / 1e6, glass_.max() / 1e6, service_ns_ / 1e6);
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_FRAME_ADMISSION_H_
+#define DEEPHI_FRAME_ADMISSION_H_
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "stage_timer.h"
+
+namespace deephi {
+
+/*
+ * class FrameAdmission: latency budget of the frames of a live source
+ *
+ * Every frame is stamped when captured. Before a worker preprocesses a
+ * frame, Admit() checks that its age plus the usual time from admission
+ * to display still fits the maximum age, and drops it otherwise: the
+ * workers then spend their time on the newest frames and a result is
+ * never older than the budget by more than the estimate is off. Every
+ * stale drop decays the estimate, and a frame is admitted regardless
+ * when none was for a whole budget, so that one slow frame cannot lock
+ * the source out for good. Frames the reader cannot queue are counted
+ * with Drop(). Shown() measures the glass-to-glass latency, capture to
+ * display, of every frame shown.
+ *
+ * Frames are identified by their capture index; the stamps are kept in
+ * rings of capacity entries, which must exceed the frames in flight.
+ * Thread-safe.
+ */
+class FrameAdmission {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /*
+     * @param max_age_ms - budget from capture to display, 0 to admit every
+     *                     frame and only measure
+     * @param capacity - frames in flight at most
+     */
+    explicit FrameAdmission(int max_age_ms, int capacity = 4096);
+
+    bool enabled() const { return max_age_ns_ > 0; }
+
+    /* stamp frame index, just captured */
+    void Capture(int index);
+
+    /*
+     * @brief Admit - decide whether a frame is still worth processing
+     *
+     * @return false if the frame cannot be shown within the budget any
+     *         more, counted as dropped
+     */
+    bool Admit(int index);
+
+    /* a frame was dropped before reaching a worker */
+    void Drop();
+
+    /* the result of frame index is being shown */
+    void Shown(int index);
+
+    /* print captured, shown and dropped frames and latency percentiles */
+    void Report(FILE *fp = stdout) const;
+
+private:
+    const long long max_age_ns_;
+    const int capacity_;
+    std::vector<Clock::time_point> captured_;
+    std::vector<Clock::time_point> admitted_;
+
+    mutable std::mutex mtx_;
+    Clock::time_point start_;
+    Clock::time_point last_admit_;
+    /* moving average of the time from admission to display */
+    double service_ns_;
+    long captured_num_;
+    long shown_num_;
+    long stale_num_;
+    long probe_num_;
+    long overflow_num_;
+    LatencyHistogram glass_;
+};
+
+}
+
+#endif
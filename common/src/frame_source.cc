@@ -0,0 +1,200 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "frame_source.h"
+
+#include <chrono>
+
+using namespace std::chrono;
+
+namespace deephi {
+
+FrameSource::FrameSource(int threads, int prefetch, int decode_threads)
+    : threads_(threads > 0 ? threads : 1), prefetch_(prefetch > 0 ? prefetch : 1),
+      decode_threads_(decode_threads > 0 ? decode_threads : 0), interpolation_(cv::INTER_LINEAR),
+      fps_(0), resizing_(0), decode_ns_(0), resize_ns_(0), wait_ns_(0), decoded_num_(0),
+      read_num_(0) {}
+
+FrameSource::~FrameSource() { Close(); }
+
+bool FrameSource::Open(const std::string &file, cv::Size size, int interpolation) {
+    Close();
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+    std::vector<int> params;
+    if (decode_threads_ > 0) {
+        params = {cv::CAP_PROP_N_THREADS, decode_threads_};
+    }
+    bool opened = video_.open(file, cv::CAP_ANY, params);
+#else
+    bool opened = video_.open(file);
+#endif
+    if (!opened) {
+        fprintf(stderr, "Error: fail to open video %s\n", file.c_str());
+        return false;
+    }
+
+    fps_ = video_.get(cv::CAP_PROP_FPS);
+    video_size_ = cv::Size(video_.get(cv::CAP_PROP_FRAME_WIDTH),
+                           video_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    size_ = (size == video_size_) ? cv::Size() : size;
+    interpolation_ = interpolation;
+
+    /* the decoded frames are handed to the resize threads, if any, and put
+       back in order; the ring holds every frame in flight between them */
+    bool resize = size_.area() > 0;
+    ready_.reset(new ReorderBuffer<cv::Mat>(prefetch_ + (resize ? prefetch_ + threads_ : 0)));
+    decoded_.reset(resize ? new BoundedQueue<std::pair<int, cv::Mat>>(prefetch_) : nullptr);
+    if (resize) {
+        resizing_ = threads_;
+        for (int i = 0; i < threads_; i++) {
+            resizers_.emplace_back(&FrameSource::Resize, this);
+        }
+    }
+    decoder_ = std::thread(&FrameSource::Decode, this);
+    return true;
+}
+
+void FrameSource::Decode() {
+    for (int index = 0;; index++) {
+        /* a new Mat for every frame, the previous one is still in use */
+        cv::Mat frame;
+        auto start = steady_clock::now();
+        bool ok = video_.read(frame);
+        decode_ns_ += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        if (!ok || frame.empty()) {
+            break;
+        }
+        decoded_num_++;
+
+        bool queued = decoded_ ? decoded_->Push(std::make_pair(index, frame))
+                               : ready_->Put(index, frame);
+        if (!queued) {
+            break;
+        }
+    }
+
+    if (decoded_) {
+        decoded_->Close();
+    } else {
+        ready_->Close();
+    }
+}
+
+void FrameSource::Resize() {
+    std::pair<int, cv::Mat> frame;
+    while (decoded_->Pop(frame)) {
+        cv::Mat scaled;
+        auto start = steady_clock::now();
+        cv::resize(frame.second, scaled, size_, 0, 0, interpolation_);
+        resize_ns_ += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+        if (!ready_->Put(frame.first, scaled)) {
+            break;
+        }
+    }
+
+    /* the last resize thread ends the stream */
+    if (--resizing_ == 0) {
+        ready_->Close();
+    }
+}
+
+bool FrameSource::Read(int &index, cv::Mat &frame) {
+    if (!ready_) {
+        return false;
+    }
+
+    /* one reader at a time takes the next frame */
+    std::lock_guard<std::mutex> lock(read_mtx_);
+    long seq;
+    auto start = steady_clock::now();
+    bool ok = ready_->Next(seq, frame);
+    wait_ns_ += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    if (ok) {
+        index = (int)seq;
+        read_num_++;
+    }
+    return ok;
+}
+
+void FrameSource::Close() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (decoded_) {
+        decoded_->Close();
+    }
+    if (ready_) {
+        ready_->Close();
+    }
+
+    /* the readers may still hold ready_, it is only replaced by Open() */
+    if (decoder_.joinable()) {
+        decoder_.join();
+    }
+    for (auto &t : resizers_) {
+        t.join();
+    }
+    resizers_.clear();
+    video_.release();
+}
+
+void FrameSource::Report(FILE *fp) const {
+    int decoded = decoded_num_;
+    int read = read_num_;
+    double decode_ms = decoded ? decode_ns_ / 1e6 / decoded : 0.0;
+    double resize_ms = decoded ? resize_ns_ / 1e6 / decoded : 0.0;
+
+    fprintf(fp, "[FrameSource] %d frames decoded, %d read: decode %.2fms (%.1f FPS)", decoded,
+            read, decode_ms, decode_ms > 0 ? 1000.0 / decode_ms : 0.0);
+    if (size_.area() > 0) {
+        fprintf(fp, "  resize to %dx%d %.2fms on %d threads", size_.width, size_.height,
+                resize_ms, threads_);
+    }
+    fprintf(fp, "  readers waited %.2fms per frame\n", read ? wait_ns_ / 1e6 / read : 0.0);
+}
+
+}
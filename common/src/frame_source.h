@@ -0,0 +1,166 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_FRAME_SOURCE_H_
+#define DEEPHI_FRAME_SOURCE_H_
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "bounded_queue.h"
+#include "reorder_buffer.h"
+
+namespace deephi {
+
+/*
+ * class FrameSource: frames of a video file, decoded ahead of the readers
+ *
+ * One thread decodes the video into a prefetch pool and the codec itself
+ * spreads the decode of every frame over its own threads: the FFmpeg
+ * backend of OpenCV starts one per core, or decode_threads from OpenCV
+ * 4.7 on, which takes them through CAP_PROP_N_THREADS. When the frames
+ * are wanted at another size, e.g. the size of the DPU input Tensor, a
+ * group of threads resizes them in parallel, so that neither the decode
+ * nor the workers pay for it.
+ *
+ * Frames are numbered from 0 in decode order and Read() hands them out in
+ * that order, with no gap, to any number of threads.
+ */
+class FrameSource {
+public:
+    /*
+     * @param threads - threads resizing the frames, used only when Open()
+     *                  is given a size
+     * @param prefetch - frames decoded ahead of the readers
+     * @param decode_threads - threads of the codec, 0 for the default of
+     *                         the backend; ignored before OpenCV 4.7
+     */
+    explicit FrameSource(int threads = 2, int prefetch = 16, int decode_threads = 0);
+
+    ~FrameSource();
+
+    /*
+     * @brief Open - open a video file and start decoding it
+     *
+     * @param file - path of the video file
+     * @param size - size of the frames read, empty for the size of the video
+     * @param interpolation - cv::resize() interpolation to reach size
+     *
+     * @return true on success
+     */
+    bool Open(const std::string &file, cv::Size size = cv::Size(),
+              int interpolation = cv::INTER_LINEAR);
+
+    /*
+     * @brief Read - next frame of the video, waiting for it to be decoded
+     *
+     * @param index - frame number, from 0
+     * @param frame - BGR frame, of the size given to Open()
+     *
+     * @return false at the end of the video or after Close()
+     */
+    bool Read(int &index, cv::Mat &frame);
+
+    /*
+     * @brief Close - stop decoding and wake the readers, which get the frames
+     *        already decoded and then false. Any thread may call it.
+     */
+    void Close();
+
+    /* frame rate of the video, 0 if unknown */
+    double fps() const { return fps_; }
+
+    /* size of the video frames, before any resize */
+    cv::Size video_size() const { return video_size_; }
+
+    /* print the frames read and the time spent by the decode, the resize
+       and the readers waiting */
+    void Report(FILE *fp = stdout) const;
+
+private:
+    void Decode();
+    void Resize();
+
+    const int threads_;
+    const int prefetch_;
+    const int decode_threads_;
+
+    cv::VideoCapture video_;
+    cv::Size size_;
+    int interpolation_;
+    double fps_;
+    cv::Size video_size_;
+
+    /* decoded frames waiting for a resize thread */
+    std::unique_ptr<BoundedQueue<std::pair<int, cv::Mat>>> decoded_;
+    /* frames ready, put back in decode order */
+    std::unique_ptr<ReorderBuffer<cv::Mat>> ready_;
+    std::thread decoder_;
+    std::vector<std::thread> resizers_;
+    std::atomic<int> resizing_;
+    std::mutex read_mtx_;
+    std::mutex mtx_;
+
+    /* statistics, in ns */
+    std::atomic<long long> decode_ns_;
+    std::atomic<long long> resize_ns_;
+    std::atomic<long long> wait_ns_;
+    std::atomic<int> decoded_num_;
+    std::atomic<int> read_num_;
+};
+
+}
+
+#endif
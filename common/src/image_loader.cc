@@ -0,0 +1,170 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+#include "image_loader.h"
+
+namespace deephi {
+
+/* libjpeg calls exit() on errors by default, jump back instead */
+struct JpegError {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+static void OnJpegError(j_common_ptr cinfo) {
+    JpegError *err = reinterpret_cast<JpegError *>(cinfo->err);
+    longjmp(err->jump, 1);
+}
+
+static void OnJpegMessage(j_common_ptr) {
+    /* corrupt-data warnings are not fatal, keep them quiet */
+}
+
+/**
+ * @brief Pick the largest DCT scale denominator keeping the image at least
+ *        as large as minSize
+ */
+static int JpegScaleDenom(int width, int height, const cv::Size &minSize) {
+    for (int denom = 8; denom > 1; denom /= 2) {
+        if ((width + denom - 1) / denom >= minSize.width &&
+            (height + denom - 1) / denom >= minSize.height) {
+            return denom;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Decode a JPEG stream at reduced scale into a BGR image
+ *
+ * @return false if the stream is not a JPEG libjpeg can convert to BGR
+ */
+static bool DecodeJpeg(FILE *fp, const cv::Size &minSize, cv::Mat &image) {
+    struct jpeg_decompress_struct cinfo;
+    JpegError jerr;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = OnJpegError;
+    jerr.pub.output_message = OnJpegMessage;
+    if (setjmp(jerr.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, fp);
+    jpeg_read_header(&cinfo, TRUE);
+
+    /* leave CMYK images to OpenCV */
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = JpegScaleDenom(cinfo.image_width, cinfo.image_height, minSize);
+#ifdef JCS_EXTENSIONS
+    /* libjpeg-turbo writes BGR directly */
+    cinfo.out_color_space = JCS_EXT_BGR;
+#else
+    cinfo.out_color_space = JCS_RGB;
+#endif
+
+    jpeg_start_decompress(&cinfo);
+    image.create(cinfo.output_height, cinfo.output_width, CV_8UC3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = image.ptr(cinfo.output_scanline);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+#ifndef JCS_EXTENSIONS
+    cv::cvtColor(image, image, cv::COLOR_RGB2BGR);
+#endif
+    return true;
+}
+
+bool DecodeImageScaled(const std::string &path, const cv::Size &minSize, cv::Mat &image) {
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    /* JPEG streams start with the SOI marker 0xFFD8 */
+    int c0 = fgetc(fp);
+    int c1 = fgetc(fp);
+    rewind(fp);
+    bool decoded = (c0 == 0xFF && c1 == 0xD8) && DecodeJpeg(fp, minSize, image);
+    fclose(fp);
+
+    if (!decoded) {
+        image = cv::imread(path);
+    }
+    return !image.empty();
+}
+
+bool LoadImageScaled(const std::string &path, const cv::Size &size, cv::Mat &image) {
+    cv::Mat decoded;
+    if (!DecodeImageScaled(path, size, decoded)) {
+        return false;
+    }
+
+    if (decoded.size() != size) {
+        cv::resize(decoded, image, size);
+    } else {
+        image = decoded;
+    }
+    return true;
+}
+
+}
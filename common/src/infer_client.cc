@@ -0,0 +1,235 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "infer_client.h"
+
+namespace deephi {
+
+static size_t AlignUp(size_t n) {
+    return (n + INFERD_SLOT_ALIGN - 1) / INFERD_SLOT_ALIGN * INFERD_SLOT_ALIGN;
+}
+
+InferClient::InferClient()
+    : sock_(-1), slots_(0), slot_size_(0), output_offset_(0), length_(0), base_(nullptr) {
+    memset(&kernel_, 0, sizeof(kernel_));
+}
+
+InferClient::~InferClient() {
+    Close();
+}
+
+bool InferClient::Connect(const std::string &kernel, int slots, size_t max_frame,
+                          const std::string &path) {
+    Close();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path) || kernel.size() >= INFERD_NAME_LEN) {
+        fprintf(stderr, "Error: socket path or Kernel name too long.\n");
+        return false;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    sock_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock_ < 0 || connect(sock_, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Error: Fail to connect to dpu_inferd at %s.\n", path.c_str());
+        Close();
+        return false;
+    }
+
+    InferHello hello;
+    memset(&hello, 0, sizeof(hello));
+    hello.header.magic = INFERD_MAGIC;
+    hello.header.type = INFER_HELLO;
+    strcpy(hello.kernel, kernel.c_str());
+    if (!Send(&hello, sizeof(hello)) ||
+        recv(sock_, &kernel_, sizeof(kernel_), 0) != (ssize_t)sizeof(kernel_) ||
+        kernel_.header.magic != INFERD_MAGIC || kernel_.header.type != INFER_KERNEL) {
+        fprintf(stderr, "Error: Bad reply from dpu_inferd.\n");
+        Close();
+        return false;
+    }
+    if (kernel_.status < 0) {
+        fprintf(stderr, "Error: Kernel %s is not loaded by dpu_inferd.\n", kernel.c_str());
+        Close();
+        return false;
+    }
+
+    /* slots: input area large enough for a Tensor or a frame, then output */
+    slots_ = slots > 0 ? slots : 1;
+    output_offset_ = AlignUp(std::max((size_t)kernel_.input_size, max_frame));
+    slot_size_ = output_offset_ + AlignUp(kernel_.output_size);
+    length_ = slot_size_ * slots_;
+
+    int fd = syscall(SYS_memfd_create, "dpu_inferd", 0);
+    if (fd < 0 || ftruncate(fd, length_) != 0) {
+        fprintf(stderr, "Error: Fail to create %zu bytes of shared memory.\n", length_);
+        if (fd >= 0) {
+            close(fd);
+        }
+        Close();
+        return false;
+    }
+
+    void *base = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Error: Fail to map shared memory.\n");
+        close(fd);
+        Close();
+        return false;
+    }
+    base_ = (uint8_t *)base;
+
+    InferAttach attach;
+    attach.header.magic = INFERD_MAGIC;
+    attach.header.type = INFER_ATTACH;
+    attach.slots = slots_;
+    attach.slot_size = slot_size_;
+    attach.output_offset = output_offset_;
+    bool ok = Send(&attach, sizeof(attach), fd);
+    close(fd);
+    if (!ok) {
+        fprintf(stderr, "Error: Fail to pass shared memory to dpu_inferd.\n");
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void InferClient::Close() {
+    if (base_) {
+        munmap(base_, length_);
+        base_ = nullptr;
+    }
+    if (sock_ >= 0) {
+        close(sock_);
+        sock_ = -1;
+    }
+    slots_ = 0;
+}
+
+bool InferClient::Send(const void *msg, size_t size, int fd) {
+    struct iovec iov;
+    iov.iov_base = (void *)msg;
+    iov.iov_len = size;
+
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+
+    /* pass fd along with the message */
+    char control[CMSG_SPACE(sizeof(int))];
+    if (fd >= 0) {
+        memset(control, 0, sizeof(control));
+        mh.msg_control = control;
+        mh.msg_controllen = sizeof(control);
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    }
+
+    return sendmsg(sock_, &mh, MSG_NOSIGNAL) == (ssize_t)size;
+}
+
+bool InferClient::Submit(int slot, uint64_t id) {
+    return SubmitFrame(slot, 0, 0, 0, id);
+}
+
+bool InferClient::SubmitFrame(int slot, int width, int height, int stride, uint64_t id) {
+    if (slot < 0 || slot >= slots_) {
+        return false;
+    }
+
+    InferRequest request;
+    request.header.magic = INFERD_MAGIC;
+    request.header.type = INFER_REQUEST;
+    request.id = id;
+    request.slot = slot;
+    request.format = (width > 0) ? INFER_BGR : INFER_TENSOR;
+    request.width = width;
+    request.height = height;
+    request.stride = stride;
+    return Send(&request, sizeof(request));
+}
+
+bool InferClient::Wait(InferReply &reply) {
+    if (sock_ < 0) {
+        return false;
+    }
+
+    return recv(sock_, &reply, sizeof(reply), 0) == (ssize_t)sizeof(reply) &&
+           reply.header.magic == INFERD_MAGIC && reply.header.type == INFER_REPLY;
+}
+
+bool InferClient::Infer(const int8_t *tensor, int8_t *output) {
+    memcpy(input(0), tensor, kernel_.input_size);
+
+    InferReply reply;
+    if (!Submit(0) || !Wait(reply) || reply.status < 0) {
+        return false;
+    }
+
+    memcpy(output, this->output(0), kernel_.output_size);
+    return true;
+}
+
+}
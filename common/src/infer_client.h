@@ -0,0 +1,139 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_INFER_CLIENT_H_
+#define DEEPHI_INFER_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "infer_protocol.h"
+
+namespace deephi {
+
+/*
+ * class InferClient: connection to dpu_inferd for one Kernel
+ *
+ * The Kernel stays loaded in the daemon, so connecting costs a few system
+ * calls instead of dpuOpen() and dpuLoadKernel(). Inputs and outputs live
+ * in slots of memory shared with the daemon: write the input Tensor or a
+ * BGR frame into a slot, Submit() it and Wait() for replies. Up to slots()
+ * requests can be in flight on one connection; the daemon batches them
+ * with those of other clients. Not thread-safe, use one per thread.
+ */
+class InferClient {
+public:
+    InferClient();
+    ~InferClient();
+
+    InferClient(const InferClient &) = delete;
+    InferClient &operator=(const InferClient &) = delete;
+
+    /*
+     * @brief Connect - connect to the daemon and map the slots
+     *
+     * @param kernel - name of a Kernel loaded by the daemon
+     * @param slots - requests in flight at most
+     * @param max_frame - largest BGR frame in bytes, 0 for Tensors only
+     * @param path - socket of the daemon
+     *
+     * @return true on success
+     */
+    bool Connect(const std::string &kernel, int slots = 1, size_t max_frame = 0,
+                 const std::string &path = INFERD_SOCKET);
+
+    void Close();
+
+    /* shapes and scales of the Kernel's input and output Tensors */
+    const InferKernel &kernel() const { return kernel_; }
+    int slots() const { return slots_; }
+
+    /* input area of a slot, for an INT8 Tensor or a BGR frame */
+    int8_t *input(int slot) { return (int8_t *)(base_ + (size_t)slot * slot_size_); }
+    /* output Tensor of a slot, valid after its reply */
+    const int8_t *output(int slot) const {
+        return (const int8_t *)(base_ + (size_t)slot * slot_size_ + output_offset_);
+    }
+
+    /* run the input Tensor in a slot */
+    bool Submit(int slot, uint64_t id = 0);
+
+    /* run the BGR frame in a slot, rows of stride bytes */
+    bool SubmitFrame(int slot, int width, int height, int stride, uint64_t id = 0);
+
+    /*
+     * @brief Wait - wait for the reply to one submitted request
+     *
+     * @return false if the connection is lost
+     */
+    bool Wait(InferReply &reply);
+
+    /*
+     * @brief Infer - run one input Tensor through slot 0 and copy the
+     *        output Tensor
+     *
+     * @return true if the run succeeded
+     */
+    bool Infer(const int8_t *tensor, int8_t *output);
+
+private:
+    bool Send(const void *msg, size_t size, int fd = -1);
+
+    int sock_;
+    InferKernel kernel_;
+    int slots_;
+    size_t slot_size_;
+    size_t output_offset_;
+    size_t length_;
+    uint8_t *base_;
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_INFER_PROTOCOL_H_
+#define DEEPHI_INFER_PROTOCOL_H_
+
+#include <cstdint>
+
+/*
+ * Messages between dpu_inferd and its clients
+ *
+ * Clients connect to a SOCK_SEQPACKET Unix socket, so every message is one
+ * packet. Tensors and frames do not go through the socket: after
+ * INFER_HELLO, the client sends INFER_ATTACH with a shared memory file
+ * descriptor holding its slots, each made of an input area followed by an
+ * output area. A request names a slot; the daemon reads the input from it,
+ * writes the output Tensor back into it and replies.
+ */
+
+namespace deephi {
+
+#define INFERD_SOCKET "/tmp/dpu_inferd.sock"
+#define INFERD_MAGIC 0x49555044      // "DPUI"
+#define INFERD_NAME_LEN 64
+#define INFERD_SLOT_ALIGN 64
+#define INFERD_BUSY (-2)             // reply status: the Kernel's queue is full
+
+enum InferMsgType {
+    INFER_HELLO = 1,                 // client -> daemon, InferHello
+    INFER_KERNEL,                    // daemon -> client, InferKernel
+    INFER_ATTACH,                    // client -> daemon, InferAttach + fd
+    INFER_REQUEST,                   // client -> daemon, InferRequest
+    INFER_REPLY                      // daemon -> client, InferReply
+};
+
+enum InferFormat {
+    INFER_TENSOR = 0,                // INT8 input Tensor, HWC
+    INFER_BGR = 1                    // BGR frame, resized and quantized by the daemon
+};
+
+struct InferHeader {
+    uint32_t magic;
+    uint32_t type;
+};
+
+/* select the Kernel to run */
+struct InferHello {
+    InferHeader header;
+    char kernel[INFERD_NAME_LEN];
+};
+
+/* Tensor shapes of the selected Kernel, status < 0 if it is not loaded */
+struct InferKernel {
+    InferHeader header;
+    int32_t status;
+    int32_t input_size;
+    int32_t output_size;
+    int32_t height;
+    int32_t width;
+    int32_t channel;
+    float input_scale;
+    float output_scale;
+};
+
+/* slots of the shared memory passed with SCM_RIGHTS */
+struct InferAttach {
+    InferHeader header;
+    uint32_t slots;
+    uint32_t slot_size;
+    uint32_t output_offset;          // of the output area in a slot
+};
+
+struct InferRequest {
+    InferHeader header;
+    uint64_t id;
+    uint32_t slot;
+    uint32_t format;                 // InferFormat
+    int32_t width;                   // of an INFER_BGR frame
+    int32_t height;
+    int32_t stride;                  // bytes per row of an INFER_BGR frame
+};
+
+struct InferReply {
+    InferHeader header;
+    uint64_t id;
+    uint32_t slot;
+    int32_t status;                  // 0, INFERD_BUSY to retry later, or < 0 on error
+    uint32_t queue_us;               // from receipt to the start of the run
+    uint32_t run_us;                 // input, DPU run and output
+    uint32_t batch;                  // size of the micro-batch it ran in
+};
+
+}
+
+#endif
@@ -0,0 +1,324 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QUANTIZE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define QUANTIZE_SSE2
+#endif
+
+#include "input_quantize.h"
+
+namespace deephi {
+
+/* fixed point of the interpolation weights, as INTER_RESIZE_COEF_BITS */
+static const int kCoefBits = 11;
+static const int kCoefScale = 1 << kCoefBits;
+
+/*
+ * Source pixel offsets and weights of one output coordinate, computed as
+ * cv::resize() does for INTER_LINEAR so that the results agree with it:
+ * columns past the edges take the edge pixel with all the weight, rows
+ * keep their weights and only their offsets are clamped
+ */
+static void LinearTaps(int src, int dst, bool rows, std::vector<int> &ofs0,
+                       std::vector<int> &ofs1, std::vector<short> &a0, std::vector<short> &a1) {
+    volatile double ratio = (double)dst / src;
+    double scale = 1.0 / ratio;
+
+    ofs0.resize(dst);
+    ofs1.resize(dst);
+    a0.resize(dst);
+    a1.resize(dst);
+    for (int d = 0; d < dst; d++) {
+        float f = (float)((d + 0.5) * scale - 0.5);
+        int s = (int)std::floor(f);
+        f -= s;
+        if (!rows && s < 0) {
+            f = 0;
+            s = 0;
+        }
+        if (!rows && s >= src - 1) {
+            f = 0;
+            s = src - 1;
+        }
+
+        ofs0[d] = std::min(std::max(s, 0), src - 1);
+        ofs1[d] = std::min(std::max(s + 1, 0), src - 1);
+        a0[d] = (short)lrintf((1.0f - f) * kCoefScale);
+        a1[d] = (short)lrintf(f * kCoefScale);
+    }
+}
+
+/*
+ * Source pixel offsets as cv::resize() does for INTER_NEAREST. The scale is
+ * the inverse of dst / src as there, src / dst rounds differently; the
+ * volatile keeps -ffast-math from rewriting one into the other.
+ */
+static void NearestTaps(int src, int dst, std::vector<int> &ofs) {
+    volatile double ratio = (double)dst / src;
+    double scale = 1.0 / ratio;
+
+    ofs.resize(dst);
+    for (int d = 0; d < dst; d++) {
+        ofs[d] = std::min((int)std::floor(d * scale), src - 1);
+    }
+}
+
+/*
+ * Horizontal pass over one source row; the sums are kept shifted right by
+ * 4 bits in INT16, as the SIMD paths of cv::resize() keep them
+ */
+static void LinearRow(const uint8_t *src, int width, const int *ofs0, const int *ofs1,
+                      const short *a0, const short *a1, int16_t *row) {
+    for (int x = 0; x < width; x++) {
+        const uint8_t *p = src + ofs0[x] * 3;
+        const uint8_t *q = src + ofs1[x] * 3;
+        int w0 = a0[x], w1 = a1[x];
+        row[x * 3 + 0] = (int16_t)((p[0] * w0 + q[0] * w1) >> 4);
+        row[x * 3 + 1] = (int16_t)((p[1] * w0 + q[1] * w1) >> 4);
+        row[x * 3 + 2] = (int16_t)((p[2] * w0 + q[2] * w1) >> 4);
+    }
+}
+
+/*
+ * Vertical pass: blend two horizontal rows with weights b0 and b1 back to
+ * 8 bits, as ((b0 * r0) >> 16) + ((b1 * r1) >> 16) + 2) >> 2
+ */
+static void BlendRows(const int16_t *r0, const int16_t *r1, int length, short b0, short b1,
+                      uint8_t *out) {
+    int i = 0;
+
+#if defined(QUANTIZE_NEON)
+    int16x4_t v0 = vdup_n_s16(b0), v1 = vdup_n_s16(b1);
+    int16x8_t two = vdupq_n_s16(2);
+    for (; i + 8 <= length; i += 8) {
+        int16x8_t x0 = vld1q_s16(r0 + i);
+        int16x8_t x1 = vld1q_s16(r1 + i);
+        int32x4_t lo = vaddq_s32(vshrq_n_s32(vmull_s16(vget_low_s16(x0), v0), 16),
+                                 vshrq_n_s32(vmull_s16(vget_low_s16(x1), v1), 16));
+        int32x4_t hi = vaddq_s32(vshrq_n_s32(vmull_s16(vget_high_s16(x0), v0), 16),
+                                 vshrq_n_s32(vmull_s16(vget_high_s16(x1), v1), 16));
+        int16x8_t s = vcombine_s16(vmovn_s32(lo), vmovn_s32(hi));
+        s = vshrq_n_s16(vaddq_s16(s, two), 2);
+        vst1_u8(out + i, vqmovun_s16(s));
+    }
+#elif defined(QUANTIZE_SSE2)
+    __m128i v0 = _mm_set1_epi16(b0), v1 = _mm_set1_epi16(b1);
+    __m128i two = _mm_set1_epi16(2);
+    for (; i + 16 <= length; i += 16) {
+        __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + i));
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + i));
+        __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + i + 8));
+        __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + i + 8));
+        __m128i s = _mm_add_epi16(_mm_mulhi_epi16(x0, v0), _mm_mulhi_epi16(x1, v1));
+        __m128i t = _mm_add_epi16(_mm_mulhi_epi16(y0, v0), _mm_mulhi_epi16(y1, v1));
+        s = _mm_srai_epi16(_mm_add_epi16(s, two), 2);
+        t = _mm_srai_epi16(_mm_add_epi16(t, two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(s, t));
+    }
+#endif
+
+    for (; i < length; i++) {
+        int v = (((b0 * r0[i]) >> 16) + ((b1 * r1[i]) >> 16) + 2) >> 2;
+        out[i] = (uint8_t)std::min(std::max(v, 0), 255);
+    }
+}
+
+/* quantize one row of BGR pixels through the tables */
+static inline void QuantizeRow(const uint8_t *pixels, int width, const int8_t (*table)[256],
+                               int8_t *out) {
+    for (int x = 0; x < width * 3; x += 3) {
+        out[x + 0] = table[0][pixels[x + 0]];
+        out[x + 1] = table[1][pixels[x + 1]];
+        out[x + 2] = table[2][pixels[x + 2]];
+    }
+}
+
+InputQuantizer::InputQuantizer()
+    : scale_(0), table_ready_(false), src_w_(0), src_h_(0), width_(0), height_(0),
+      type_(RESIZE_TYPE_NONE) {}
+
+void InputQuantizer::PrepareTable(const float *mean, float scale) {
+    if (table_ready_ && scale == scale_ && std::equal(mean, mean + 3, mean_)) {
+        return;
+    }
+
+    /* A pixel only takes 256 values, so quantize through a table per channel */
+    for (int c = 0; c < 3; c++) {
+        for (int p = 0; p < 256; p++) {
+            long v = lrintf((p - mean[c]) * scale);
+            table_[c][p] = (int8_t)(v > 127 ? 127 : (v < -128 ? -128 : v));
+        }
+        mean_[c] = mean[c];
+    }
+    scale_ = scale;
+    table_ready_ = true;
+}
+
+void InputQuantizer::PrepareTaps(int src_w, int src_h, int width, int height, RESIZE_TYPE type) {
+    if (src_w == src_w_ && src_h == src_h_ && width == width_ && height == height_ &&
+        type == type_) {
+        return;
+    }
+
+    if (type == RESIZE_TYPE_NEAREST) {
+        NearestTaps(src_w, width, xofs0_);
+        NearestTaps(src_h, height, yofs0_);
+    } else if (type == RESIZE_TYPE_LINEAR) {
+        LinearTaps(src_w, width, false, xofs0_, xofs1_, xa0_, xa1_);
+        LinearTaps(src_h, height, true, yofs0_, yofs1_, yb0_, yb1_);
+        rows_[0].resize(width * 3);
+        rows_[1].resize(width * 3);
+        pixels_.resize(width * 3);
+    }
+    src_w_ = src_w;
+    src_h_ = src_h;
+    width_ = width;
+    height_ = height;
+    type_ = type;
+}
+
+bool InputQuantizer::Run(const cv::Mat &image, int width, int height, const float *mean,
+                         float scale, RESIZE_TYPE type, int8_t *tensor) {
+    if (image.empty() || image.type() != CV_8UC3 || width <= 0 || height <= 0) {
+        fprintf(stderr, "Error: ResizeQuantize needs a non-empty 8-bit BGR image.\n");
+        return false;
+    }
+    if (type != RESIZE_TYPE_NONE && type != RESIZE_TYPE_NEAREST && type != RESIZE_TYPE_LINEAR) {
+        fprintf(stderr, "Error: unsupported resize type %d.\n", (int)type);
+        return false;
+    }
+
+    PrepareTable(mean, scale);
+    int rowSize = width * 3;
+
+    if (type == RESIZE_TYPE_NONE) {
+        if (image.cols != width || image.rows != height) {
+            fprintf(stderr, "Error: image of %dx%d for a Tensor of %dx%d without resizing.\n",
+                    image.cols, image.rows, width, height);
+            return false;
+        }
+        for (int y = 0; y < height; y++) {
+            QuantizeRow(image.ptr<uint8_t>(y), width, table_, tensor + y * rowSize);
+        }
+        return true;
+    }
+
+    PrepareTaps(image.cols, image.rows, width, height, type);
+
+    if (type == RESIZE_TYPE_NEAREST) {
+        for (int y = 0; y < height; y++) {
+            const uint8_t *src = image.ptr<uint8_t>(yofs0_[y]);
+            int8_t *out = tensor + y * rowSize;
+            for (int x = 0; x < width; x++) {
+                const uint8_t *p = src + xofs0_[x] * 3;
+                out[x * 3 + 0] = table_[0][p[0]];
+                out[x * 3 + 1] = table_[1][p[1]];
+                out[x * 3 + 2] = table_[2][p[2]];
+            }
+        }
+        return true;
+    }
+
+    /* the two most recent horizontal rows, reused while the output rows
+       fall between the same source rows */
+    int rowIndex[2] = {-1, -1};
+
+    for (int y = 0; y < height; y++) {
+        int s0 = yofs0_[y], s1 = yofs1_[y];
+
+        /* keep the slot holding s0 (or s1) and fill the other one */
+        int k0 = (rowIndex[0] == s0) ? 0 : ((rowIndex[1] == s0) ? 1 : -1);
+        if (k0 < 0) {
+            k0 = (rowIndex[0] == s1) ? 1 : 0;
+            LinearRow(image.ptr<uint8_t>(s0), width, xofs0_.data(), xofs1_.data(), xa0_.data(),
+                      xa1_.data(), rows_[k0].data());
+            rowIndex[k0] = s0;
+        }
+        int k1 = 1 - k0;
+        if (s1 == s0) {
+            k1 = k0;
+        } else if (rowIndex[k1] != s1) {
+            LinearRow(image.ptr<uint8_t>(s1), width, xofs0_.data(), xofs1_.data(), xa0_.data(),
+                      xa1_.data(), rows_[k1].data());
+            rowIndex[k1] = s1;
+        }
+
+        BlendRows(rows_[k0].data(), rows_[k1].data(), rowSize, yb0_[y], yb1_[y], pixels_.data());
+        QuantizeRow(pixels_.data(), width, table_, tensor + y * rowSize);
+    }
+
+    return true;
+}
+
+bool ResizeQuantize(const cv::Mat &image, int width, int height, const float *mean, float scale,
+                    RESIZE_TYPE type, int8_t *tensor) {
+    static thread_local InputQuantizer quantizer;
+    return quantizer.Run(image, width, height, mean, scale, type, tensor);
+}
+
+bool SetInputImageFused(const TensorHandle &input, const cv::Mat &image, const float *mean,
+                        float scale, RESIZE_TYPE type) {
+    if (input.channel != 3) {
+        fprintf(stderr, "Error: input Tensor of %d channels for a BGR image.\n", input.channel);
+        return false;
+    }
+
+    return ResizeQuantize(image, input.width, input.height, mean, scale * input.scale, type,
+                          input.addr);
+}
+
+}
@@ -0,0 +1,149 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_INPUT_QUANTIZE_H_
+#define DEEPHI_INPUT_QUANTIZE_H_
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "tensor_handle.h"
+
+namespace deephi {
+
+/*
+ * class InputQuantizer: reusable state of ResizeQuantize()
+ *
+ * Keeps the quantization tables, the interpolation taps and the scratch
+ * rows between calls; they are only computed again when the mean and
+ * scale or the image and Tensor sizes change. The state is owned by the
+ * object: use one per thread.
+ */
+class InputQuantizer {
+public:
+    InputQuantizer();
+
+    /* as ResizeQuantize() */
+    bool Run(const cv::Mat &image, int width, int height, const float *mean, float scale,
+             RESIZE_TYPE type, int8_t *tensor);
+
+private:
+    void PrepareTable(const float *mean, float scale);
+    void PrepareTaps(int src_w, int src_h, int width, int height, RESIZE_TYPE type);
+
+    /* quantization table of every channel and its mean and scale */
+    int8_t table_[3][256];
+    float mean_[3];
+    float scale_;
+    bool table_ready_;
+    /* sizes and type the taps are computed for */
+    int src_w_;
+    int src_h_;
+    int width_;
+    int height_;
+    RESIZE_TYPE type_;
+    /* source offsets and weights of every column and row; NEAREST only
+       uses the offsets xofs0_ and yofs0_ */
+    std::vector<int> xofs0_;
+    std::vector<int> xofs1_;
+    std::vector<int> yofs0_;
+    std::vector<int> yofs1_;
+    std::vector<short> xa0_;
+    std::vector<short> xa1_;
+    std::vector<short> yb0_;
+    std::vector<short> yb1_;
+    /* horizontally interpolated source rows and the blended row */
+    std::vector<int16_t> rows_[2];
+    std::vector<uint8_t> pixels_;
+};
+
+/*
+ * @brief ResizeQuantize - resize a BGR image and quantize it to an INT8
+ *        input Tensor in one pass
+ *
+ * Unlike dpuSetInputImage(), no resized or FP32 copy of the image is made:
+ * rows are interpolated in fixed point, as cv::resize() does for 8-bit
+ * images, and each interpolated pixel is quantized through a table to
+ * saturate(round((pixel - mean[c]) * scale)) and written in HWC order.
+ * The state is kept in an InputQuantizer per thread.
+ *
+ * @param image - BGR image, a ROI of a larger image is fine
+ * @param width - width of the Tensor
+ * @param height - height of the Tensor
+ * @param mean - mean of the B, G and R channels
+ * @param scale - scale applied after the mean, including the Tensor scale
+ * @param type - RESIZE_TYPE_LINEAR or RESIZE_TYPE_NEAREST as cv::resize()
+ *               with INTER_LINEAR or INTER_NEAREST, RESIZE_TYPE_NONE for
+ *               an image of the Tensor size
+ * @param tensor - output, width * height * 3 elements
+ *
+ * @return true on success, false for an unsupported image or type
+ */
+bool ResizeQuantize(const cv::Mat &image, int width, int height, const float *mean, float scale,
+                    RESIZE_TYPE type, int8_t *tensor);
+
+/*
+ * @brief SetInputImageFused - as dpuSetInputImageWithScale(), in one pass
+ *        through ResizeQuantize()
+ *
+ * @param input - input Tensor of the Task
+ * @param image - BGR image or ROI
+ * @param mean - mean of the B, G and R channels
+ * @param scale - scale applied after the mean; multiplied by the Tensor
+ *                scale, so 1 gives dpuSetInputImage()
+ * @param type - resize type
+ *
+ * @return true on success
+ */
+bool SetInputImageFused(const TensorHandle &input, const cv::Mat &image, const float *mean,
+                        float scale = 1.0f, RESIZE_TYPE type = RESIZE_TYPE_LINEAR);
+
+}
+
+#endif
@@ -0,0 +1,304 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <algorithm>
+#include <limits>
+
+#include "nms.h"
+
+namespace deephi {
+
+/* largest grid side, in cells */
+static const int kMaxCells = 64;
+
+/* fewer candidates are compared with all kept boxes, in one cell */
+static const int kMinGrid = 32;
+
+/* overlap() of adas_detection */
+static inline float Overlap(float x1, float w1, float x2, float w2) {
+    float left = std::max(x1 - w1 / 2.0, x2 - w2 / 2.0);
+    float right = std::min(x1 + w1 / 2.0, x2 + w2 / 2.0);
+    return right - left;
+}
+
+/* cal_iou() of adas_detection, box b compared with the kept box t */
+static inline float IouCenter(float bx, float by, float bw, float bh,
+                              float tx, float ty, float tw, float th) {
+    float w = Overlap(bx, bw, tx, tw);
+    float h = Overlap(by, bh, ty, th);
+
+    float inter_area = w * h;
+    float union_area = bw * bh + tw * th - inter_area;
+    float iou = inter_area * 1.0 / union_area;
+    return (w < 0 || h < 0) ? 0 : iou;
+}
+
+/* IoU of NMS() in face_detection, kept box i compared with box j */
+static inline float IouCorners(float ix1, float iy1, float ix2, float iy2,
+                               float jx1, float jy1, float jx2, float jy2) {
+    float x1 = std::max(ix1, jx1);
+    float y1 = std::max(iy1, jy1);
+    float x2 = std::min(ix2, jx2);
+    float y2 = std::min(iy2, jy2);
+    float w = std::max(float(0.0), x2 - x1 + 1);
+    float h = std::max(float(0.0), y2 - y1 + 1);
+    float iarea = (ix2 - ix1 + 1) * (iy2 - iy1 + 1);
+    float jarea = (jx2 - jx1 + 1) * (jy2 - jy1 + 1);
+    float inter = w * h;
+    return inter / (iarea + jarea - inter);
+}
+
+/* the boxes in decreasing score, sorted as the all-pairs sweeps did */
+static void SortByScore(const float *score, int n, std::vector<std::pair<int, float>> &order) {
+    order.resize(n);
+    for (int i = 0; i < n; ++i) {
+        order[i].first = i;
+        order[i].second = score[i];
+    }
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<int, float> &ls, const std::pair<int, float> &rs) {
+                  return ls.second > rs.second;
+              });
+}
+
+static inline int CellOf(double v, double origin, double scale, int cells) {
+    int c = (int)((v - origin) * scale);
+    return std::min(std::max(c, 0), cells - 1);
+}
+
+void NmsEngine::Extents(const Detections &boxes) {
+    int n = boxes.size();
+    const float *c0 = boxes.coord(0);
+    const float *c1 = boxes.coord(1);
+    const float *c2 = boxes.coord(2);
+    const float *c3 = boxes.coord(3);
+
+    left_.resize(n);
+    right_.resize(n);
+    top_.resize(n);
+    bottom_.resize(n);
+    if (format_ == CENTER_SIZE) {
+        /* the double bounds of Overlap(): a positive overlap needs them to
+           intersect, and the cells preserve their order */
+        for (int i = 0; i < n; i++) {
+            left_[i] = c0[i] - c2[i] / 2.0;
+            right_[i] = c0[i] + c2[i] / 2.0;
+            top_[i] = c1[i] - c3[i] / 2.0;
+            bottom_[i] = c1[i] + c3[i] / 2.0;
+        }
+    } else {
+        /* inclusive pixels overlap up to one pixel apart; the margin
+           covers the rounding of x2 - x1 + 1 */
+        for (int i = 0; i < n; i++) {
+            left_[i] = c0[i] - 0.5;
+            right_[i] = c2[i] + 1.5;
+            top_[i] = c1[i] - 0.5;
+            bottom_[i] = c3[i] + 1.5;
+        }
+    }
+}
+
+bool NmsEngine::Suppressed(const Cell &cell, const Detections &boxes, int j,
+                           float threshold) const {
+    const float *k0 = cell.coord[0].data();
+    const float *k1 = cell.coord[1].data();
+    const float *k2 = cell.coord[2].data();
+    const float *k3 = cell.coord[3].data();
+    const float j0 = boxes.coord(0)[j];
+    const float j1 = boxes.coord(1)[j];
+    const float j2 = boxes.coord(2)[j];
+    const float j3 = boxes.coord(3)[j];
+    int n = cell.coord[0].size();
+    int hit = 0;
+
+    if (format_ == CENTER_SIZE) {
+        for (int m = 0; m < n; m++) {
+            hit |= (IouCenter(j0, j1, j2, j3, k0[m], k1[m], k2[m], k3[m]) >= threshold);
+        }
+    } else {
+        for (int m = 0; m < n; m++) {
+            hit |= (IouCorners(k0[m], k1[m], k2[m], k3[m], j0, j1, j2, j3) >= threshold);
+        }
+    }
+    return hit;
+}
+
+void NmsEngine::Sweep(const Detections &boxes, int count, float threshold, int label,
+                      Detections &result) {
+    if (!count) {
+        return;
+    }
+
+    /* grid over the extents of the candidates, cells about their mean size */
+    double min_x = std::numeric_limits<double>::max(), max_x = -min_x;
+    double min_y = min_x, max_y = -min_x;
+    double sum_w = 0, sum_h = 0;
+    for (int c = 0; c < count; c++) {
+        int i = order_[c].first;
+        min_x = std::min(min_x, left_[i]);
+        max_x = std::max(max_x, right_[i]);
+        min_y = std::min(min_y, top_[i]);
+        max_y = std::max(max_y, bottom_[i]);
+        sum_w += right_[i] - left_[i];
+        sum_h += bottom_[i] - top_[i];
+    }
+    int nx = 1, ny = 1;
+    if (count >= kMinGrid && sum_w > 0 && sum_h > 0) {
+        nx = (int)std::min<double>(kMaxCells, std::max(1.0, (max_x - min_x) * count / sum_w));
+        ny = (int)std::min<double>(kMaxCells, std::max(1.0, (max_y - min_y) * count / sum_h));
+    }
+    double scale_x = (max_x > min_x) ? nx / (max_x - min_x) : 0;
+    double scale_y = (max_y > min_y) ? ny / (max_y - min_y) : 0;
+    if ((int)cells_.size() < nx * ny) {
+        cells_.resize(nx * ny);
+    }
+
+    for (int c = 0; c < count; c++) {
+        int j = order_[c].first;
+        int x0 = CellOf(left_[j], min_x, scale_x, nx);
+        int x1 = CellOf(right_[j], min_x, scale_x, nx);
+        int y0 = CellOf(top_[j], min_y, scale_y, ny);
+        int y1 = CellOf(bottom_[j], min_y, scale_y, ny);
+
+        bool suppressed = false;
+        for (int y = y0; y <= y1 && !suppressed; y++) {
+            for (int x = x0; x <= x1 && !suppressed; x++) {
+                suppressed = Suppressed(cells_[y * nx + x], boxes, j, threshold);
+            }
+        }
+        if (suppressed) {
+            continue;
+        }
+
+        result.Add(boxes, j, label);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                Cell &cell = cells_[y * nx + x];
+                if (cell.coord[0].empty()) {
+                    used_.push_back(y * nx + x);
+                }
+                for (int k = 0; k < 4; k++) {
+                    cell.coord[k].push_back(boxes.coord(k)[j]);
+                }
+            }
+        }
+    }
+
+    for (int u : used_) {
+        for (auto &coord : cells_[u].coord) {
+            coord.clear();
+        }
+    }
+    used_.clear();
+}
+
+void NmsEngine::Run(const Detections &boxes, float threshold, float min_score,
+                    Detections &result) {
+    /* every box suppresses every other one, overlapping or not */
+    if (!(threshold > 0)) {
+        NmsAllPairs(format_, boxes, threshold, min_score, result);
+        return;
+    }
+
+    int classes = boxes.classes();
+    if (result.classes() != classes) {
+        result.set_classes(classes);
+    }
+    result.clear();
+
+    int n = boxes.size();
+    Extents(boxes);
+    for (int k = 0; k < std::max(classes, 1); k++) {
+        SortByScore(classes ? boxes.class_score(k) : boxes.score(), n, order_);
+        int count = 0;
+        while (count < n && !(order_[count].second < min_score)) {
+            count++;
+        }
+        Sweep(boxes, count, threshold, classes ? k : -1, result);
+    }
+}
+
+void NmsAllPairs(NmsEngine::Format format, const Detections &boxes, float threshold,
+                 float min_score, Detections &result) {
+    int classes = boxes.classes();
+    if (result.classes() != classes) {
+        result.set_classes(classes);
+    }
+    result.clear();
+
+    int n = boxes.size();
+    const float *c0 = boxes.coord(0);
+    const float *c1 = boxes.coord(1);
+    const float *c2 = boxes.coord(2);
+    const float *c3 = boxes.coord(3);
+    std::vector<std::pair<int, float>> order;
+    std::vector<bool> exist_box(n);
+
+    for (int k = 0; k < std::max(classes, 1); k++) {
+        SortByScore(classes ? boxes.class_score(k) : boxes.score(), n, order);
+        std::fill(exist_box.begin(), exist_box.end(), true);
+
+        for (int _i = 0; _i < n; ++_i) {
+            int i = order[_i].first;
+            if (!exist_box[i]) continue;
+            if (order[_i].second < min_score) break;
+            result.Add(boxes, i, classes ? k : -1);
+
+            for (int _j = _i + 1; _j < n; ++_j) {
+                int j = order[_j].first;
+                if (!exist_box[j]) continue;
+                float ovr = (format == NmsEngine::CENTER_SIZE)
+                    ? IouCenter(c0[j], c1[j], c2[j], c3[j], c0[i], c1[i], c2[i], c3[i])
+                    : IouCorners(c0[i], c1[i], c2[i], c3[i], c0[j], c1[j], c2[j], c3[j]);
+                if (ovr >= threshold) exist_box[j] = false;
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_NMS_H_
+#define DEEPHI_NMS_H_
+
+#include <utility>
+#include <vector>
+
+#include "detections.h"
+
+namespace deephi {
+
+/*
+ * class NmsEngine: greedy non-maximum suppression of all classes at once
+ *
+ * Each class is swept in score order: a box is kept unless a kept box of
+ * its class overlaps it with an IoU of at least the threshold. Instead of
+ * comparing each kept box with all lower-scored boxes, kept boxes are
+ * binned into a uniform grid sized from the candidates, and a candidate is
+ * only compared with the kept boxes of the cells its extent covers. The
+ * coordinates of a cell are contiguous and compared in a branch-free loop
+ * that vectorizes. The extents are computed once for all classes.
+ *
+ * The order of the candidates is that of the all-pairs sweeps, the same
+ * std::sort of all boxes per class, and the IoU is computed with the
+ * arithmetic of the sample it replaces: the boxes kept and their order
+ * are those of NmsAllPairs(), ties included.
+ *
+ * The grid and the sort buffers are kept from call to call: use one
+ * engine per thread.
+ */
+class NmsEngine {
+public:
+    enum Format {
+        /* x, y, w, h: center and size, IoU of cal_iou() in adas_detection */
+        CENTER_SIZE,
+        /* xmin, ymin, xmax, ymax: inclusive pixel corners, IoU of NMS()
+           in face_detection */
+        CORNERS
+    };
+
+    explicit NmsEngine(Format format) : format_(format) {}
+
+    /*
+     * @brief Run - suppress the overlapping boxes of every class
+     *
+     * @param boxes - candidates; per class, the class scores are used, or
+     *                the score for boxes without classes
+     * @param threshold - IoU from which the lower-scored box is dropped
+     * @param min_score - boxes scoring less are never kept
+     * @param result - kept boxes, class by class in score order, labelled
+     *                 with their class, -1 for boxes without classes
+     *
+     * @return none
+     */
+    void Run(const Detections &boxes, float threshold, float min_score, Detections &result);
+
+private:
+    struct Cell {
+        std::vector<float> coord[4];
+    };
+
+    void Extents(const Detections &boxes);
+    void Sweep(const Detections &boxes, int count, float threshold, int label,
+               Detections &result);
+    bool Suppressed(const Cell &cell, const Detections &boxes, int j, float threshold) const;
+
+    Format format_;
+    /* boxes in score order of the class being swept */
+    std::vector<std::pair<int, float>> order_;
+    /* extent of every box: no IoU above zero without overlapping extents */
+    std::vector<double> left_, right_, top_, bottom_;
+    std::vector<Cell> cells_;
+    std::vector<int> used_;
+};
+
+/*
+ * @brief NmsAllPairs - the sweeps NmsEngine replaces: for every class,
+ *        sort all boxes and compare each kept box with all lower-scored
+ *        ones. O(n^2), kept as the reference of nms_bench.
+ *
+ * Same parameters and result as NmsEngine::Run().
+ */
+void NmsAllPairs(NmsEngine::Format format, const Detections &boxes, float threshold,
+                 float min_score, Detections &result);
+
+}
+
+#endif
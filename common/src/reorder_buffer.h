@@ -0,0 +1,262 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_REORDER_BUFFER_H_
+#define DEEPHI_REORDER_BUFFER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace deephi {
+
+/*
+ * class ReorderBuffer: puts back in sequence the items that worker threads
+ * finish out of order, for one consumer. Item seq goes to slot seq % capacity
+ * of a ring; Next() releases the items in sequence order and sleeps until the
+ * next one is there, so both sides are O(1) and nobody polls.
+ *
+ * A sequence number that will never be Put(), e.g. a dropped frame, must be
+ * skipped with Skip() or the consumer waits for it. Put() blocks while seq is
+ * capacity or more ahead of the next item to release, so capacity must exceed
+ * the items in flight between the producer of the sequence and the buffer.
+ * Close() lets the consumer release what is left, skipping the gaps, and then
+ * makes Next() return false.
+ */
+template <typename T>
+class ReorderBuffer {
+public:
+    /*
+     * @param capacity - slots of the ring
+     * @param first - sequence number of the first item
+     */
+    explicit ReorderBuffer(size_t capacity, long first = 0)
+        : capacity_(capacity ? capacity : 1), items_(capacity_), state_(capacity_, EMPTY),
+          next_(first), end_(first), held_(0), closed_(false), put_waiters_(0), next_waiting_(false),
+          puts_(0), skips_(0), depth_sum_(0), depth_max_(0) {}
+
+    /*
+     * @brief Put - store item seq, waiting while it is too far ahead
+     *
+     * @return false if the buffer has been closed, or seq was already
+     *         passed over
+     */
+    bool Put(long seq, T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!Reserve(seq, lock)) {
+            return false;
+        }
+
+        items_[seq % capacity_] = std::move(item);
+        state_[seq % capacity_] = READY;
+        held_++;
+
+        /* sample the items held right after each put */
+        depth_sum_ += held_;
+        if (held_ > depth_max_) {
+            depth_max_ = held_;
+        }
+        puts_++;
+
+        Stored(seq, lock);
+        return true;
+    }
+
+    /*
+     * @brief Skip - declare that item seq will never come
+     *
+     * @return false if the buffer has been closed, or seq was already
+     *         passed over
+     */
+    bool Skip(long seq) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!Reserve(seq, lock)) {
+            return false;
+        }
+
+        state_[seq % capacity_] = SKIPPED;
+        skips_++;
+
+        Stored(seq, lock);
+        return true;
+    }
+
+    /*
+     * @brief Next - release the next item in sequence order, waiting for it
+     *
+     * @param seq - sequence number of the item
+     *
+     * @return false once the buffer is closed and drained
+     */
+    bool Next(long &seq, T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            /* pass over the skipped items, and over the gaps once closed */
+            while (next_ < end_ && state_[next_ % capacity_] != READY &&
+                   (closed_ || state_[next_ % capacity_] == SKIPPED)) {
+                state_[next_ % capacity_] = EMPTY;
+                next_++;
+            }
+            if (next_ < end_ && state_[next_ % capacity_] == READY) {
+                break;
+            }
+            if (closed_) {
+                return false;
+            }
+
+            next_waiting_ = true;
+            ready_.wait(lock);
+            next_waiting_ = false;
+        }
+
+        seq = next_;
+        item = std::move(items_[next_ % capacity_]);
+        state_[next_ % capacity_] = EMPTY;
+        next_++;
+        held_--;
+
+        bool wake = put_waiters_ > 0;
+        lock.unlock();
+        if (wake) {
+            space_.notify_all();
+        }
+        return true;
+    }
+
+    /*
+     * @brief Close - mark the end of the sequence and wake all waiters
+     */
+    void Close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        ready_.notify_all();
+        space_.notify_all();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    /* sequence numbers skipped, by Skip() only */
+    unsigned long long skipped() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return skips_;
+    }
+
+    /* average number of items held, including the one just put, seen by Put() */
+    double AverageDepth() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return puts_ ? (double)depth_sum_ / puts_ : 0.0;
+    }
+
+    /* largest number of items held, seen by Put() */
+    size_t MaxDepth() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return depth_max_;
+    }
+
+    /* print the depth and the skipped items */
+    void Report(const char *name, FILE *fp = stdout) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        fprintf(fp, "[Reorder] %s: %llu items  %llu skipped  depth avg %.2f max %zu of %zu\n", name,
+                puts_, skips_, puts_ ? (double)depth_sum_ / puts_ : 0.0, depth_max_, capacity_);
+    }
+
+private:
+    enum State { EMPTY, READY, SKIPPED };
+
+    /* wait for the slot of seq to be in the window; false if closed or seq
+       was already passed over */
+    bool Reserve(long seq, std::unique_lock<std::mutex> &lock) {
+        if (!closed_ && seq >= next_ + (long)capacity_) {
+            put_waiters_++;
+            space_.wait(lock, [&] { return closed_ || seq < next_ + (long)capacity_; });
+            put_waiters_--;
+        }
+        return !closed_ && seq >= next_;
+    }
+
+    /* account for seq and wake the consumer if it waits for it */
+    void Stored(long seq, std::unique_lock<std::mutex> &lock) {
+        if (seq >= end_) {
+            end_ = seq + 1;
+        }
+
+        bool wake = next_waiting_ && seq == next_;
+        lock.unlock();
+        if (wake) {
+            ready_.notify_one();
+        }
+    }
+
+    const size_t capacity_;
+    std::vector<T> items_;
+    std::vector<char> state_;
+
+    /* next item to release, one past the last item stored */
+    long next_;
+    long end_;
+    size_t held_;
+    bool closed_;
+
+    mutable std::mutex mtx_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    int put_waiters_;
+    bool next_waiting_;
+
+    unsigned long long puts_;
+    unsigned long long skips_;
+    unsigned long long depth_sum_;
+    size_t depth_max_;
+};
+
+}
+
+#endif
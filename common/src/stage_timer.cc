@@ -0,0 +1,252 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <pthread.h>
+#include <signal.h>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stage_timer.h"
+
+namespace deephi {
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+    for (auto &c : counts_) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other) {
+    for (int i = 0; i < BUCKET_NUM; i++) {
+        uint64_t c = other.counts_[i].load(std::memory_order_relaxed);
+        if (c) {
+            counts_[i].fetch_add(c, std::memory_order_relaxed);
+        }
+    }
+    count_.fetch_add(other.count(), std::memory_order_relaxed);
+    sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (other.max() > max()) {
+        max_.store(other.max(), std::memory_order_relaxed);
+    }
+}
+
+double LatencyHistogram::Mean() const {
+    uint64_t n = count();
+    return n ? (double)sum_.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::BucketLow(int i) {
+    if (i < 2 * SUB_COUNT) {
+        return i;
+    }
+    int exp = i / SUB_COUNT + SUB_BITS - 1;
+    return (uint64_t)(i % SUB_COUNT + SUB_COUNT) << (exp - SUB_BITS);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+
+    /* nearest rank */
+    uint64_t rank = (uint64_t)ceil(p * n);
+    rank = rank < 1 ? 1 : (rank > n ? n : rank);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_NUM; i++) {
+        seen += counts_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            if (i + 1 == BUCKET_NUM) {
+                return max();
+            }
+            uint64_t low = BucketLow(i);
+            uint64_t mid = low + (BucketLow(i + 1) - low) / 2;
+            return mid < max() ? mid : max();
+        }
+    }
+    return max();
+}
+
+/*
+ * Histograms of one thread, one per stage, allocated on the first record
+ * of the stage. Never freed, so that the stages of finished threads are
+ * still dumped.
+ */
+struct ThreadStages {
+    std::atomic<LatencyHistogram *> stages[STAGE_MAX_NUM];
+
+    ThreadStages() {
+        for (auto &s : stages) {
+            s.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+static std::mutex registryMutex;
+static std::string stageNames[STAGE_MAX_NUM];
+static std::atomic<int> stageNum(0);
+static std::vector<std::unique_ptr<ThreadStages>> threadStages;
+
+int RegisterStage(const char *name) {
+    /* "#func" keeps the spaces of the source, collapse them */
+    std::string stage;
+    for (const char *c = name; *c; c++) {
+        if (!isspace(*c)) {
+            stage += *c;
+        } else if (!stage.empty() && stage.back() != ' ' && c[1] && !isspace(c[1])) {
+            stage += ' ';
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    int num = stageNum.load(std::memory_order_relaxed);
+    for (int i = 0; i < num; i++) {
+        if (stageNames[i] == stage) {
+            return i;
+        }
+    }
+    if (num == STAGE_MAX_NUM) {
+        return -1;
+    }
+
+    stageNames[num] = stage;
+    stageNum.store(num + 1, std::memory_order_release);
+    return num;
+}
+
+static ThreadStages *CurrentThreadStages() {
+    static thread_local ThreadStages *stages = nullptr;
+    if (!stages) {
+        stages = new ThreadStages();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadStages.emplace_back(stages);
+    }
+    return stages;
+}
+
+void RecordStage(int stage, uint64_t ns) {
+    if (stage < 0 || stage >= STAGE_MAX_NUM) {
+        return;
+    }
+
+    std::atomic<LatencyHistogram *> &slot = CurrentThreadStages()->stages[stage];
+    LatencyHistogram *histogram = slot.load(std::memory_order_relaxed);
+    if (!histogram) {
+        histogram = new LatencyHistogram();
+        slot.store(histogram, std::memory_order_release);
+    }
+    histogram->Record(ns);
+}
+
+void DumpStageHistograms(FILE *fp) {
+    int num = stageNum.load(std::memory_order_acquire);
+    std::unique_ptr<LatencyHistogram[]> merged(new LatencyHistogram[num]);
+
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &thread : threadStages) {
+            for (int i = 0; i < num; i++) {
+                LatencyHistogram *h = thread->stages[i].load(std::memory_order_acquire);
+                if (h) {
+                    merged[i].Merge(*h);
+                }
+            }
+        }
+    }
+
+    fprintf(fp, "[Stage] %-40s %10s %10s %10s %10s %10s %10s %10s (us)\n", "name", "count",
+            "mean", "p50", "p90", "p99", "p999", "max");
+    for (int i = 0; i < num; i++) {
+        const LatencyHistogram &h = merged[i];
+        if (h.count() == 0) {
+            continue;
+        }
+        fprintf(fp, "[Stage] %-40.40s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                stageNames[i].c_str(), (unsigned long long)h.count(), h.Mean() / 1000.0,
+                h.Percentile(0.5) / 1000.0, h.Percentile(0.9) / 1000.0,
+                h.Percentile(0.99) / 1000.0, h.Percentile(0.999) / 1000.0, h.max() / 1000.0);
+    }
+    fflush(fp);
+}
+
+static void DumpAtExit() {
+    DumpStageHistograms(stdout);
+}
+
+void InstallStageDump(int signo) {
+    static std::once_flag once;
+    std::call_once(once, [signo]() {
+        atexit(DumpAtExit);
+        if (signo <= 0) {
+            return;
+        }
+
+        /* Threads created later inherit the mask, so only the helper gets
+           the signal and may print outside of a signal handler */
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, signo);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+        std::thread([set]() {
+            int sig;
+            while (sigwait(&set, &sig) == 0) {
+                DumpStageHistograms(stdout);
+            }
+        }).detach();
+    });
+}
+
+}
@@ -0,0 +1,180 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_STAGE_TIMER_H_
+#define DEEPHI_STAGE_TIMER_H_
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+
+namespace deephi {
+
+/* largest number of named stages */
+#define STAGE_MAX_NUM 64
+
+/*
+ * Log-linear latency histogram, as in HdrHistogram
+ *
+ * Values below 64ns get a bucket each; above, every power of two is split
+ * into 32 linear buckets, so a bucket is at most 1/32 of its value wide.
+ * A histogram has a single writer; readers may merge it at any time.
+ */
+class LatencyHistogram {
+public:
+    enum {
+        SUB_BITS = 5,
+        SUB_COUNT = 1 << SUB_BITS,
+        BUCKET_NUM = (64 - SUB_BITS + 1) * SUB_COUNT
+    };
+
+    LatencyHistogram();
+
+    /* record one value, only from the owning thread */
+    void Record(uint64_t ns) {
+        int i = Bucket(ns);
+        counts_[i].store(counts_[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        if (ns > max_.load(std::memory_order_relaxed)) {
+            max_.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    /* add the counts of other to this histogram */
+    void Merge(const LatencyHistogram &other);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double Mean() const;
+
+    /* value at percentile p in [0, 1], middle of its bucket */
+    uint64_t Percentile(double p) const;
+
+    static int Bucket(uint64_t ns) {
+        if (ns < 2 * SUB_COUNT) {
+            return ns;
+        }
+        int exp = 63 - __builtin_clzll(ns);
+        return (exp - SUB_BITS) * SUB_COUNT + (int)(ns >> (exp - SUB_BITS));
+    }
+
+    /* smallest value of bucket i */
+    static uint64_t BucketLow(int i);
+
+private:
+    std::atomic<uint64_t> counts_[BUCKET_NUM];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+/*
+ * @brief RegisterStage - get the id of a named stage, registering it on
+ *        first use. Runs of whitespace in the name are collapsed, so that
+ *        "#func" of a call can be used.
+ *
+ * @return stage id, -1 if STAGE_MAX_NUM stages are registered already
+ */
+int RegisterStage(const char *name);
+
+/*
+ * @brief RecordStage - record the latency of one run of a stage into the
+ *        histogram of the calling thread. Lock-free.
+ */
+void RecordStage(int stage, uint64_t ns);
+
+/*
+ * class StageTimer: record the lifetime of the object as one run of a stage
+ */
+class StageTimer {
+public:
+    explicit StageTimer(int stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        auto end = std::chrono::steady_clock::now();
+        RecordStage(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+    }
+
+private:
+    int stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/*
+ * @brief DumpStageHistograms - merge the histograms of all threads and
+ *        print count, mean and percentiles of every stage
+ */
+void DumpStageHistograms(FILE *fp = stdout);
+
+/*
+ * @brief InstallStageDump - dump the histograms at exit and whenever signo
+ *        is received
+ *
+ * The signal is blocked and waited for by a helper thread, so call it at
+ * the start of main(), before other threads are created.
+ *
+ * @param signo - signal triggering a dump, 0 to only dump at exit
+ */
+void InstallStageDump(int signo = SIGUSR1);
+
+}
+
+/*
+ * Time a statement into the histogram of the stage named after it, e.g.
+ * STAGE_TIME(dpuRunTask(task)). Costs two clock reads.
+ */
+#define STAGE_TIME(func)                                                  \
+{                                                                         \
+    static const int _stage = deephi::RegisterStage(#func);               \
+    deephi::StageTimer _timer(_stage);                                    \
+    func;                                                                 \
+}
+
+#endif
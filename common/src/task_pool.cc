@@ -0,0 +1,192 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <chrono>
+#include <cstdio>
+
+#include "task_pool.h"
+
+using namespace std::chrono;
+
+namespace deephi {
+
+TaskPool::~TaskPool() {
+    Release();
+}
+
+bool TaskPool::Add(DPUKernel *kernel, int initial, int limit, const std::string &name, int mode) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (entries_.count(kernel)) {
+            fprintf(stderr, "Error: DPU Kernel %s already added to the Task pool.\n", name.c_str());
+            return false;
+        }
+    }
+
+    std::unique_ptr<Entry> entry(new Entry);
+    entry->name = name;
+    entry->limit = (limit > 0) ? limit : 1;
+    entry->mode = mode;
+    entry->created = 0;
+    entry->checkouts = entry->waits = 0;
+    entry->wait_us = entry->max_wait_us = 0;
+
+    /* create the initial Tasks before the threads start, not on their
+       first frame */
+    for (int i = 0; i < initial && i < entry->limit; i++) {
+        DPUTask *task = dpuCreateTask(kernel, mode);
+        if (!task) {
+            fprintf(stderr, "Error: Fail to create DPU Task %d of %s.\n", i, name.c_str());
+            for (auto created : entry->free) {
+                dpuDestroyTask(created);
+            }
+            return false;
+        }
+        entry->free.push_back(task);
+        entry->created++;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!entries_.emplace(kernel, nullptr).second) {
+        fprintf(stderr, "Error: DPU Kernel %s already added to the Task pool.\n", name.c_str());
+        for (auto task : entry->free) {
+            dpuDestroyTask(task);
+        }
+        return false;
+    }
+    for (auto task : entry->free) {
+        owners_[task] = entry.get();
+    }
+    entries_[kernel] = std::move(entry);
+    return true;
+}
+
+DPUTask *TaskPool::Checkout(DPUKernel *kernel) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto it = entries_.find(kernel);
+    if (it == entries_.end()) {
+        fprintf(stderr, "Error: DPU Kernel not added to the Task pool.\n");
+        return nullptr;
+    }
+    Entry &e = *it->second;
+    e.checkouts++;
+
+    if (e.free.empty() && e.created < e.limit) {
+        e.created++;
+        lock.unlock();
+        DPUTask *task = dpuCreateTask(kernel, e.mode);
+        lock.lock();
+        if (task) {
+            owners_[task] = &e;
+            return task;
+        }
+
+        /* make do with the Tasks created so far */
+        fprintf(stderr, "Error: Fail to create a DPU Task of %s.\n", e.name.c_str());
+        e.created--;
+        e.limit = e.created;
+        if (e.created == 0) {
+            return nullptr;
+        }
+    }
+
+    if (e.free.empty()) {
+        auto start = steady_clock::now();
+        e.cv.wait(lock, [&e] { return !e.free.empty(); });
+        long long us = duration_cast<microseconds>(steady_clock::now() - start).count();
+        e.waits++;
+        e.wait_us += us;
+        if (us > e.max_wait_us) {
+            e.max_wait_us = us;
+        }
+    }
+
+    DPUTask *task = e.free.back();
+    e.free.pop_back();
+    return task;
+}
+
+void TaskPool::Return(DPUTask *task) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto it = owners_.find(task);
+    if (it == owners_.end()) {
+        return;
+    }
+    Entry &e = *it->second;
+    e.free.push_back(task);
+    lock.unlock();
+    e.cv.notify_one();
+}
+
+void TaskPool::Report() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &it : entries_) {
+        const Entry &e = *it.second;
+        printf("[TaskPool] %-16s tasks %d/%d  checkouts %ld  waited %ld  avg wait %.1fus  max wait %lldus\n",
+               e.name.c_str(), e.created, e.limit, e.checkouts, e.waits,
+               e.waits ? (double)e.wait_us / e.waits : 0.0, e.max_wait_us);
+    }
+}
+
+void TaskPool::Release() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &it : entries_) {
+        Entry &e = *it.second;
+        if ((int)e.free.size() != e.created) {
+            fprintf(stderr, "Warning: %d Tasks of %s are still checked out.\n",
+                    e.created - (int)e.free.size(), e.name.c_str());
+        }
+        for (auto task : e.free) {
+            dpuDestroyTask(task);
+        }
+    }
+    entries_.clear();
+    owners_.clear();
+}
+
+}
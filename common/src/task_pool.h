@@ -0,0 +1,160 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_TASK_POOL_H_
+#define DEEPHI_TASK_POOL_H_
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dnndk/dnndk.h>
+
+namespace deephi {
+
+/*
+ * class TaskPool: DPU Tasks shared by all threads, keyed by DPU Kernel
+ *
+ * Tasks are created up front and handed to whichever thread checks one
+ * out, so that the number of inferences in flight is set by the pool size
+ * rather than by the number of threads. A Kernel's pool grows on demand up
+ * to its limit; beyond that Checkout() waits for a Task to be returned, and
+ * the time spent waiting is reported. When a Task cannot be created on
+ * demand, the limit drops to the Tasks already created.
+ */
+class TaskPool {
+public:
+    TaskPool() {}
+    ~TaskPool();
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    /*
+     * @brief Add - pool the Tasks of a Kernel
+     *
+     * @param kernel - DPU Kernel to create the Tasks from
+     * @param initial - number of Tasks created right away
+     * @param limit - largest number of Tasks of the Kernel
+     * @param name - name of the Kernel in Report()
+     * @param mode - mode of dpuCreateTask()
+     *
+     * @return false if the Kernel was already added or an initial Task
+     *         could not be created
+     */
+    bool Add(DPUKernel *kernel, int initial, int limit, const std::string &name = "",
+             int mode = T_MODE_NORMAL);
+
+    /*
+     * @brief Checkout - take a Task of the Kernel, creating one if the pool
+     *        is below its limit or waiting for one to be returned
+     *
+     * @return the Task, nullptr if the Kernel was not added
+     */
+    DPUTask *Checkout(DPUKernel *kernel);
+
+    /* give a Task back to the pool */
+    void Return(DPUTask *task);
+
+    /* print, for every Kernel, Tasks created, checkouts and waiting time */
+    void Report() const;
+
+    /* destroy all Tasks, which must have been returned; call before
+       destroying the Kernels */
+    void Release();
+
+private:
+    struct Entry {
+        std::string name;
+        int limit;
+        int mode;
+        int created;
+        std::vector<DPUTask *> free;
+        std::condition_variable cv;
+
+        long checkouts;
+        long waits;
+        long long wait_us;
+        long long max_wait_us;
+    };
+
+    mutable std::mutex mtx_;
+    std::map<DPUKernel *, std::unique_ptr<Entry>> entries_;
+    std::unordered_map<DPUTask *, Entry *> owners_;
+};
+
+/*
+ * class TaskLease: a Task checked out of a TaskPool for the lifetime of the
+ * object, usable wherever a DPUTask * is expected
+ */
+class TaskLease {
+public:
+    TaskLease(TaskPool &pool, DPUKernel *kernel) : pool_(pool), task_(pool.Checkout(kernel)) {}
+    ~TaskLease() {
+        if (task_) {
+            pool_.Return(task_);
+        }
+    }
+
+    TaskLease(const TaskLease &) = delete;
+    TaskLease &operator=(const TaskLease &) = delete;
+
+    DPUTask *get() const { return task_; }
+    operator DPUTask *() const { return task_; }
+
+private:
+    TaskPool &pool_;
+    DPUTask *task_;
+};
+
+}
+
+#endif
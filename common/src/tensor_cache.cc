@@ -0,0 +1,354 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "tensor_cache.h"
+
+namespace deephi {
+
+/*
+ * File layout:
+ *   TensorCacheHeader
+ *   TensorCacheEntry[count]
+ *   Tensors, from tensor_offset, tensor_stride bytes apart
+ * Tensors start on a page boundary and every Tensor on a cache line.
+ */
+#define TENSOR_CACHE_MAGIC      "DPUTCACH"
+#define TENSOR_CACHE_VERSION    1
+#define TENSOR_CACHE_NAME_LEN   120
+#define TENSOR_CACHE_PAGE       4096
+#define TENSOR_CACHE_LINE       64
+
+struct TensorCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int32_t width;
+    int32_t height;
+    int32_t channel;
+    float mean[3];
+    float scale;
+    uint32_t reserved;
+    uint64_t tensor_offset;
+    uint64_t tensor_stride;
+};
+
+struct TensorCacheEntry {
+    char name[TENSOR_CACHE_NAME_LEN];
+    uint32_t valid;
+    uint32_t reserved;
+};
+
+static size_t AlignUp(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+void QuantizeImage(const cv::Mat &image, const TensorCacheKey &key, int8_t *tensor) {
+    /* A pixel only takes 256 values, so quantize through a table per channel */
+    int8_t table[3][256];
+    for (int c = 0; c < 3; c++) {
+        for (int p = 0; p < 256; p++) {
+            long v = lrintf((p - key.mean[c]) * key.scale);
+            table[c][p] = (int8_t)(v > 127 ? 127 : (v < -128 ? -128 : v));
+        }
+    }
+
+    int rowSize = key.width * key.channel;
+    for (int h = 0; h < key.height; h++) {
+        const uint8_t *row = image.ptr<uint8_t>(h);
+        int8_t *out = tensor + h * rowSize;
+        for (int i = 0; i < rowSize; i += key.channel) {
+            for (int c = 0; c < key.channel; c++) {
+                out[i + c] = table[c % 3][row[i + c]];
+            }
+        }
+    }
+}
+
+TensorCache::TensorCache() : base_(nullptr), length_(0), count_(0), tensor_size_(0) {
+    memset(&key_, 0, sizeof(key_));
+}
+
+TensorCache::~TensorCache() {
+    Close();
+}
+
+bool TensorCache::Open(const std::string &path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Fail to open tensor cache %s.\n", path.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TensorCacheHeader)) {
+        fprintf(stderr, "Error: %s is not a tensor cache.\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Error: Fail to map tensor cache %s.\n", path.c_str());
+        return false;
+    }
+    base_ = (uint8_t *)addr;
+    length_ = st.st_size;
+
+    /* the sizes come from the file: check them in 64 bits, without any
+       product that can wrap, before trusting an offset */
+    const TensorCacheHeader *header = (const TensorCacheHeader *)base_;
+    const TensorCacheEntry *entries = (const TensorCacheEntry *)(header + 1);
+    bool valid = memcmp(header->magic, TENSOR_CACHE_MAGIC, sizeof(header->magic)) == 0
+                 && header->version == TENSOR_CACHE_VERSION
+                 && header->width > 0 && header->height > 0 && header->channel > 0
+                 && header->count <= INT_MAX
+                 && sizeof(TensorCacheHeader) + (uint64_t)header->count * sizeof(TensorCacheEntry)
+                        <= header->tensor_offset
+                 && header->tensor_offset <= length_;
+    uint64_t pixels = valid ? (uint64_t)header->width * header->height : 1;
+    valid = valid && (uint64_t)header->channel <= header->tensor_stride / pixels
+            && header->tensor_stride <= length_
+            && (header->count == 0
+                || header->tensor_stride <= (length_ - header->tensor_offset) / header->count);
+    for (uint32_t i = 0; valid && i < header->count; i++) {
+        valid = entries[i].name[sizeof(entries[i].name) - 1] == '\0';
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: %s is not a tensor cache.\n", path.c_str());
+        Close();
+        return false;
+    }
+
+    key_.width = header->width;
+    key_.height = header->height;
+    key_.channel = header->channel;
+    memcpy(key_.mean, header->mean, sizeof(key_.mean));
+    key_.scale = header->scale;
+    count_ = header->count;
+    tensor_size_ = pixels * header->channel;
+
+    for (int i = 0; i < count_; i++) {
+        if (entries[i].valid) {
+            index_[std::string(entries[i].name)] = i;
+        }
+    }
+
+    /* Tensors are read in the order of the index, let the kernel read ahead */
+    madvise(base_, length_, MADV_WILLNEED);
+
+    return true;
+}
+
+void TensorCache::Close() {
+    if (base_) {
+        munmap(base_, length_);
+    }
+    base_ = nullptr;
+    length_ = 0;
+    count_ = 0;
+    tensor_size_ = 0;
+    index_.clear();
+}
+
+bool TensorCache::Matches(const TensorCacheKey &key) const {
+    auto same = [](float a, float b) {
+        return fabs(a - b) <= 1e-6 * fabs(b);
+    };
+
+    return base_ && key.width == key_.width && key.height == key_.height
+        && key.channel == key_.channel && same(key_.mean[0], key.mean[0])
+        && same(key_.mean[1], key.mean[1]) && same(key_.mean[2], key.mean[2])
+        && same(key_.scale, key.scale);
+}
+
+const char *TensorCache::name(int i) const {
+    const TensorCacheEntry *entries = (const TensorCacheEntry *)(base_ + sizeof(TensorCacheHeader));
+    return entries[i].name;
+}
+
+const int8_t *TensorCache::tensor(int i) const {
+    const TensorCacheHeader *header = (const TensorCacheHeader *)base_;
+    const TensorCacheEntry *entries = (const TensorCacheEntry *)(header + 1);
+    if (!entries[i].valid) {
+        return nullptr;
+    }
+    return (const int8_t *)(base_ + header->tensor_offset + header->tensor_stride * i);
+}
+
+const int8_t *TensorCache::Find(const std::string &name) const {
+    auto it = index_.find(name);
+    return (it == index_.end()) ? nullptr : tensor(it->second);
+}
+
+TensorCacheWriter::TensorCacheWriter() : base_(nullptr), length_(0), count_(0) {
+    memset(&key_, 0, sizeof(key_));
+}
+
+TensorCacheWriter::~TensorCacheWriter() {
+    Abort();
+}
+
+bool TensorCacheWriter::Create(const std::string &path, const TensorCacheKey &key,
+                               const std::vector<std::string> &names) {
+    Abort();
+
+    size_t size = (size_t)key.width * key.height * key.channel;
+    size_t stride = AlignUp(size, TENSOR_CACHE_LINE);
+    size_t offset = AlignUp(sizeof(TensorCacheHeader) + sizeof(TensorCacheEntry) * names.size(),
+                            TENSOR_CACHE_PAGE);
+
+    path_ = path;
+    temp_path_ = path + ".tmp";
+    key_ = key;
+    count_ = names.size();
+    length_ = offset + stride * names.size();
+
+    int fd = open(temp_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Fail to create %s.\n", temp_path_.c_str());
+        return false;
+    }
+    if (ftruncate(fd, length_) != 0) {
+        fprintf(stderr, "Error: Fail to allocate %zu bytes for %s.\n", length_, temp_path_.c_str());
+        close(fd);
+        unlink(temp_path_.c_str());
+        return false;
+    }
+
+    void *addr = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Error: Fail to map %s.\n", temp_path_.c_str());
+        unlink(temp_path_.c_str());
+        return false;
+    }
+    base_ = (uint8_t *)addr;
+
+    TensorCacheHeader *header = (TensorCacheHeader *)base_;
+    memcpy(header->magic, TENSOR_CACHE_MAGIC, sizeof(header->magic));
+    header->version = TENSOR_CACHE_VERSION;
+    header->count = count_;
+    header->width = key.width;
+    header->height = key.height;
+    header->channel = key.channel;
+    memcpy(header->mean, key.mean, sizeof(header->mean));
+    header->scale = key.scale;
+    header->tensor_offset = offset;
+    header->tensor_stride = stride;
+
+    TensorCacheEntry *entries = (TensorCacheEntry *)(header + 1);
+    for (int i = 0; i < count_; i++) {
+        /* an entry without name is never stored nor found */
+        if (names[i].size() >= TENSOR_CACHE_NAME_LEN) {
+            fprintf(stderr, "Warning: name %s is too long for the tensor cache.\n",
+                    names[i].c_str());
+            continue;
+        }
+        strcpy(entries[i].name, names[i].c_str());
+    }
+
+    return true;
+}
+
+bool TensorCacheWriter::Store(int i, const cv::Mat &image) {
+    if (!base_ || i < 0 || i >= count_ || image.type() != CV_8UC3
+        || image.cols != key_.width || image.rows != key_.height) {
+        return false;
+    }
+
+    TensorCacheHeader *header = (TensorCacheHeader *)base_;
+    TensorCacheEntry *entries = (TensorCacheEntry *)(header + 1);
+    if (entries[i].name[0] == '\0') {
+        return false;
+    }
+
+    QuantizeImage(image, key_, (int8_t *)(base_ + header->tensor_offset + header->tensor_stride * i));
+    entries[i].valid = 1;
+
+    return true;
+}
+
+bool TensorCacheWriter::Commit() {
+    if (!base_) {
+        return false;
+    }
+
+    bool ok = (msync(base_, length_, MS_SYNC) == 0);
+    munmap(base_, length_);
+    base_ = nullptr;
+
+    if (!ok || rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        fprintf(stderr, "Error: Fail to write %s.\n", path_.c_str());
+        unlink(temp_path_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void TensorCacheWriter::Abort() {
+    if (base_) {
+        munmap(base_, length_);
+        base_ = nullptr;
+        unlink(temp_path_.c_str());
+    }
+}
+
+}
@@ -0,0 +1,185 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_TENSOR_CACHE_H_
+#define DEEPHI_TENSOR_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace deephi {
+
+/*
+ * Everything an INT8 input Tensor depends on besides the image itself.
+ * An element of the Tensor is round((pixel - mean[c]) * scale), where scale
+ * already includes dpuGetInputTensorScale() of the input Node.
+ */
+struct TensorCacheKey {
+    int width;
+    int height;
+    int channel;
+    float mean[3];
+    float scale;
+};
+
+/*
+ * @brief QuantizeImage - convert a BGR image to an INT8 input Tensor
+ *
+ * @param image - BGR image of key.width x key.height
+ * @param key - mean and scale of the input Tensor
+ * @param tensor - output, key.width * key.height * key.channel elements
+ *                 in HWC order
+ */
+void QuantizeImage(const cv::Mat &image, const TensorCacheKey &key, int8_t *tensor);
+
+/*
+ * class TensorCache: read-only view of a preprocessed Tensor cache file
+ *
+ * The file holds one INT8 input Tensor per image plus an index of image
+ * names, and is memory-mapped so that a Tensor can be copied straight into
+ * dpuGetInputTensorAddress(). Files are written by TensorCacheWriter, see
+ * common/tools/tensor_cache_build.
+ */
+class TensorCache {
+public:
+    TensorCache();
+    ~TensorCache();
+
+    /*
+     * @brief Open - map a cache file
+     *
+     * @param path - path of the cache file
+     *
+     * @return true on success
+     */
+    bool Open(const std::string &path);
+    void Close();
+
+    /* check the cache was built for the given input Tensor */
+    bool Matches(const TensorCacheKey &key) const;
+
+    const TensorCacheKey &key() const { return key_; }
+    int size() const { return count_; }
+    size_t tensor_size() const { return tensor_size_; }
+    const char *name(int i) const;
+
+    /* Tensor of entry i, nullptr if the image failed to build */
+    const int8_t *tensor(int i) const;
+
+    /* Tensor of the named image, nullptr if it is not cached */
+    const int8_t *Find(const std::string &name) const;
+
+private:
+    TensorCache(const TensorCache &) = delete;
+    TensorCache &operator=(const TensorCache &) = delete;
+
+    uint8_t *base_;
+    size_t length_;
+    TensorCacheKey key_;
+    int count_;
+    size_t tensor_size_;
+    std::unordered_map<std::string, int> index_;
+};
+
+/*
+ * class TensorCacheWriter: build a Tensor cache file
+ *
+ * Create() lays out the whole file up front, so several threads may Store()
+ * different entries concurrently. The file only appears under its final
+ * name after Commit().
+ */
+class TensorCacheWriter {
+public:
+    TensorCacheWriter();
+    ~TensorCacheWriter();
+
+    /*
+     * @brief Create - start a cache file with one entry per image
+     *
+     * @param path - path of the cache file
+     * @param key - input Tensor the cache is built for
+     * @param names - image names, used as keys by TensorCache::Find()
+     *
+     * @return true on success
+     */
+    bool Create(const std::string &path, const TensorCacheKey &key,
+                const std::vector<std::string> &names);
+
+    /*
+     * @brief Store - quantize the image of entry i into the file
+     *
+     * @param i - entry index, as in names of Create()
+     * @param image - BGR image of key.width x key.height
+     *
+     * @return true on success
+     */
+    bool Store(int i, const cv::Mat &image);
+
+    /* flush the file and move it to its final name */
+    bool Commit();
+
+private:
+    TensorCacheWriter(const TensorCacheWriter &) = delete;
+    TensorCacheWriter &operator=(const TensorCacheWriter &) = delete;
+
+    void Abort();
+
+    std::string path_;
+    std::string temp_path_;
+    uint8_t *base_;
+    size_t length_;
+    TensorCacheKey key_;
+    int count_;
+};
+
+}
+
+#endif
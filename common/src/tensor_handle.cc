@@ -0,0 +1,169 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include "tensor_handle.h"
+
+namespace deephi {
+
+bool ResolveTensor(DPUTask *task, const char *node, int idx, bool input, TensorHandle *handle) {
+    /* in N2CUBE_EXCEPTION_MODE_RET_ERR_CODE an unknown Node gives an error
+       code, in the default mode N2Cube exits with its own message */
+    int count = input ? dpuGetInputTensorCnt(task, node) : dpuGetOutputTensorCnt(task, node);
+    if (count <= idx) {
+        return false;
+    }
+
+    DPUTensor *tensor = input ? dpuGetInputTensor(task, node, idx) : dpuGetOutputTensor(task, node, idx);
+    if (!tensor) {
+        return false;
+    }
+
+    handle->idx = idx;
+    handle->input = input;
+    handle->tensor = tensor;
+    handle->addr = dpuGetTensorAddress(tensor);
+    handle->size = dpuGetTensorSize(tensor);
+    handle->height = dpuGetTensorHeight(tensor);
+    handle->width = dpuGetTensorWidth(tensor);
+    handle->channel = dpuGetTensorChannel(tensor);
+    handle->scale = dpuGetTensorScale(tensor);
+    return true;
+}
+
+void TensorToFloat(const TensorHandle &handle, float *buffer) {
+    const int8_t *addr = handle.addr;
+    float scale = handle.scale;
+
+    for (int i = 0; i < handle.size; i++) {
+        buffer[i] = addr[i] * scale;
+    }
+}
+
+std::vector<KernelNode> ProbeKernelNodes(DPUTask *task, const std::vector<std::string> &names) {
+    std::vector<KernelNode> nodes;
+
+    /* probing names that are not input or output Nodes must not exit */
+    int mode = dpuGetExceptionMode();
+    dpuSetExceptionMode(N2CUBE_EXCEPTION_MODE_RET_ERR_CODE);
+
+    for (auto &name : names) {
+        KernelNode node;
+        node.name = name;
+        TensorHandle handle;
+
+        int inputs = dpuGetInputTensorCnt(task, name.c_str());
+        for (int i = 0; i < inputs; i++) {
+            if (ResolveTensor(task, name.c_str(), i, true, &handle)) {
+                node.inputs.push_back(handle);
+            }
+        }
+
+        int outputs = dpuGetOutputTensorCnt(task, name.c_str());
+        for (int i = 0; i < outputs; i++) {
+            if (ResolveTensor(task, name.c_str(), i, false, &handle)) {
+                node.outputs.push_back(handle);
+            }
+        }
+
+        if (!node.inputs.empty() || !node.outputs.empty()) {
+            nodes.push_back(node);
+        }
+    }
+
+    dpuSetExceptionMode(mode);
+
+    return nodes;
+}
+
+void PrintKernelNodes(FILE *fp, const std::vector<KernelNode> &nodes) {
+    for (auto &node : nodes) {
+        for (auto &handle : node.inputs) {
+            fprintf(fp, "[Node] %-24s input  %d  %4d x %4d x %4d  size %8d  scale %g\n",
+                    node.name.c_str(), handle.idx, handle.height, handle.width, handle.channel,
+                    handle.size, handle.scale);
+        }
+        for (auto &handle : node.outputs) {
+            fprintf(fp, "[Node] %-24s output %d  %4d x %4d x %4d  size %8d  scale %g\n",
+                    node.name.c_str(), handle.idx, handle.height, handle.width, handle.channel,
+                    handle.size, handle.scale);
+        }
+    }
+}
+
+int TaskTensors::AddInput(const std::string &node, int idx) {
+    specs_.push_back(Spec{node, idx, true});
+    return specs_.size() - 1;
+}
+
+int TaskTensors::AddOutput(const std::string &node, int idx) {
+    specs_.push_back(Spec{node, idx, false});
+    return specs_.size() - 1;
+}
+
+const TensorHandle *TaskTensors::Get(DPUTask *task) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    auto it = handles_.find(task);
+    if (it != handles_.end()) {
+        return it->second.data();
+    }
+
+    std::vector<TensorHandle> handles(specs_.size());
+    for (size_t i = 0; i < specs_.size(); i++) {
+        const Spec &spec = specs_[i];
+        if (!ResolveTensor(task, spec.node.c_str(), spec.idx, spec.input, &handles[i])) {
+            fprintf(stderr, "Error: no %s Tensor %d in Node %s\n",
+                    spec.input ? "input" : "output", spec.idx, spec.node.c_str());
+            return nullptr;
+        }
+    }
+
+    return handles_.emplace(task, std::move(handles)).first->second.data();
+}
+
+}
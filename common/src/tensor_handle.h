@@ -0,0 +1,166 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_TENSOR_HANDLE_H_
+#define DEEPHI_TENSOR_HANDLE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dnndk/dnndk.h>
+
+namespace deephi {
+
+/*
+ * Input or output Tensor of a DPU Task, resolved once from its Node name
+ *
+ * The DNNDK getters look the Node up by name on every call. The address,
+ * shape and scale of a Task's Tensor never change, so hot loops resolve
+ * them once and read the handle afterwards.
+ */
+struct TensorHandle {
+    int idx;
+    bool input;
+
+    DPUTensor *tensor;
+    int8_t *addr;
+    int size;
+    int height;
+    int width;
+    int channel;
+    float scale;
+};
+
+/*
+ * @brief ResolveTensor - resolve a Tensor of a Task into a handle
+ *
+ * @param task - DPU Task
+ * @param node - Node name
+ * @param idx - index of the Tensor in the Node
+ * @param input - input Tensor if true, output Tensor otherwise
+ * @param handle - the resolved Tensor
+ *
+ * @return true on success, false if the Node has no such Tensor
+ */
+bool ResolveTensor(DPUTask *task, const char *node, int idx, bool input, TensorHandle *handle);
+
+/* convert an output Tensor to float, as dpuGetOutputTensorInHWCFP32() */
+void TensorToFloat(const TensorHandle &handle, float *buffer);
+
+/*
+ * Input and output Tensors of one Kernel Node
+ */
+struct KernelNode {
+    std::string name;
+    std::vector<TensorHandle> inputs;
+    std::vector<TensorHandle> outputs;
+};
+
+/*
+ * @brief ProbeKernelNodes - find which of the given Nodes are input or
+ *        output Nodes of a Task's Kernel, with all their Tensors
+ *
+ * N2Cube has no call listing the Nodes of a Kernel, so the candidate names,
+ * as reported by DNNC for the model, are probed one by one. Nodes that are
+ * neither input nor output Nodes are left out.
+ *
+ * @param task - any Task of the Kernel
+ * @param names - candidate Node names
+ *
+ * @return the input/output Nodes found, in the order of names
+ */
+std::vector<KernelNode> ProbeKernelNodes(DPUTask *task, const std::vector<std::string> &names);
+
+/* print the Nodes found by ProbeKernelNodes() with their Tensor shapes */
+void PrintKernelNodes(FILE *fp, const std::vector<KernelNode> &nodes);
+
+/*
+ * class TaskTensors: the same set of Tensors resolved for every Task of a
+ * Kernel
+ *
+ * The Tensors are declared once at startup; Get() resolves them the first
+ * time a Task is seen and afterwards returns the cached handles, indexed
+ * by the slots returned from AddInput()/AddOutput(). Tasks from a TaskPool
+ * thus cost a pointer lookup per frame and no Node name comparisons.
+ */
+class TaskTensors {
+public:
+    TaskTensors() {}
+
+    TaskTensors(const TaskTensors &) = delete;
+    TaskTensors &operator=(const TaskTensors &) = delete;
+
+    /* declare a Tensor, return its slot; call before the first Get() */
+    int AddInput(const std::string &node, int idx = 0);
+    int AddOutput(const std::string &node, int idx = 0);
+
+    /*
+     * @brief Get - handles of the declared Tensors of a Task
+     *
+     * @return array indexed by slot, nullptr if a Tensor can't be resolved
+     */
+    const TensorHandle *Get(DPUTask *task);
+
+private:
+    struct Spec {
+        std::string node;
+        int idx;
+        bool input;
+    };
+
+    std::vector<Spec> specs_;
+    std::mutex mtx_;
+    std::unordered_map<DPUTask *, std::vector<TensorHandle>> handles_;
+};
+
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_WORKER_CONTEXT_H_
+#define DEEPHI_WORKER_CONTEXT_H_
+
+#include <vector>
+#include <dnndk/dnndk.h>
+
+#include "classify_result.h"
+
+namespace deephi {
+
+/*
+ * @brief PinThread - pin the calling thread to one CPU
+ *
+ * @param cpu - CPU index, wrapped around the number of online CPUs
+ *
+ * @return true on success
+ */
+bool PinThread(int cpu);
+
+/*
+ * class WorkerContext: state owned by one worker thread for its lifetime
+ *
+ * The DPU Tasks and result structure are created once and reused for
+ * every image the worker processes, so that the per-image path does not
+ * allocate.
+ */
+class WorkerContext {
+public:
+    /*
+     * @param id - index of the worker
+     * @param kernels - DPU Kernels to create one Task each for
+     * @param cpu - CPU to pin the worker thread to, -1 for no pinning
+     */
+    WorkerContext(int id, const std::vector<DPUKernel *> &kernels, int cpu = -1);
+    ~WorkerContext();
+
+    WorkerContext(const WorkerContext &) = delete;
+    WorkerContext &operator=(const WorkerContext &) = delete;
+
+    /*
+     * @brief Attach - bind the calling thread to the context, pinning it on
+     *        the first call if a CPU was given. Cheap to call per image.
+     */
+    void Attach();
+
+    int id() const { return id_; }
+
+    /* Task created from kernels[i] */
+    DPUTask *task(int i = 0) const { return tasks_[i]; }
+
+    /* classification result of the last image */
+    ClassifyResult &result() { return result_; }
+
+private:
+    int id_;
+    int cpu_;
+    bool attached_;
+    std::vector<DPUTask *> tasks_;
+    ClassifyResult result_;
+};
+
+}
+
+#endif
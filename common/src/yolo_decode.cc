@@ -0,0 +1,111 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <cmath>
+
+#include "yolo_decode.h"
+
+namespace deephi {
+
+YoloDecoder::YoloDecoder(float scale, int classes, int anchors, const float *biases,
+                         float threshold)
+    : classes_(classes), anchors_(anchors), biases_(biases, biases + 2 * anchors),
+      min_objectness_(128) {
+    /*
+     * Same float and double operations as get_output() and sigmoid(). The
+     * volatile keeps the loop scalar: -ffast-math may otherwise vectorize
+     * exp() into a SIMD exp rounding differently from detect()'s calls.
+     */
+    for (int q = -128; q < 128; q++) {
+        volatile float v = q * scale;
+        sigmoid_[q + 128] = 1.0 / (1 + std::exp(-v * 1.0));
+        exp_[q + 128] = std::exp(v);
+    }
+    for (int q = -128; q < 128; q++) {
+        if (!(sigmoid_[q + 128] < threshold)) {
+            min_objectness_ = q;
+            break;
+        }
+    }
+}
+
+int YoloDecoder::Decode(const int8_t *output, int height, int width, int sWidth, int sHeight,
+                        Detections &boxes) const {
+    const int conf_box = 5 + classes_;
+    const int channel = anchors_ * conf_box;
+    const float *sigmoid = sigmoid_ + 128;
+    const float *expo = exp_ + 128;
+    int found = 0;
+
+    for (int h = 0; h < height; ++h) {
+        for (int w = 0; w < width; ++w) {
+            const int8_t *cell = output + (h * width + w) * channel;
+            for (int c = 0; c < anchors_; ++c) {
+                const int8_t *p = cell + c * conf_box;
+                if (p[4] < min_objectness_) {
+                    continue;
+                }
+
+                float obj_score = sigmoid[p[4]];
+                size_t i = boxes.Add((w + sigmoid[p[0]]) / width,
+                                     (h + sigmoid[p[1]]) / height,
+                                     expo[p[2]] * biases_[2 * c] / float(sWidth),
+                                     expo[p[3]] * biases_[2 * c + 1] / float(sHeight),
+                                     obj_score);
+                for (int k = 0; k < classes_; k++) {
+                    boxes.class_score(k)[i] = obj_score * sigmoid[p[5 + k]];
+                }
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+}
@@ -0,0 +1,118 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_YOLO_DECODE_H_
+#define DEEPHI_YOLO_DECODE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "detections.h"
+
+namespace deephi {
+
+/*
+ * class YoloDecoder: decoding of one YOLO output head on its INT8 values
+ *
+ * Darknet dequantizes and transposes a whole head before testing the
+ * objectness of each anchor. The objectness test is monotonic in the INT8
+ * value, so it is done on the raw HWC output against the smallest value
+ * whose sigmoid passes the threshold, i.e. the inverse sigmoid of the
+ * threshold in quantized units. Only the anchors that pass are decoded,
+ * with sigmoid and exp looked up in 256-entry tables computed from the
+ * head's scale. The boxes are those of the Darknet get_output() and
+ * detect() in common/tools/yolo_decode_bench, bit for bit and in the same
+ * order: coordinates x, y, w, h relative to the input, score the
+ * objectness, label -1 and the class scores.
+ *
+ * Immutable after construction, so one decoder per head is shared by all
+ * threads.
+ */
+class YoloDecoder {
+public:
+    /*
+     * @param scale - scale of the INT8 output, real value = value * scale
+     * @param classes - number of classes
+     * @param anchors - number of anchors per cell
+     * @param biases - anchors (width, height) pairs in pixels of the input
+     * @param threshold - objectness threshold
+     */
+    YoloDecoder(float scale, int classes, int anchors, const float *biases, float threshold);
+
+    /*
+     * @brief Decode - append the boxes of the anchors passing the threshold
+     *
+     * @param output - HWC INT8 output of the head, anchors * (5 + classes)
+     *                 channels
+     * @param height - height of the output
+     * @param width - width of the output
+     * @param sWidth - width of the input
+     * @param sHeight - height of the input
+     * @param boxes - boxes found, set to the number of classes of the decoder
+     *
+     * @return number of boxes appended
+     */
+    int Decode(const int8_t *output, int height, int width, int sWidth, int sHeight,
+               Detections &boxes) const;
+
+    /* smallest INT8 objectness passing the threshold, 128 if none */
+    int min_objectness() const { return min_objectness_; }
+
+private:
+    int classes_;
+    int anchors_;
+    std::vector<float> biases_;
+    int min_objectness_;
+    /* sigmoid and exp of value * scale, indexed by value + 128 */
+    float sigmoid_[256];
+    float exp_[256];
+};
+
+}
+
+#endif
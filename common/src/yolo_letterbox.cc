@@ -0,0 +1,261 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LETTERBOX_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LETTERBOX_SSE2
+#endif
+
+#include "yolo_letterbox.h"
+
+namespace deephi {
+
+/* fixed-point position 7 of the YOLO input */
+static const float kScale = 128.0f;
+
+/* value of a pixel byte in the Darknet image, byte/256. */
+static const float *PixelTable() {
+    static struct Table {
+        float value[256];
+        Table() {
+            for (int i = 0; i < 256; i++) {
+                value[i] = i / 256.;
+            }
+        }
+    } table;
+    return table.value;
+}
+
+/* quantization of setInputImageForYOLO(), including its INT8 wrap */
+static inline int8_t Quantize(float v) {
+    int8_t q = int(v * kScale);
+    if (q < 0) q = 127;
+    return q;
+}
+
+/*
+ * Blend two interpolated rows as the vertical pass of resize_image() does,
+ * (1 - dy) * row0 rounded, then dy * row1 rounded and added, and quantize.
+ * Blended values lie within [0, 255 / 256], so the saturating narrowing of
+ * the SIMD paths never differs from the wrap of Quantize().
+ */
+static void BlendRow(const float *r0, const float *r1, float w0, float w1,
+                     int n, int8_t *out) {
+    int i = 0;
+#if defined(LETTERBOX_NEON)
+    const float32x4_t a = vdupq_n_f32(w0);
+    const float32x4_t b = vdupq_n_f32(w1);
+    const float32x4_t s = vdupq_n_f32(kScale);
+    for (; i + 16 <= n; i += 16) {
+        int32x4_t q[4];
+        for (int j = 0; j < 4; j++) {
+            float32x4_t v = vaddq_f32(vmulq_f32(a, vld1q_f32(r0 + i + 4 * j)),
+                                      vmulq_f32(b, vld1q_f32(r1 + i + 4 * j)));
+            q[j] = vcvtq_s32_f32(vmulq_f32(v, s));
+        }
+        int16x8_t lo = vcombine_s16(vqmovn_s32(q[0]), vqmovn_s32(q[1]));
+        int16x8_t hi = vcombine_s16(vqmovn_s32(q[2]), vqmovn_s32(q[3]));
+        vst1q_s8(out + i, vcombine_s8(vqmovn_s16(lo), vqmovn_s16(hi)));
+    }
+#elif defined(LETTERBOX_SSE2)
+    const __m128 a = _mm_set1_ps(w0);
+    const __m128 b = _mm_set1_ps(w1);
+    const __m128 s = _mm_set1_ps(kScale);
+    for (; i + 16 <= n; i += 16) {
+        __m128i q[4];
+        for (int j = 0; j < 4; j++) {
+            __m128 v = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(r0 + i + 4 * j)),
+                                  _mm_mul_ps(b, _mm_loadu_ps(r1 + i + 4 * j)));
+            q[j] = _mm_cvttps_epi32(_mm_mul_ps(v, s));
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = Quantize(w0 * r0[i] + w1 * r1[i]);
+    }
+}
+
+YoloLetterbox::YoloLetterbox()
+    : src_w_(0), src_h_(0), width_(0), height_(0), new_w_(0), new_h_(0) {
+    row_cached_[0] = row_cached_[1] = -1;
+}
+
+void YoloLetterbox::Prepare(int src_w, int src_h, int width, int height) {
+    src_w_ = src_w;
+    src_h_ = src_h;
+    width_ = width;
+    height_ = height;
+
+    /* size of the resized frame, as letterbox_image() */
+    new_w_ = src_w;
+    new_h_ = src_h;
+    if (((float)width / src_w) < ((float)height / src_h)) {
+        new_w_ = width;
+        new_h_ = (src_h * width) / src_w;
+    } else {
+        new_h_ = height;
+        new_w_ = (src_w * height) / src_h;
+    }
+
+    /*
+     * Bilinear weights, as resize_image(). The last column copies the last
+     * pixel and the last row skips the second row: both are expressed as a
+     * zero weight on a repeated pixel, which leaves the sum unchanged.
+     */
+    float w_scale = (float)(src_w - 1) / (new_w_ - 1);
+    float h_scale = (float)(src_h - 1) / (new_h_ - 1);
+
+    col_offset_.resize(new_w_);
+    col_next_.resize(new_w_);
+    col_w0_.resize(new_w_);
+    col_w1_.resize(new_w_);
+    for (int c = 0; c < new_w_; c++) {
+        if (c == new_w_ - 1 || src_w == 1) {
+            col_offset_[c] = col_next_[c] = (src_w - 1) * 3;
+            col_w0_[c] = 1;
+            col_w1_[c] = 0;
+        } else {
+            float sx = c * w_scale;
+            int ix = (int)sx;
+            float dx = sx - ix;
+            col_offset_[c] = ix * 3;
+            col_next_[c] = (ix + 1) * 3;
+            col_w0_[c] = 1 - dx;
+            col_w1_[c] = dx;
+        }
+    }
+
+    row_index_.resize(new_h_);
+    row_next_.resize(new_h_);
+    row_w0_.resize(new_h_);
+    row_w1_.resize(new_h_);
+    for (int r = 0; r < new_h_; r++) {
+        float sy = r * h_scale;
+        int iy = (int)sy;
+        float dy = sy - iy;
+        row_index_[r] = iy;
+        row_w0_[r] = 1 - dy;
+        if (r == new_h_ - 1 || src_h == 1) {
+            row_next_[r] = iy;
+            row_w1_[r] = 0;
+        } else {
+            row_next_[r] = iy + 1;
+            row_w1_[r] = dy;
+        }
+    }
+
+    rows_[0].resize(new_w_ * 3);
+    rows_[1].resize(new_w_ * 3);
+}
+
+/*
+ * Horizontally interpolated source row r in RGB order, computed into the
+ * scratch row that does not hold row keep unless already there.
+ */
+const float *YoloLetterbox::Row(const cv::Mat &frame, int r, int keep) {
+    for (int i = 0; i < 2; i++) {
+        if (row_cached_[i] == r) {
+            return rows_[i].data();
+        }
+    }
+
+    int slot = (row_cached_[0] == keep) ? 1 : 0;
+    float *out = rows_[slot].data();
+    const uint8_t *src = frame.ptr<uint8_t>(r);
+    const float *pixel = PixelTable();
+    for (int c = 0; c < new_w_; c++) {
+        const uint8_t *p0 = src + col_offset_[c];
+        const uint8_t *p1 = src + col_next_[c];
+        float w0 = col_w0_[c];
+        float w1 = col_w1_[c];
+        out[0] = w0 * pixel[p0[2]] + w1 * pixel[p1[2]];
+        out[1] = w0 * pixel[p0[1]] + w1 * pixel[p1[1]];
+        out[2] = w0 * pixel[p0[0]] + w1 * pixel[p1[0]];
+        out += 3;
+    }
+    row_cached_[slot] = r;
+
+    return rows_[slot].data();
+}
+
+void YoloLetterbox::Run(const cv::Mat &frame, int width, int height, int8_t *output) {
+    if (frame.cols != src_w_ || frame.rows != src_h_ || width != width_ || height != height_) {
+        Prepare(frame.cols, frame.rows, width, height);
+    }
+    row_cached_[0] = row_cached_[1] = -1;
+
+    /* border filled with 0.5, as fill_image() */
+    const int8_t pad = Quantize(0.5f);
+    const int left = (width - new_w_) / 2;
+    const int top = (height - new_h_) / 2;
+    const int right = width - left - new_w_;
+    const int bottom = height - top - new_h_;
+    const int stride = width * 3;
+
+    memset(output, pad, top * stride);
+    for (int r = 0; r < new_h_; r++) {
+        int8_t *line = output + (top + r) * stride;
+        const float *r0 = Row(frame, row_index_[r], row_next_[r]);
+        const float *r1 = Row(frame, row_next_[r], row_index_[r]);
+
+        memset(line, pad, left * 3);
+        BlendRow(r0, r1, row_w0_[r], row_w1_[r], new_w_ * 3, line + left * 3);
+        memset(line + (left + new_w_) * 3, pad, right * 3);
+    }
+    memset(output + (top + new_h_) * stride, pad, bottom * stride);
+}
+
+}
@@ -0,0 +1,115 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#ifndef DEEPHI_YOLO_LETTERBOX_H_
+#define DEEPHI_YOLO_LETTERBOX_H_
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace deephi {
+
+/*
+ * class YoloLetterbox: Darknet letterbox of a BGR frame into a YOLO input
+ *
+ * Produces the same INT8 tensor as the Darknet path of letterbox_bench
+ * (load_image_cv, letterbox_image, HWC transpose and quantization to
+ * fixed-point position 7) in one pass over the frame: the bilinear
+ * weights of every column and row are computed once per frame size, the
+ * two source rows an output row blends are interpolated into floats and
+ * the vertical blend is quantized straight into the DPU input. Every
+ * float operation and its rounding is kept, so the output is identical as
+ * long as the compiler does not fuse multiply-adds (-ffp-contract=off).
+ *
+ * The scratch rows are owned by the object: use one per thread.
+ */
+class YoloLetterbox {
+public:
+    YoloLetterbox();
+
+    /*
+     * @brief Run - letterbox a frame into a YOLO input Tensor
+     *
+     * @param frame - CV_8UC3 BGR frame
+     * @param width - width of the input Tensor
+     * @param height - height of the input Tensor
+     * @param output - width * height * 3 INT8 values, HWC in RGB order
+     *
+     * @return none
+     */
+    void Run(const cv::Mat &frame, int width, int height, int8_t *output);
+
+private:
+    void Prepare(int src_w, int src_h, int width, int height);
+    const float *Row(const cv::Mat &frame, int r, int keep);
+
+    int src_w_;
+    int src_h_;
+    int width_;
+    int height_;
+    int new_w_;
+    int new_h_;
+    /* byte offsets of the two source pixels and weights of every column */
+    std::vector<int> col_offset_;
+    std::vector<int> col_next_;
+    std::vector<float> col_w0_;
+    std::vector<float> col_w1_;
+    /* the two source rows and weights of every row */
+    std::vector<int> row_index_;
+    std::vector<int> row_next_;
+    std::vector<float> row_w0_;
+    std::vector<float> row_w1_;
+    /* horizontally interpolated source rows and their indexes */
+    std::vector<float> rows_[2];
+    int row_cached_[2];
+};
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "avg_pool.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/*
+ * Output shapes of the CONV kernels feeding the FC kernels, with the
+ * fix-point scales of their tensors
+ */
+struct Shape {
+    const char *name;
+    int height;
+    int width;
+    int channel;
+    float outScale;   // scale of the CONV output Tensor
+    float fcScale;    // scale of the FC input Tensor
+};
+
+static const Shape shapes[] = {
+    {"resnet50 res5c", 7, 7, 2048, 0.25f, 4.0f},
+    {"inception_v1 inception_5b", 7, 7, 1024, 0.5f, 8.0f},
+};
+
+/**
+ * @brief Reference average pooling as done by the samples before: convert
+ *        the whole tensor to FP32 in a heap buffer, then sum each channel
+ *        with a stride of channel. The result is saturated like
+ *        AvgPoolInt8() does instead of relying on an out-of-range cast.
+ */
+void refAvgPool(const int8_t *input, int length, int channel, float outScale,
+                float fcScale, int8_t *output) {
+    int tensorSize = length * channel;
+    float *outBuffer = new float[tensorSize];
+    for (int i = 0; i < tensorSize; i++) {
+        outBuffer[i] = input[i] * outScale;
+    }
+
+    float avg = static_cast<float>(length);
+    for (int i = 0; i < channel; i++) {
+        float sum = 0.0f;
+        for (int j = 0; j < length; j++) {
+            sum += outBuffer[channel * j + i];
+        }
+        float v = sum / avg * fcScale;
+        output[i] = static_cast<int8_t>(v < -128.0f ? -128.0f : (v > 127.0f ? 127.0f : v));
+    }
+
+    delete[] outBuffer;
+}
+
+/**
+ * @brief Time fn() over iterations calls and return microseconds per call
+ */
+template <typename F>
+double timeIt(int iterations, F fn) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = steady_clock::now();
+    return duration_cast<nanoseconds>(end - start).count() / 1000.0 / iterations;
+}
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 10000;
+    mt19937 rng(2019);
+    uniform_int_distribution<int> dist(-128, 127);
+
+    printf("%-36s %12s %12s %8s %10s\n", "shape", "ref(us)", "simd(us)", "speedup", "mismatch");
+    for (auto &s : shapes) {
+        int length = s.height * s.width;
+        vector<int8_t> input(length * s.channel);
+        for (auto &v : input) {
+            v = dist(rng);
+        }
+
+        vector<int8_t> ref(s.channel), out(s.channel);
+        float factor = s.outScale * s.fcScale / length;
+
+        double refUs = timeIt(iterations, [&]() {
+            refAvgPool(input.data(), length, s.channel, s.outScale, s.fcScale, ref.data());
+        });
+        double simdUs = timeIt(iterations, [&]() {
+            AvgPoolInt8(input.data(), length, s.channel, factor, out.data());
+        });
+
+        /* both truncate toward zero; only FP32 rounding of the reference may differ */
+        int mismatch = 0;
+        for (int c = 0; c < s.channel; c++) {
+            if (abs(ref[c] - out[c]) > 1) {
+                mismatch++;
+            }
+        }
+
+        char shape[64];
+        snprintf(shape, sizeof(shape), "%s %dx%dx%d", s.name, s.height, s.width, s.channel);
+        printf("%-36s %12.2f %12.2f %7.1fx %10d\n", shape, refUs, simdUs, refUs / simdUs, mismatch);
+    }
+
+    return 0;
+}
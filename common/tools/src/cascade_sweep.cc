@@ -0,0 +1,136 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "classify_cascade.h"
+
+using namespace std;
+using namespace deephi;
+
+/* value in [0, 1] as a percentage */
+string Percent(double value, bool sign = false) {
+    char text[32];
+    snprintf(text, sizeof(text), sign ? "%+.2f%%" : "%.2f%%", value * 100);
+    return text;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-t thresholds] [-f fast_fps] [-a accurate_fps] fast_record accurate_record\n",
+           name);
+    printf("\tEvaluate a confidence-gated cascade on the logits two classification samples\n");
+    printf("\trecorded with -b list -r record over the same labelled images\n");
+    printf("\t-t thresholds: comma-separated top-1 margins (default: 0.05,0.1,...,0.5)\n");
+    printf("\t-f fast_fps: FPS of the fast model alone, as reported by its benchmark\n");
+    printf("\t-a accurate_fps: FPS of the accurate model alone\n");
+}
+
+int main(int argc, char **argv) {
+    vector<float> thresholds;
+    double fastFps = 0, accurateFps = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:f:a:")) != -1) {
+        switch (opt) {
+        case 't': {
+            stringstream list(optarg);
+            string item;
+            while (getline(list, item, ',')) {
+                thresholds.push_back(atof(item.c_str()));
+            }
+            break;
+        }
+        case 'f': fastFps = atof(optarg); break;
+        case 'a': accurateFps = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (argc - optind != 2) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (thresholds.empty()) {
+        for (int i = 1; i <= 10; i++) {
+            thresholds.push_back(i * 0.05f);
+        }
+    }
+
+    vector<CascadePoint> points;
+    if (!EvaluateCascade(argv[optind], argv[optind + 1], thresholds, fastFps, accurateFps,
+                         points)) {
+        return -1;
+    }
+
+    /* the last point is the accurate model alone */
+    const CascadePoint &alone = points.back();
+    printf("%-10s %-10s %-8s %-8s %-10s %-10s %s\n", "threshold", "escalated", "top1", "top5",
+           "top1 delta", "fps", "speedup");
+    for (size_t i = 0; i < points.size(); i++) {
+        const CascadePoint &p = points[i];
+        if (i + 1 == points.size()) {
+            printf("%-10s ", "accurate");
+        } else {
+            printf("%-10.3f ", p.threshold);
+        }
+        printf("%-10s %-8s %-8s %-10s ", Percent(p.escalation).c_str(), Percent(p.top1).c_str(),
+               Percent(p.top5).c_str(), Percent(p.top1 - alone.top1, true).c_str());
+        if (p.fps > 0) {
+            printf("%-10.1f %.2fx\n", p.fps, p.fps / alone.fps);
+        } else {
+            printf("%-10s -\n", "-");
+        }
+    }
+    return 0;
+}
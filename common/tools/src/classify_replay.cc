@@ -0,0 +1,162 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "classify_bench.h"
+
+using namespace std;
+using namespace deephi;
+
+void usage(const char *name) {
+    printf("Usage: %s [-j threads] [-n count] [-w warmup] [-s seconds] [-m model] [-o report]"
+           " record_file [image_dir width height]\n", name);
+    printf("\tReplay the logits recorded by a classification sample with -r in place of\n");
+    printf("\tthe DPU, to benchmark top-5 and accuracy, and decoding if image_dir is given\n");
+    printf("\t-j threads: number of workers (default: 1)\n");
+    printf("\t-n count: images to measure (default: each recorded image once)\n");
+    printf("\t-w warmup: images run before measuring (default: 10)\n");
+    printf("\t-s seconds: measure for a fixed duration instead of a count\n");
+    printf("\t-m model: model name in the report (default: replay)\n");
+    printf("\t-o report: write the results to a .json file or append them to a .csv file\n");
+}
+
+int main(int argc, char **argv) {
+    BenchConfig config;
+    config.model = "replay";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:n:w:s:m:o:")) != -1) {
+        switch (opt) {
+        case 'j':
+            config.threads = atoi(optarg);
+            break;
+        case 'n':
+            config.count = atoi(optarg);
+            break;
+        case 'w':
+            config.warmup = atoi(optarg);
+            break;
+        case 's':
+            config.duration = atof(optarg);
+            break;
+        case 'm':
+            config.model = optarg;
+            break;
+        case 'o':
+            config.output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    int args = argc - optind;
+    if (args != 1 && args != 4) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    vector<BenchImage> images;
+    vector<float> scales;
+    vector<int8_t> logits;
+    if (!LoadLogitRecord(argv[optind], images, config.channel, scales, logits)) {
+        return -1;
+    }
+    if (images.empty()) {
+        fprintf(stderr, "Error: No image in %s.\n", argv[optind]);
+        return -1;
+    }
+
+    if (args == 4) {
+        config.dir = argv[optind + 1];
+        if (config.dir.back() != '/') {
+            config.dir += '/';
+        }
+        config.input_size = cv::Size(atoi(argv[optind + 2]), atoi(argv[optind + 3]));
+    }
+
+    unordered_map<string, int> names;
+    for (size_t i = 0; i < images.size(); i++) {
+        names[images[i].name] = i;
+    }
+
+    /* the recorded logits stand in for the DPU output; the workers only
+       look the index up, through a const reference */
+    const unordered_map<string, int> &index = names;
+    int channel = config.channel;
+    atomic<int> missing(0);
+    ClassifyBench bench(config);
+    bench.Run(images, [&](int id, ClassifyJob &job) {
+        auto it = index.find(job.name);
+        if (it == index.end()) {
+            fprintf(stderr, "Error: %s is not in the logit record.\n", job.name.c_str());
+            job.logits.assign(channel, 0);
+            job.scale = 1.0f;
+            missing++;
+            return;
+        }
+        const int8_t *out = &logits[(size_t)it->second * channel];
+        job.logits.assign(out, out + channel);
+        job.scale = scales[it->second];
+    });
+    bench.Report();
+
+    if (missing > 0) {
+        fprintf(stderr, "Error: %d images replayed without recorded logits.\n", missing.load());
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "conv_fc_executor.h"
+#include "dpu_async.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/**
+ * @brief Spin for us microseconds, standing for the CPU average pooling
+ */
+void CpuWork(int us) {
+    auto end = steady_clock::now() + microseconds(us);
+    while (steady_clock::now() < end) {
+    }
+}
+
+/**
+ * @brief Fake DPU cores shared by the CONV and the FC Kernel, which take
+ *        different times
+ */
+class FakeCores {
+public:
+    explicit FakeCores(int cores) : free_(cores) {}
+
+    int Run(int us) {
+        {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return free_ > 0; });
+            free_--;
+        }
+        this_thread::sleep_for(microseconds(us));
+        {
+            lock_guard<mutex> lock(mtx_);
+            free_++;
+        }
+        cv_.notify_one();
+        return 0;
+    }
+
+private:
+    mutex mtx_;
+    condition_variable cv_;
+    int free_;
+};
+
+/* Tasks are never dereferenced by the fake DPU */
+vector<DPUTask *> FakeTasks(int n, int first) {
+    vector<DPUTask *> tasks;
+    for (int i = 0; i < n; i++) {
+        tasks.push_back((DPUTask *)(intptr_t)(first + i));
+    }
+    return tasks;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-c cores] [-t threads] [-l conv_us] [-p pool_us] [-f fc_us] [-b batch] [-n images]\n",
+           name);
+    printf("\tCompare CONV, pooling and FC run in sequence by each worker against\n");
+    printf("\tConvFcExecutor on a fake DPU\n");
+    printf("\t-c cores: fake DPU cores (default: 3)\n");
+    printf("\t-t threads: images in flight, i.e. workers or callers (default: 3)\n");
+    printf("\t-l conv_us: run time of the CONV Kernel (default: 12000)\n");
+    printf("\t-p pool_us: CPU time of the average pooling (default: 1500)\n");
+    printf("\t-f fc_us: run time of the FC Kernel, launch included (default: 500)\n");
+    printf("\t-b batch: largest FC batch of the batched mode (default: 4)\n");
+    printf("\t-n images: images per mode (default: 600)\n");
+}
+
+int main(int argc, char **argv) {
+    int cores = 3, threads = 3, conv = 12000, pool = 1500, fc = 500, batch = 4, images = 600;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:t:l:p:f:b:n:")) != -1) {
+        switch (opt) {
+        case 'c': cores = atoi(optarg); break;
+        case 't': threads = atoi(optarg); break;
+        case 'l': conv = atoi(optarg); break;
+        case 'p': pool = atoi(optarg); break;
+        case 'f': fc = atoi(optarg); break;
+        case 'b': batch = atoi(optarg); break;
+        case 'n': images = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (cores <= 0 || threads <= 0 || batch <= 0 || images <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    printf("cores %d  threads %d  conv %dus  pool %dus  fc %dus  images %d\n", cores, threads,
+           conv, pool, fc, images);
+
+    /* the run function tells CONV Tasks from FC Tasks by their fake address */
+    FakeCores dpu(cores);
+    DpuRunFunc run = [&](DPUTask *task) {
+        return dpu.Run((intptr_t)task < 1000 ? conv : fc);
+    };
+
+    /* 1. every worker runs CONV, pooling and FC of its image in sequence */
+    {
+        auto start = steady_clock::now();
+        vector<thread> workers;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([&, i]() {
+                DPUTask *convTask = FakeTasks(1, 1 + i)[0];
+                DPUTask *fcTask = FakeTasks(1, 1000 + i)[0];
+                for (int n = i; n < images; n += threads) {
+                    run(convTask);
+                    CpuWork(pool);
+                    run(fcTask);
+                }
+            });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        double seconds = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+        printf("%-12s FPS %8.2f\n", "sequential", images / seconds);
+    }
+
+    /* 2. and 3. CONV of one image overlaps pooling and FC of another */
+    int convThreads = min(threads, cores);
+    for (int fcBatch : {1, batch}) {
+        ConvFcExecutor executor(FakeTasks(convThreads + 1, 1), FakeTasks(fcBatch, 1000),
+                                [&](DPUTask *, DPUTask *) { CpuWork(pool); }, run);
+        auto start = steady_clock::now();
+        vector<thread> callers;
+        for (int i = 0; i < threads; i++) {
+            callers.emplace_back([&, i]() {
+                for (int n = i; n < images; n += threads) {
+                    executor.Run([](DPUTask *) {}, [](DPUTask *) {});
+                }
+            });
+        }
+        for (auto &c : callers) {
+            c.join();
+        }
+        double seconds = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+        printf("%-12s FPS %8.2f  ", fcBatch == 1 ? "overlapped" : "fc batched", images / seconds);
+        executor.Report();
+        if (fcBatch == batch) {
+            break;
+        }
+    }
+
+    return 0;
+}
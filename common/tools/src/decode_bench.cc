@@ -0,0 +1,176 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "frame_source.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace cv;
+using namespace deephi;
+
+/**
+ * @brief FNV-1a hash of the pixels of a frame, to compare the two readers
+ */
+uint64_t HashFrame(const Mat &frame) {
+    uint64_t h = 1469598103934665603ULL;
+    for (int r = 0; r < frame.rows; r++) {
+        const uint8_t *p = frame.ptr<uint8_t>(r);
+        for (int i = 0; i < frame.cols * frame.channels(); i++) {
+            h = (h ^ p[i]) * 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Frames per second of one pass
+ */
+double Rate(steady_clock::time_point start, size_t frames) {
+    double seconds = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000000.0;
+    return seconds > 0 ? frames / seconds : 0.0;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-t threads] [-p prefetch] [-d threads] [-s WxH] video\n", name);
+    printf("\tDecode rate of a video with cv::VideoCapture::read() in one thread,\n");
+    printf("\tas the samples did, against FrameSource\n");
+    printf("\t-t threads: resize threads of FrameSource (default: 2)\n");
+    printf("\t-p prefetch: frames decoded ahead (default: 16)\n");
+    printf("\t-d threads: threads of the codec, OpenCV 4.7 on (default: one per core)\n");
+    printf("\t-s WxH: size of the frames read, e.g. 480x360 (default: size of the video)\n");
+    printf("\te.g. %s -s 256x128 ../../adas_detection/video/adas.avi\n", name);
+}
+
+int main(int argc, char **argv) {
+    int threads = 2, prefetch = 16, decodeThreads = 0;
+    Size size;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:p:d:s:")) != -1) {
+        switch (opt) {
+        case 't': threads = atoi(optarg); break;
+        case 'p': prefetch = atoi(optarg); break;
+        case 'd': decodeThreads = atoi(optarg); break;
+        case 's':
+            if (sscanf(optarg, "%dx%d", &size.width, &size.height) != 2) {
+                usage(argv[0]);
+                return -1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return -1;
+    }
+    string file = argv[optind];
+
+    /* 1. one thread reading and resizing every frame */
+    vector<uint64_t> hashes;
+    {
+        VideoCapture video;
+        if (!video.open(file)) {
+            fprintf(stderr, "Error: fail to open video %s\n", file.c_str());
+            return -1;
+        }
+        Size videoSize(video.get(CAP_PROP_FRAME_WIDTH), video.get(CAP_PROP_FRAME_HEIGHT));
+        printf("%s: %dx%d  %.1f FPS  threads %d  prefetch %d  output %dx%d\n", file.c_str(),
+               videoSize.width, videoSize.height, video.get(CAP_PROP_FPS), threads, prefetch,
+               size.area() ? size.width : videoSize.width,
+               size.area() ? size.height : videoSize.height);
+
+        auto start = steady_clock::now();
+        Mat frame, scaled;
+        while (video.read(frame)) {
+            if (size.area() > 0 && size != frame.size()) {
+                resize(frame, scaled, size);
+                hashes.push_back(HashFrame(scaled));
+            } else {
+                hashes.push_back(HashFrame(frame));
+            }
+        }
+        printf("read         frames %-6zu  %8.1f FPS\n", hashes.size(), Rate(start, hashes.size()));
+    }
+
+    /* 2. FrameSource, frames taken in order by the reader */
+    {
+        FrameSource source(threads, prefetch, decodeThreads);
+        auto start = steady_clock::now();
+        if (!source.Open(file, size)) {
+            return -1;
+        }
+
+        size_t frames = 0, mismatch = 0;
+        int index;
+        Mat frame;
+        while (source.Read(index, frame)) {
+            if (index != (int)frames || frames >= hashes.size() ||
+                HashFrame(frame) != hashes[frames]) {
+                mismatch++;
+            }
+            frames++;
+        }
+        printf("FrameSource  frames %-6zu  %8.1f FPS  %s\n", frames, Rate(start, frames),
+               (mismatch || frames != hashes.size()) ? "DIFFERENT" : "identical");
+        source.Report();
+    }
+
+    return 0;
+}
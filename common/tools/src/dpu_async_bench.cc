@@ -0,0 +1,189 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "dpu_async.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/**
+ * @brief Spin for us microseconds, standing for the CPU work of one run
+ */
+void CpuWork(int us) {
+    auto end = steady_clock::now() + microseconds(us);
+    while (steady_clock::now() < end) {
+    }
+}
+
+/**
+ * @brief Time, CPU time and context switches of one mode
+ */
+struct Usage {
+    steady_clock::time_point wall;
+    struct rusage ru;
+
+    void Start() {
+        wall = steady_clock::now();
+        getrusage(RUSAGE_SELF, &ru);
+    }
+
+    void Report(const char *mode, int threads, int runs) const {
+        struct rusage end;
+        getrusage(RUSAGE_SELF, &end);
+        double seconds = duration_cast<microseconds>(steady_clock::now() - wall).count() / 1000000.0;
+        auto us = [](const struct timeval &tv) { return tv.tv_sec * 1000000.0 + tv.tv_usec; };
+        double cpu = (us(end.ru_utime) - us(ru.ru_utime) + us(end.ru_stime) - us(ru.ru_stime)) / 1000.0;
+
+        printf("%-8s threads %-3d runs/s %9.1f  cpu %8.1fms  voluntary cs %-8ld involuntary cs %ld\n",
+               mode, threads, runs / seconds, cpu, end.ru_nvcsw - ru.ru_nvcsw,
+               end.ru_nivcsw - ru.ru_nivcsw);
+    }
+};
+
+void usage(const char *name) {
+    printf("Usage: %s [-c cores] [-t tasks] [-l latency_us] [-j jitter_us] [-w work_us] [-n runs]\n", name);
+    printf("\tCompare one thread per DPU Task against DpuAsync on a fake DPU\n");
+    printf("\t-c cores: fake DPU cores (default: 2)\n");
+    printf("\t-t tasks: DPU Tasks in flight (default: 4)\n");
+    printf("\t-l latency_us: run time of one Task (default: 5000)\n");
+    printf("\t-j jitter_us: random extra run time (default: 0)\n");
+    printf("\t-w work_us: CPU work before each run, e.g. setting the input (default: 200)\n");
+    printf("\t-n runs: total runs (default: 2000)\n");
+}
+
+int main(int argc, char **argv) {
+    int cores = 2, tasks = 4, latency = 5000, jitter = 0, work = 200, runs = 2000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:t:l:j:w:n:")) != -1) {
+        switch (opt) {
+        case 'c': cores = atoi(optarg); break;
+        case 't': tasks = atoi(optarg); break;
+        case 'l': latency = atoi(optarg); break;
+        case 'j': jitter = atoi(optarg); break;
+        case 'w': work = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (cores <= 0 || tasks <= 0 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    /* Tasks are never dereferenced by the fake DPU */
+    vector<DPUTask *> taskList;
+    for (int i = 0; i < tasks; i++) {
+        taskList.push_back((DPUTask *)(intptr_t)(i + 1));
+    }
+
+    printf("cores %d  tasks %d  latency %dus  jitter %dus  work %dus  runs %d\n",
+           cores, tasks, latency, jitter, work, runs);
+
+    /* 1. one thread per Task, blocking in the run function */
+    {
+        FakeDpuRun run(latency, jitter, cores);
+        Usage usage;
+        usage.Start();
+        vector<thread> workers;
+        for (int i = 0; i < tasks; i++) {
+            workers.emplace_back([&, i]() {
+                for (int r = i; r < runs; r += tasks) {
+                    CpuWork(work);
+                    run(taskList[i]);
+                }
+            });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        usage.Report("blocking", tasks, runs);
+    }
+
+    /* 2. one thread keeping all Tasks in flight through DpuAsync */
+    {
+        FakeDpuRun run(latency, jitter, cores);
+        Usage usage;
+        usage.Start();
+        DpuAsync dpu(run, cores, tasks);
+        int submitted = 0;
+        for (auto task : taskList) {
+            if (submitted < runs) {
+                CpuWork(work);
+                dpu.Submit(task);
+                submitted++;
+            }
+        }
+
+        vector<DpuCompletion> done(tasks);
+        int n;
+        while ((n = dpu.WaitMany(done.data(), tasks)) > 0) {
+            for (int i = 0; i < n && submitted < runs; i++) {
+                CpuWork(work);
+                dpu.Submit(done[i].task);
+                submitted++;
+            }
+        }
+        dpu.Close();
+        usage.Report("async", 1 + cores, runs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dpu_scheduler.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/**
+ * @brief Fake DPU cores shared by Kernels of different run times
+ */
+class FakeCores {
+public:
+    explicit FakeCores(int cores) : free_(cores) {}
+
+    int Run(int us) {
+        {
+            unique_lock<mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return free_ > 0; });
+            free_--;
+        }
+        this_thread::sleep_for(microseconds(us));
+        {
+            lock_guard<mutex> lock(mtx_);
+            free_++;
+        }
+        cv_.notify_one();
+        return 0;
+    }
+
+private:
+    mutex mtx_;
+    condition_variable cv_;
+    int free_;
+};
+
+struct Config {
+    int cores;
+    int bulk;                    // classification threads
+    int bulk_us;                 // run time of a classification
+    int detect_us;               // run time of a detection
+    int fps;                     // detection frames per second
+    int deadline_us;             // detection deadline
+    int seconds;
+};
+
+/**
+ * @brief Run classification flat out beside detection at a fixed frame rate
+ *
+ * @param config - the workloads
+ * @param classify - runs one classification
+ * @param detect - runs one detection
+ * @param mode - name of the mode in the report
+ */
+void RunMix(const Config &config, const function<void()> &classify,
+            const function<void()> &detect, const char *mode) {
+    atomic<bool> running(true);
+    atomic<long> classified(0);
+    LatencyHistogram latency;
+    long missed = 0;
+
+    vector<thread> bulk;
+    for (int i = 0; i < config.bulk; i++) {
+        bulk.emplace_back([&]() {
+            while (running) {
+                classify();
+                classified++;
+            }
+        });
+    }
+
+    /* frames arrive on a fixed clock, whether or not the last one is done */
+    auto period = microseconds(1000000 / config.fps);
+    auto start = steady_clock::now();
+    auto next = start;
+    while (next - start < seconds(config.seconds)) {
+        this_thread::sleep_until(next);
+        auto t0 = steady_clock::now();
+        detect();
+        auto ns = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+        latency.Record(ns);
+        if (ns > config.deadline_us * 1000L) {
+            missed++;
+        }
+        next += period;
+        while (next < steady_clock::now()) {
+            next += period;
+        }
+    }
+
+    running = false;
+    for (auto &t : bulk) {
+        t.join();
+    }
+    double elapsed = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000000.0;
+
+    printf("%-8s detect p50 %8.1fus p99 %8.1fus max %8.1fus missed %ld/%ld  classify %7.1f/s\n",
+           mode, latency.Percentile(0.5) / 1000.0, latency.Percentile(0.99) / 1000.0,
+           latency.max() / 1000.0, missed, (long)latency.count(), classified / elapsed);
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-c cores] [-b threads] [-l us] [-d us] [-f fps] [-D us] [-t seconds]\n", name);
+    printf("\tRun bulk classification beside real-time detection on a fake DPU,\n");
+    printf("\twith every thread grabbing the DPU and with DpuScheduler\n");
+    printf("\t-c cores: fake DPU cores (default: 2)\n");
+    printf("\t-b threads: classification threads (default: 8)\n");
+    printf("\t-l us: run time of a classification (default: 5000)\n");
+    printf("\t-d us: run time of a detection (default: 12000)\n");
+    printf("\t-f fps: detection frame rate (default: 30)\n");
+    printf("\t-D us: detection deadline (default: 33000)\n");
+    printf("\t-t seconds: duration of each mode (default: 5)\n");
+}
+
+int main(int argc, char **argv) {
+    Config config = {2, 8, 5000, 12000, 30, 33000, 5};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:b:l:d:f:D:t:")) != -1) {
+        switch (opt) {
+        case 'c': config.cores = atoi(optarg); break;
+        case 'b': config.bulk = atoi(optarg); break;
+        case 'l': config.bulk_us = atoi(optarg); break;
+        case 'd': config.detect_us = atoi(optarg); break;
+        case 'f': config.fps = atoi(optarg); break;
+        case 'D': config.deadline_us = atoi(optarg); break;
+        case 't': config.seconds = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (config.cores <= 0 || config.bulk < 0 || config.fps <= 0 || config.seconds <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    printf("cores %d  classify threads %d  %dus  detect %dfps %dus  deadline %dus\n",
+           config.cores, config.bulk, config.bulk_us, config.fps, config.detect_us,
+           config.deadline_us);
+
+    /* 1. every thread grabs a free core, as the samples do today */
+    {
+        FakeCores dpu(config.cores);
+        RunMix(config, [&]() { dpu.Run(config.bulk_us); },
+               [&]() { dpu.Run(config.detect_us); }, "shared");
+    }
+
+    /* 2. the cores are handed out by DpuScheduler */
+    {
+        FakeCores dpu(config.cores);
+        DpuScheduler sched(config.cores);
+        int classify = sched.AddWorkload("classify", [&](DPUTask *) { return dpu.Run(config.bulk_us); });
+        int detect = sched.AddWorkload("detect", [&](DPUTask *) { return dpu.Run(config.detect_us); },
+                                       1, 1, config.deadline_us);
+        RunMix(config, [&]() { sched.Run(classify, nullptr); },
+               [&]() { sched.Run(detect, nullptr); }, "sched");
+        sched.Close();
+        sched.Report();
+    }
+
+    return 0;
+}
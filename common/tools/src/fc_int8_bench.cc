@@ -0,0 +1,166 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fc_int8.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+void usage(const char *name) {
+    printf("Usage: %s [-i input_size] [-o output_size] [-n runs] [-f weights]\n", name);
+    printf("\tThroughput and accuracy of FcInt8, the CPU FC path, per batch size\n");
+    printf("\t-i input_size: pooled channels (default: 2048, ResNet50 fc1000)\n");
+    printf("\t-o output_size: classes (default: 1000)\n");
+    printf("\t-n runs: images per batch size (default: 2000)\n");
+    printf("\t-f weights: weights written by fc_pack instead of random ones\n");
+}
+
+int main(int argc, char **argv) {
+    int inputSize = 2048, outputSize = 1000, runs = 2000;
+    string file;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:n:f:")) != -1) {
+        switch (opt) {
+        case 'i': inputSize = atoi(optarg); break;
+        case 'o': outputSize = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        case 'f': file = optarg; break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (inputSize <= 0 || outputSize <= 0 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    mt19937 rng(1);
+    vector<float> weights, bias;
+    if (file.empty()) {
+        /* weights and biases of the size of a trained classifier's */
+        normal_distribution<float> w(0.0f, 0.02f), b(0.0f, 0.1f);
+        weights.resize((size_t)inputSize * outputSize);
+        bias.resize(outputSize);
+        for (auto &v : weights) {
+            v = w(rng);
+        }
+        for (auto &v : bias) {
+            v = b(rng);
+        }
+        file = "/tmp/fc_int8_bench.fcw";
+        if (!PackFcInt8(file, weights.data(), bias.data(), inputSize, outputSize, 0.0625f)) {
+            return -1;
+        }
+    }
+
+    FcInt8 fc;
+    if (!fc.Load(file)) {
+        return -1;
+    }
+    inputSize = fc.input_size();
+    outputSize = fc.output_size();
+
+    /* pooled activations, real value = input / inputScale */
+    const int images = 64;
+    const float inputScale = 16.0f;
+    uniform_int_distribution<int> x(-40, 127);
+    vector<vector<int8_t>> inputs(images, vector<int8_t>(inputSize));
+    vector<vector<int8_t>> outputs(images, vector<int8_t>(outputSize));
+    for (auto &in : inputs) {
+        for (auto &v : in) {
+            v = x(rng);
+        }
+    }
+
+    /* FP32 reference with the unquantized weights, when known */
+    if (!weights.empty()) {
+        int8_t *out = outputs[0].data();
+        fc.Run(inputs[0].data(), inputScale, out);
+        int worst = 0;
+        for (int o = 0; o < outputSize; o++) {
+            double sum = bias[o];
+            for (int i = 0; i < inputSize; i++) {
+                sum += weights[(size_t)o * inputSize + i] * (inputs[0][i] / inputScale);
+            }
+            long ref = lrint(min(max(sum / fc.output_scale(), -128.0), 127.0));
+            worst = max(worst, (int)labs(ref - out[o]));
+        }
+        printf("max difference to FP32 weights: %d LSB of %g\n", worst, fc.output_scale());
+    }
+
+    printf("FC %d -> %d, weights %.2f MB\n", inputSize, outputSize,
+           (double)inputSize * outputSize / (1 << 20));
+    for (int batch : {1, 2, 4, 8, 16}) {
+        vector<const int8_t *> in(batch);
+        vector<int8_t *> out(batch);
+        auto start = steady_clock::now();
+        int done = 0;
+        for (int r = 0; done < runs; r++, done += batch) {
+            for (int b = 0; b < batch; b++) {
+                in[b] = inputs[(r * batch + b) % images].data();
+                out[b] = outputs[(r * batch + b) % images].data();
+            }
+            fc.Run(in.data(), batch, inputScale, out.data());
+        }
+        double us = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0;
+        printf("batch %-3d %8.1f us/image  %8.1f images/s\n", batch, us / done, done * 1e6 / us);
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "fc_int8.h"
+
+using namespace std;
+using namespace deephi;
+
+/**
+ * @brief Read count FP32 values from a raw file, e.g. written by numpy tofile()
+ */
+bool ReadFloats(const string &file, size_t count, vector<float> &values) {
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        return false;
+    }
+    values.resize(count);
+    size_t n = fread(values.data(), sizeof(float), count, fp);
+    bool extra = fgetc(fp) != EOF;
+    fclose(fp);
+    if (n != count || extra) {
+        fprintf(stderr, "Error: %s does not hold %zu FP32 values.\n", file.c_str(), count);
+        return false;
+    }
+    return true;
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-s output_scale] input_size output_size weights bias output\n", name);
+    printf("\tQuantize the FP32 weights of an FC layer for FcInt8, the CPU FC path\n");
+    printf("\tweights: raw FP32 file of output_size rows of input_size weights, as in Caffe\n");
+    printf("\tbias: raw FP32 file of output_size biases\n");
+    printf("\t-s output_scale: scale of the INT8 logits (default: 0.25), the samples use\n");
+    printf("\t                 that of the DPU FC Kernel instead\n");
+}
+
+int main(int argc, char **argv) {
+    float outputScale = 0.25f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+        case 's': outputScale = atof(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (argc - optind != 5) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    int inputSize = atoi(argv[optind]);
+    int outputSize = atoi(argv[optind + 1]);
+    if (inputSize <= 0 || outputSize <= 0 || !(outputScale > 0)) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    vector<float> weights, bias;
+    if (!ReadFloats(argv[optind + 2], (size_t)inputSize * outputSize, weights) ||
+        !ReadFloats(argv[optind + 3], outputSize, bias)) {
+        return -1;
+    }
+    if (!PackFcInt8(argv[optind + 4], weights.data(), bias.data(), inputSize, outputSize,
+                    outputScale)) {
+        return -1;
+    }
+    printf("%s: %d x %d weights, output scale %g\n", argv[optind + 4], outputSize, inputSize,
+           outputScale);
+    return 0;
+}
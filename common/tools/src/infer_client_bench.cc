@@ -0,0 +1,246 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "infer_client.h"
+#include "stage_timer.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/**
+ * @brief Output of the fake DPU of dpu_inferd built with FAKE=1: element i
+ *        is the low 7 bits of the sum of input elements i, i + n, ...
+ */
+void FakeOutput(const int8_t *input, int inputSize, int8_t *output, int outputSize) {
+    vector<int> sum(outputSize, 0);
+    for (int i = 0; i < inputSize; i++) {
+        sum[i % outputSize] += input[i];
+    }
+    for (int i = 0; i < outputSize; i++) {
+        output[i] = (int8_t)(sum[i] & 0x7f);
+    }
+}
+
+struct ClientStats {
+    LatencyHistogram latency;
+    LatencyHistogram queue;
+    LatencyHistogram run;
+    uint64_t batched = 0;
+    int errors = 0;
+    int mismatches = 0;
+};
+
+/**
+ * @brief Keep slots requests in flight on one connection until runs replies
+ *        have come back
+ */
+void RunClient(const string &path, const string &kernel, int slots, int runs,
+               bool check, int seed, ClientStats &stats) {
+    InferClient client;
+    if (!client.Connect(kernel, slots, 0, path)) {
+        stats.errors = runs;
+        return;
+    }
+
+    int inputSize = client.kernel().input_size;
+    int outputSize = client.kernel().output_size;
+    mt19937 rng(seed);
+    vector<vector<int8_t>> expected(slots, vector<int8_t>(outputSize));
+    vector<steady_clock::time_point> sent(slots);
+    vector<int8_t> actual(outputSize);
+
+    auto submit = [&](int slot, uint64_t id) {
+        int8_t *input = client.input(slot);
+        for (int i = 0; i < inputSize; i++) {
+            input[i] = (int8_t)(rng() & 0xff);
+        }
+        if (check) {
+            FakeOutput(input, inputSize, expected[slot].data(), outputSize);
+        }
+        sent[slot] = steady_clock::now();
+        return client.Submit(slot, id);
+    };
+
+    int submitted = 0;
+    for (; submitted < slots && submitted < runs; submitted++) {
+        if (!submit(submitted, submitted)) {
+            stats.errors = runs;
+            return;
+        }
+    }
+    for (int done = 0; done < runs; done++) {
+        InferReply reply;
+        if (!client.Wait(reply)) {
+            stats.errors += runs - done;
+            return;
+        }
+        int slot = reply.slot;
+        stats.latency.Record(duration_cast<nanoseconds>(steady_clock::now() - sent[slot]).count());
+        stats.queue.Record(reply.queue_us * 1000ULL);
+        stats.run.Record(reply.run_us * 1000ULL);
+        stats.batched += reply.batch;
+        if (reply.status != 0) {
+            stats.errors++;
+        } else if (check && memcmp(client.output(slot), expected[slot].data(), outputSize)) {
+            stats.mismatches++;
+        }
+        if (submitted < runs && !submit(slot, submitted++)) {
+            stats.errors += runs - done - 1;
+            return;
+        }
+    }
+}
+
+void PrintHistogram(const char *name, const LatencyHistogram &hist) {
+    printf("  %-8s mean %8.3fms  p50 %8.3fms  p99 %8.3fms  max %8.3fms\n", name,
+           hist.Mean() / 1e6, hist.Percentile(0.5) / 1e6, hist.Percentile(0.99) / 1e6,
+           hist.max() / 1e6);
+}
+
+void usage(const char *name) {
+    printf("Usage: %s -k kernel [-s socket] [-t threads] [-q slots] [-n runs] [-r connects] [-v]\n", name);
+    printf("\tLoad test for dpu_inferd\n");
+    printf("\t-k kernel: Kernel loaded by the daemon\n");
+    printf("\t-s socket: socket of the daemon (default: %s)\n", INFERD_SOCKET);
+    printf("\t-t threads: client threads, one connection each (default: 4)\n");
+    printf("\t-q slots: requests in flight per connection (default: 1)\n");
+    printf("\t-n runs: requests per thread (default: 500)\n");
+    printf("\t-r connects: connections opened and closed to time Connect() (default: 100)\n");
+    printf("\t-v: check outputs against the fake DPU of a FAKE=1 daemon\n");
+}
+
+int main(int argc, char **argv) {
+    string path = INFERD_SOCKET, kernel;
+    int threads = 4, slots = 1, runs = 500, connects = 100;
+    bool check = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:s:t:q:n:r:v")) != -1) {
+        switch (opt) {
+        case 'k': kernel = optarg; break;
+        case 's': path = optarg; break;
+        case 't': threads = atoi(optarg); break;
+        case 'q': slots = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        case 'r': connects = atoi(optarg); break;
+        case 'v': check = true; break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (kernel.empty() || threads <= 0 || slots <= 0 || runs <= 0 || connects < 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    /* 1. cost of attaching to the resident Kernel */
+    LatencyHistogram connect;
+    for (int i = 0; i < connects; i++) {
+        InferClient client;
+        auto start = steady_clock::now();
+        if (!client.Connect(kernel, slots, 0, path)) {
+            return -1;
+        }
+        connect.Record(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    }
+    if (connects > 0) {
+        printf("connect x%d\n", connects);
+        PrintHistogram("connect", connect);
+    }
+
+    /* 2. requests from concurrent clients */
+    vector<ClientStats> stats(threads);
+    vector<thread> clients;
+    auto start = steady_clock::now();
+    for (int i = 0; i < threads; i++) {
+        clients.emplace_back(RunClient, cref(path), cref(kernel), slots, runs, check, i + 1,
+                             ref(stats[i]));
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    double seconds = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+
+    LatencyHistogram latency, queue, run;
+    uint64_t batched = 0;
+    int errors = 0, mismatches = 0;
+    for (auto &s : stats) {
+        latency.Merge(s.latency);
+        queue.Merge(s.queue);
+        run.Merge(s.run);
+        batched += s.batched;
+        errors += s.errors;
+        mismatches += s.mismatches;
+    }
+    uint64_t replies = latency.count();
+    printf("threads %d  slots %d  replies %lu  requests/s %.1f  mean batch %.2f  errors %d",
+           threads, slots, (unsigned long)replies, replies / seconds,
+           replies ? (double)batched / replies : 0.0, errors);
+    if (check) {
+        printf("  mismatches %d", mismatches);
+    }
+    printf("\n");
+    PrintHistogram("latency", latency);
+    PrintHistogram("queue", queue);
+    PrintHistogram("run", run);
+
+    return (errors || mismatches) ? -1 : 0;
+}
@@ -0,0 +1,228 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+#include <getopt.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "input_quantize.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/*
+ * mean 128 and scale 1 map the 256 pixel values to the 256 INT8 values, so
+ * the golden check compares every resized pixel and not only unsaturated ones
+ */
+static const float kMean[3] = {128.0f, 128.0f, 128.0f};
+static const float kScale = 1.0f;
+
+/* the path of dpuSetInputImageWithScale(): cv::resize() and quantization */
+void Reference(const cv::Mat &frame, int width, int height, RESIZE_TYPE type, cv::Mat &resized,
+               int8_t *data) {
+    if (type == RESIZE_TYPE_NONE) {
+        resized = frame;
+    } else {
+        int interp = (type == RESIZE_TYPE_NEAREST) ? cv::INTER_NEAREST : cv::INTER_LINEAR;
+        cv::resize(frame, resized, cv::Size(width, height), 0, 0, interp);
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *p = resized.ptr<uint8_t>(y);
+        for (int i = 0; i < width * 3; i++) {
+            long v = lrintf((p[i] - kMean[i % 3]) * kScale);
+            data[y * width * 3 + i] = (int8_t)(v > 127 ? 127 : (v < -128 ? -128 : v));
+        }
+    }
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-w width] [-h height] [-n runs] [-i file]\n", name);
+    printf("\tCheck ResizeQuantize against cv::resize and the quantization of\n");
+    printf("\tdpuSetInputImageWithScale for every resize type and compare their speed\n");
+    printf("\t-w width: width of the input Tensor (default: 224)\n");
+    printf("\t-h height: height of the input Tensor (default: 224)\n");
+    printf("\t-n runs: conversions timed per frame size and type (default: 50)\n");
+    printf("\t-i file: video or image whose frames are used instead of random ones\n");
+}
+
+/* number of values differing between the two outputs */
+int Compare(const vector<int8_t> &a, const vector<int8_t> &b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff += (a[i] != b[i]);
+    }
+    return diff;
+}
+
+/* microseconds per conversion of frame */
+template <typename Func>
+double Time(Func convert, const cv::Mat &frame, int runs) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        convert(frame);
+    }
+    return duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0 / runs;
+}
+
+/* a random BGR frame */
+cv::Mat RandomFrame(int width, int height, mt19937 &rng) {
+    uniform_int_distribution<int> byte(0, 255);
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int r = 0; r < frame.rows; r++) {
+        uint8_t *p = frame.ptr<uint8_t>(r);
+        for (int i = 0; i < frame.cols * 3; i++) {
+            p[i] = byte(rng);
+        }
+    }
+    return frame;
+}
+
+int main(int argc, char **argv) {
+    int width = 224, height = 224, runs = 50;
+    string file;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:h:n:i:")) != -1) {
+        switch (opt) {
+        case 'w': width = atoi(optarg); break;
+        case 'h': height = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        case 'i': file = optarg; break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (width < 2 || height < 2 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    /* frames: those of the file, or random ones of common sizes and
+       aspect ratios, including upscaled and odd sizes */
+    vector<cv::Mat> frames;
+    mt19937 rng(1);
+    if (!file.empty()) {
+        cv::VideoCapture video(file);
+        cv::Mat frame;
+        while (video.isOpened() && video.read(frame) && frames.size() < 100) {
+            frames.push_back(frame.clone());
+        }
+        if (frames.empty()) {
+            frame = cv::imread(file);
+            if (frame.empty()) {
+                fprintf(stderr, "Error: fail to read %s\n", file.c_str());
+                return -1;
+            }
+            frames.push_back(frame);
+        }
+    } else {
+        const int sizes[][2] = {{1920, 1080}, {1280, 720}, {640, 480}, {480, 640},
+                                {333, 217}, {width / 2 + 1, height / 3 + 1}};
+        for (auto &s : sizes) {
+            frames.push_back(RandomFrame(s[0], s[1], rng));
+        }
+    }
+    /* RESIZE_TYPE_NONE needs a frame of the Tensor size */
+    vector<cv::Mat> exact(1, RandomFrame(width, height, rng));
+
+    const RESIZE_TYPE types[] = {RESIZE_TYPE_LINEAR, RESIZE_TYPE_NEAREST, RESIZE_TYPE_NONE};
+    const char *names[] = {"LINEAR", "NEAREST", "NONE"};
+    InputQuantizer quantizer;
+    cv::Mat resized;
+    vector<int8_t> expected(width * height * 3), actual(width * height * 3);
+    int checked = 0, failed = 0;
+
+    /* golden check on every frame and type */
+    for (int t = 0; t < 3; t++) {
+        const vector<cv::Mat> &inputs = (types[t] == RESIZE_TYPE_NONE) ? exact : frames;
+        for (auto &frame : inputs) {
+            Reference(frame, width, height, types[t], resized, expected.data());
+            bool ok = quantizer.Run(frame, width, height, kMean, kScale, types[t], actual.data());
+            int diff = ok ? Compare(expected, actual) : (int)expected.size();
+            if (diff) {
+                fprintf(stderr, "Error: %s of a %dx%d frame differs in %d of %d values\n",
+                        names[t], frame.cols, frame.rows, diff, (int)expected.size());
+                failed++;
+            }
+            checked++;
+        }
+    }
+    printf("golden check: %d of %d conversions identical\n", checked - failed, checked);
+
+    /* speed per type and frame size, first frame of each size */
+    printf("%-8s %-11s %12s %12s %8s\n", "type", "frame", "opencv us", "fused us", "speedup");
+    for (int t = 0; t < 3; t++) {
+        const vector<cv::Mat> &inputs = (types[t] == RESIZE_TYPE_NONE) ? exact : frames;
+        cv::Size last;
+        for (auto &frame : inputs) {
+            if (frame.size() == last) {
+                continue;
+            }
+            last = frame.size();
+            double ref = Time([&](const cv::Mat &f) {
+                Reference(f, width, height, types[t], resized, expected.data());
+            }, frame, runs);
+            double fused = Time([&](const cv::Mat &f) {
+                quantizer.Run(f, width, height, kMean, kScale, types[t], actual.data());
+            }, frame, runs);
+            char name[32];
+            snprintf(name, sizeof(name), "%dx%d", frame.cols, frame.rows);
+            printf("%-8s %-11s %12.1f %12.1f %7.1fx\n", names[t], name, ref, fused, ref / fused);
+        }
+    }
+
+    return failed ? -1 : 0;
+}
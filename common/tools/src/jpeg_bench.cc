@@ -0,0 +1,148 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <dirent.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "image_loader.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace cv;
+using namespace deephi;
+
+/**
+ * @brief List the JPEG images under path
+ */
+void ListImages(const string &path, vector<string> &images) {
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        fprintf(stderr, "Error: Fail to open %s.\n", path.c_str());
+        exit(1);
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string name = entry->d_name;
+        size_t dot = name.rfind('.');
+        if (dot == string::npos) {
+            continue;
+        }
+        string ext = name.substr(dot + 1);
+        if (ext == "jpg" || ext == "JPG" || ext == "jpeg" || ext == "JPEG") {
+            images.push_back(path + name);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Decode all images with load() and return milliseconds per image
+ */
+template <typename F>
+double timeIt(const vector<string> &images, int passes, vector<Mat> &out, F load) {
+    out.resize(images.size());
+    auto start = steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (size_t i = 0; i < images.size(); i++) {
+            load(images[i], out[i]);
+        }
+    }
+    auto end = steady_clock::now();
+    return duration_cast<microseconds>(end - start).count() / 1000.0 / (images.size() * passes);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s image_dir [width height [passes]]\n", argv[0]);
+        printf("\te.g. %s ../image500_640_480/ 224 224\n", argv[0]);
+        return -1;
+    }
+
+    string path = argv[1];
+    if (path.back() != '/') {
+        path += '/';
+    }
+    Size size((argc > 3) ? atoi(argv[2]) : 224, (argc > 3) ? atoi(argv[3]) : 224);
+    int passes = (argc > 4) ? atoi(argv[4]) : 1;
+
+    vector<string> images;
+    ListImages(path, images);
+    if (images.empty()) {
+        fprintf(stderr, "Error: No JPEG image under %s.\n", path.c_str());
+        return -1;
+    }
+
+    /* the path used by the samples: full decode, then a resize to the input */
+    vector<Mat> ref, scaled;
+    double refMs = timeIt(images, passes, ref, [&](const string &name, Mat &image) {
+        Mat full = imread(name);
+        resize(full, image, size);
+    });
+    double scaledMs = timeIt(images, passes, scaled, [&](const string &name, Mat &image) {
+        LoadImageScaled(name, size, image);
+    });
+
+    /* mean absolute difference per pixel channel between the two paths */
+    double diff = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+        diff += norm(ref[i], scaled[i], NORM_L1) / (size.area() * 3.0);
+    }
+
+    printf("images %zu  input %dx%d  passes %d\n", images.size(), size.width, size.height, passes);
+    printf("imread+resize  %8.3f ms/image  %8.1f images/s\n", refMs, 1000.0 / refMs);
+    printf("DCT scaled     %8.3f ms/image  %8.1f images/s\n", scaledMs, 1000.0 / scaledMs);
+    printf("speedup %.2fx  mean abs diff %.2f\n", refMs / scaledMs, diff / images.size());
+
+    return 0;
+}
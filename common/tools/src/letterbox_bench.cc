@@ -0,0 +1,375 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "yolo_letterbox.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/* Darknet image functions, the letterbox of adas_detection before
+   YoloLetterbox and the reference */
+typedef struct {
+    int w;
+    int h;
+    int c;
+    float *data;
+} image;
+
+static float get_pixel(image m, int x, int y, int c)
+{
+    assert(x < m.w && y < m.h && c < m.c);
+    return m.data[c*m.h*m.w + y*m.w + x];
+}
+
+static void set_pixel(image m, int x, int y, int c, float val)
+{
+    if (x < 0 || y < 0 || c < 0 || x >= m.w || y >= m.h || c >= m.c) return;
+    assert(x < m.w && y < m.h && c < m.c);
+    m.data[c*m.h*m.w + y*m.w + x] = val;
+}
+
+static void add_pixel(image m, int x, int y, int c, float val)
+{
+    assert(x < m.w && y < m.h && c < m.c);
+    m.data[c*m.h*m.w + y*m.w + x] += val;
+}
+
+image make_empty_image(int w, int h, int c)
+{
+    image out;
+    out.data = 0;
+    out.h = h;
+    out.w = w;
+    out.c = c;
+    return out;
+}
+
+void free_image(image m)
+{
+    if(m.data){
+        free(m.data);
+    }
+}
+
+image make_image(int w, int h, int c)
+{
+    image out = make_empty_image(w,h,c);
+    out.data = (float*) calloc(h*w*c, sizeof(float));
+    return out;
+}
+
+void fill_image(image m, float s)
+{
+    int i;
+    for(i = 0; i < m.h*m.w*m.c; ++i) m.data[i] = s;
+}
+
+void embed_image(image source, image dest, int dx, int dy)
+{
+    int x,y,k;
+    for(k = 0; k < source.c; ++k){
+        for(y = 0; y < source.h; ++y){
+            for(x = 0; x < source.w; ++x){
+                float val = get_pixel(source, x,y,k);
+                set_pixel(dest, dx+x, dy+y, k, val);
+            }
+        }
+    }
+}
+
+image resize_image(image im, int w, int h)
+{
+    image resized = make_image(w, h, im.c);
+    image part = make_image(w, im.h, im.c);
+    int r, c, k;
+    float w_scale = (float)(im.w - 1) / (w - 1);
+    float h_scale = (float)(im.h - 1) / (h - 1);
+    for(k = 0; k < im.c; ++k){
+        for(r = 0; r < im.h; ++r){
+            for(c = 0; c < w; ++c){
+                float val = 0;
+                if(c == w-1 || im.w == 1){
+                    val = get_pixel(im, im.w-1, r, k);
+                } else {
+                    float sx = c*w_scale;
+                    int ix = (int) sx;
+                    float dx = sx - ix;
+                    val = (1 - dx) * get_pixel(im, ix, r, k) + dx * get_pixel(im, ix+1, r, k);
+                }
+                set_pixel(part, c, r, k, val);
+            }
+        }
+    }
+    for(k = 0; k < im.c; ++k){
+        for(r = 0; r < h; ++r){
+            float sy = r*h_scale;
+            int iy = (int) sy;
+            float dy = sy - iy;
+            for(c = 0; c < w; ++c){
+                float val = (1-dy) * get_pixel(part, c, iy, k);
+                set_pixel(resized, c, r, k, val);
+            }
+            if(r == h-1 || im.h == 1) continue;
+            for(c = 0; c < w; ++c){
+                float val = dy * get_pixel(part, c, iy+1, k);
+                add_pixel(resized, c, r, k, val);
+            }
+        }
+    }
+
+    free_image(part);
+    return resized;
+}
+
+image load_image_cv(const cv::Mat& img) {
+    int h = img.rows;
+    int w = img.cols;
+    int c = img.channels();
+    image im = make_image(w, h, c);
+
+    unsigned char *data = img.data;
+
+    for(int i = 0; i < h; ++i){
+        for(int k= 0; k < c; ++k){
+            for(int j = 0; j < w; ++j){
+                im.data[k*w*h + i*w + j] = data[i*w*c + j*c + k]/256.;
+            }
+        }
+    }
+
+    for(int i = 0; i < im.w*im.h; ++i){
+        float swap = im.data[i];
+        im.data[i] = im.data[i+im.w*im.h*2];
+        im.data[i+im.w*im.h*2] = swap;
+    }
+
+    return im;
+}
+
+image letterbox_image(image im, int w, int h)
+{
+    int new_w = im.w;
+    int new_h = im.h;
+    if (((float)w/im.w) < ((float)h/im.h)) {
+        new_w = w;
+        new_h = (im.h * w)/im.w;
+    } else {
+        new_h = h;
+        new_w = (im.w * h)/im.h;
+    }
+    image resized = resize_image(im, new_w, new_h);
+    image boxed = make_image(w, h, im.c);
+    fill_image(boxed, .5);
+
+    embed_image(resized, boxed, (w-new_w)/2, (h-new_h)/2);
+    free_image(resized);
+
+    return boxed;
+}
+
+/* the Darknet path of setInputImageForYOLO() in adas_detection */
+void ReferenceLetterbox(const cv::Mat &frame, int width, int height, int8_t *data) {
+    int size = width * height * 3;
+    image img_new = load_image_cv(frame);
+    image img_yolo = letterbox_image(img_new, width, height);
+
+    vector<float> bb(size);
+    for (int b = 0; b < height; ++b) {
+        for (int c = 0; c < width; ++c) {
+            for (int a = 0; a < 3; ++a) {
+                bb[b*width*3 + c*3 + a] = img_yolo.data[a*height*width + b*width + c];
+            }
+        }
+    }
+
+    float scale = pow(2, 7);
+
+    for (int i = 0; i < size; ++i) {
+        data[i] = int(bb.data()[i]*scale);
+        if (data[i] < 0) data[i] = 127;
+    }
+
+    free_image(img_new);
+    free_image(img_yolo);
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-w width] [-h height] [-n runs] [-i file]\n", name);
+    printf("\tCheck YoloLetterbox against the Darknet letterbox of adas_detection\n");
+    printf("\tand compare their speed\n");
+    printf("\t-w width: width of the YOLO input (default: 512)\n");
+    printf("\t-h height: height of the YOLO input (default: 256)\n");
+    printf("\t-n runs: letterboxes timed per frame size (default: 50)\n");
+    printf("\t-i file: video or image whose frames are used instead of random ones\n");
+}
+
+/* number of bytes differing between the two outputs */
+int Compare(const vector<int8_t> &a, const vector<int8_t> &b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff += (a[i] != b[i]);
+    }
+    return diff;
+}
+
+/* microseconds per letterbox of frame */
+template <typename Func>
+double Time(Func letterbox, const cv::Mat &frame, int runs) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        letterbox(frame);
+    }
+    return duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0 / runs;
+}
+
+int main(int argc, char **argv) {
+    int width = 512, height = 256, runs = 50;
+    string file;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:h:n:i:")) != -1) {
+        switch (opt) {
+        case 'w': width = atoi(optarg); break;
+        case 'h': height = atoi(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        case 'i': file = optarg; break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (width < 2 || height < 2 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    /* frames: those of the file, or random ones of common sizes and
+       aspect ratios, including upscaled and odd sizes */
+    vector<cv::Mat> frames;
+    if (!file.empty()) {
+        cv::VideoCapture video(file);
+        cv::Mat frame;
+        while (video.isOpened() && video.read(frame) && frames.size() < 100) {
+            frames.push_back(frame.clone());
+        }
+        if (frames.empty()) {
+            frame = cv::imread(file);
+            if (frame.empty()) {
+                fprintf(stderr, "Error: fail to read %s\n", file.c_str());
+                return -1;
+            }
+            frames.push_back(frame);
+        }
+    } else {
+        const int sizes[][2] = {{1280, 720}, {1920, 1080}, {640, 480}, {480, 640},
+                                {333, 217}, {width, height}, {width / 2 + 1, height / 3 + 1}};
+        mt19937 rng(1);
+        uniform_int_distribution<int> byte(0, 255);
+        for (auto &s : sizes) {
+            cv::Mat frame(s[1], s[0], CV_8UC3);
+            for (int r = 0; r < frame.rows; r++) {
+                uint8_t *p = frame.ptr<uint8_t>(r);
+                for (int i = 0; i < frame.cols * 3; i++) {
+                    p[i] = byte(rng);
+                }
+            }
+            frames.push_back(frame);
+        }
+    }
+
+    YoloLetterbox letterbox;
+    vector<int8_t> expected(width * height * 3), actual(width * height * 3);
+    int failed = 0;
+
+    /* golden check on every frame */
+    for (auto &frame : frames) {
+        ReferenceLetterbox(frame, width, height, expected.data());
+        letterbox.Run(frame, width, height, actual.data());
+        int diff = Compare(expected, actual);
+        if (diff) {
+            fprintf(stderr, "Error: %dx%d frame differs in %d of %d values\n",
+                    frame.cols, frame.rows, diff, (int)expected.size());
+            failed++;
+        }
+    }
+    printf("golden check: %d of %d frames identical\n", (int)frames.size() - failed,
+           (int)frames.size());
+
+    /* speed per frame size, first frame of each size */
+    printf("%-11s %12s %12s %8s\n", "frame", "darknet us", "fused us", "speedup");
+    cv::Size last;
+    for (auto &frame : frames) {
+        if (frame.size() == last) {
+            continue;
+        }
+        last = frame.size();
+        double ref = Time([&](const cv::Mat &f) {
+            ReferenceLetterbox(f, width, height, expected.data());
+        }, frame, runs);
+        double fused = Time([&](const cv::Mat &f) {
+            letterbox.Run(f, width, height, actual.data());
+        }, frame, runs);
+        char name[32];
+        snprintf(name, sizeof(name), "%dx%d", frame.cols, frame.rows);
+        printf("%-11s %12.1f %12.1f %7.1fx\n", name, ref, fused, ref / fused);
+    }
+
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,193 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "nms.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+void usage(const char *name) {
+    printf("Usage: %s [-n max_boxes] [-c clusters] [-r runs]\n", name);
+    printf("\tCheck NmsEngine against the all-pairs sweeps and compare their speed\n");
+    printf("\ton YOLO (3 classes, IoU 0.3) and DenseBox (IoU 0.35) candidates\n");
+    printf("\t-n max_boxes: largest number of candidates (default: 20000)\n");
+    printf("\t-c clusters: objects the candidates gather around (default: 50)\n");
+    printf("\t-r runs: runs timed per size, fewer for the largest (default: 20)\n");
+}
+
+/*
+ * Candidates gathered around objects as detectors produce them, with
+ * scores in steps of 1/256 so that ties occur as with the INT8 outputs
+ */
+void Generate(NmsEngine::Format format, int n, int clusters, mt19937 &rng, Detections &boxes) {
+    uniform_real_distribution<float> u(0.0f, 1.0f);
+    normal_distribution<float> jitter(0.0f, 0.05f);
+    vector<float> cx(clusters), cy(clusters), cw(clusters), ch(clusters);
+    for (int c = 0; c < clusters; c++) {
+        cx[c] = u(rng);
+        cy[c] = u(rng);
+        cw[c] = 0.02f + 0.15f * u(rng);
+        ch[c] = 0.02f + 0.15f * u(rng);
+    }
+
+    boxes.set_classes(format == NmsEngine::CENTER_SIZE ? 3 : 0);
+    boxes.reserve(n);
+    for (int i = 0; i < n; i++) {
+        int c = rng() % clusters;
+        float x = cx[c] + jitter(rng) * cw[c];
+        float y = cy[c] + jitter(rng) * ch[c];
+        float w = cw[c] * (1 + jitter(rng));
+        float h = ch[c] * (1 + jitter(rng));
+        float score = (rng() % 256) / 256.0f;
+        if (format == NmsEngine::CENTER_SIZE) {
+            size_t b = boxes.Add(x, y, w, h, score);
+            for (int k = 0; k < 3; k++) {
+                boxes.class_score(k)[b] = score * ((rng() % 256) / 256.0f);
+            }
+        } else {
+            /* pixels of a 640x360 DenseBox input */
+            boxes.Add((x - w / 2) * 640, (y - h / 2) * 360, (x + w / 2) * 640,
+                      (y + h / 2) * 360, score);
+        }
+    }
+}
+
+bool Same(const Detections &a, const Detections &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int k = 0; k < 4; k++) {
+            if (a.coord(k)[i] != b.coord(k)[i]) {
+                return false;
+            }
+        }
+        if (a.score()[i] != b.score()[i] || a.label()[i] != b.label()[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int maxBoxes = 20000, clusters = 50, runs = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:r:")) != -1) {
+        switch (opt) {
+        case 'n': maxBoxes = atoi(optarg); break;
+        case 'c': clusters = atoi(optarg); break;
+        case 'r': runs = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (maxBoxes <= 0 || clusters <= 0 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    const struct {
+        const char *name;
+        NmsEngine::Format format;
+        float threshold;
+        float min_score;
+    } models[] = {{"yolo", NmsEngine::CENTER_SIZE, 0.3f, 0.5f},
+                  {"densebox", NmsEngine::CORNERS, 0.35f, -1.0f}};
+    const int sizes[] = {100, 300, 1000, 3000, 10000, 20000, 50000};
+
+    mt19937 rng(1);
+    bool same = true;
+    printf("%-9s %7s %6s %12s %12s %8s\n", "model", "boxes", "kept", "all-pairs us",
+           "engine us", "speedup");
+    for (auto &m : models) {
+        NmsEngine engine(m.format);
+        Detections boxes, expected, actual;
+        for (int n : sizes) {
+            if (n > maxBoxes) {
+                break;
+            }
+            Generate(m.format, n, clusters, rng, boxes);
+
+            /* golden check, then time both */
+            NmsAllPairs(m.format, boxes, m.threshold, m.min_score, expected);
+            engine.Run(boxes, m.threshold, m.min_score, actual);
+            if (!Same(expected, actual)) {
+                fprintf(stderr, "Error: %s with %d boxes: %d boxes kept, %d expected\n",
+                        m.name, n, (int)actual.size(), (int)expected.size());
+                same = false;
+            }
+
+            int r = max(1, runs * 1000 / max(n, 1000));
+            auto start = steady_clock::now();
+            for (int i = 0; i < r; i++) {
+                NmsAllPairs(m.format, boxes, m.threshold, m.min_score, expected);
+            }
+            double reference = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e3 / r;
+            start = steady_clock::now();
+            for (int i = 0; i < r; i++) {
+                engine.Run(boxes, m.threshold, m.min_score, actual);
+            }
+            double fast = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e3 / r;
+            printf("%-9s %7d %6d %12.1f %12.1f %7.1fx\n", m.name, n, (int)actual.size(),
+                   reference, fast, reference / fast);
+        }
+    }
+    printf("golden check: %s\n", same ? "identical" : "different");
+
+    return same ? 0 : -1;
+}
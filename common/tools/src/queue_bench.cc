@@ -0,0 +1,357 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "reorder_buffer.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/* frames as the video samples pass them: index and some payload */
+typedef pair<int, vector<char>> Frame;
+
+/**
+ * @brief Spin for us microseconds, standing for the CPU work of a stage
+ */
+void CpuWork(int us) {
+    auto end = steady_clock::now() + microseconds(us);
+    while (steady_clock::now() < end) {
+    }
+}
+
+/**
+ * @brief Stand-in for one frame through a worker: post-processing on the
+ *        CPU while the DPU, which needs no CPU, runs for dpu_us
+ */
+void Process(int work_us, int dpu_us) {
+    this_thread::sleep_for(microseconds(dpu_us));
+    CpuWork(work_us);
+}
+
+struct Options {
+    int workers = 4;
+    int fps = 30;
+    int work_us = 3000;
+    int dpu_us = 20000;
+    int frames = 300;
+};
+
+/**
+ * @brief Wall time, CPU time and context switches of one mode
+ */
+struct Usage {
+    steady_clock::time_point wall;
+    struct rusage ru;
+
+    void Start() {
+        wall = steady_clock::now();
+        getrusage(RUSAGE_SELF, &ru);
+    }
+
+    void Report(const char *mode, int frames) const {
+        struct rusage end;
+        getrusage(RUSAGE_SELF, &end);
+        double seconds = duration_cast<microseconds>(steady_clock::now() - wall).count() / 1000000.0;
+        auto us = [](const struct timeval &tv) { return tv.tv_sec * 1000000.0 + tv.tv_usec; };
+        double cpu = (us(end.ru_utime) - us(ru.ru_utime) + us(end.ru_stime) - us(ru.ru_stime)) / 1000000.0;
+
+        printf("%-8s frames/s %7.1f  cpu %7.2fs  cpu load %6.1f%% of a core"
+               "  voluntary cs %-8ld involuntary cs %ld\n",
+               mode, frames / seconds, cpu, 100.0 * cpu / seconds,
+               end.ru_nvcsw - ru.ru_nvcsw, end.ru_nivcsw - ru.ru_nivcsw);
+    }
+};
+
+/**
+ * @brief The samples as they were: mutex-guarded std::queue, workers
+ *        spinning on an empty input queue and the display polling
+ */
+void RunPolling(const Options &opt) {
+    queue<Frame> input;
+    priority_queue<Frame, vector<Frame>, greater<Frame>> show;
+    mutex mtxInput, mtxShow;
+    bool reading = true;
+    int running = opt.workers;
+
+    thread reader([&]() {
+        auto next = steady_clock::now();
+        int index = 0;
+        while (index < opt.frames) {
+            this_thread::sleep_until(next);
+            next += microseconds(1000000 / opt.fps);
+            if (input.size() < 30) {
+                mtxInput.lock();
+                input.push(make_pair(index++, vector<char>(64)));
+                mtxInput.unlock();
+            } else {
+                usleep(20);
+            }
+        }
+        reading = false;
+    });
+
+    vector<thread> workers;
+    for (int i = 0; i < opt.workers; i++) {
+        workers.emplace_back([&]() {
+            while (true) {
+                Frame frame;
+                mtxInput.lock();
+                if (input.empty()) {
+                    mtxInput.unlock();
+                    if (reading) {
+                        continue;
+                    } else {
+                        break;
+                    }
+                }
+                frame = input.front();
+                input.pop();
+                mtxInput.unlock();
+
+                Process(opt.work_us, opt.dpu_us);
+
+                mtxShow.lock();
+                show.push(frame);
+                mtxShow.unlock();
+            }
+            mtxShow.lock();
+            running--;
+            mtxShow.unlock();
+        });
+    }
+
+    int shown = 0;
+    while (true) {
+        mtxShow.lock();
+        if (show.empty()) {
+            bool done = running == 0;
+            mtxShow.unlock();
+            if (done) {
+                break;
+            }
+            usleep(20);
+        } else if (show.top().first == shown) {
+            show.pop();
+            shown++;
+            mtxShow.unlock();
+        } else {
+            mtxShow.unlock();
+        }
+    }
+
+    reader.join();
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
+/**
+ * @brief BoundedQueue between the stages, every thread sleeping until it
+ *        has a frame, and the display sorting the frames in a priority queue
+ */
+void RunBlocking(const Options &opt) {
+    BoundedQueue<Frame> input(30);
+    BoundedQueue<Frame> show(30 + opt.workers);
+    int running = opt.workers;
+    mutex mtxRunning;
+
+    thread reader([&]() {
+        auto next = steady_clock::now();
+        for (int index = 0; index < opt.frames; index++) {
+            this_thread::sleep_until(next);
+            next += microseconds(1000000 / opt.fps);
+            input.Push(make_pair(index, vector<char>(64)));
+        }
+        input.Close();
+    });
+
+    vector<thread> workers;
+    for (int i = 0; i < opt.workers; i++) {
+        workers.emplace_back([&]() {
+            Frame frame;
+            while (input.Pop(frame)) {
+                Process(opt.work_us, opt.dpu_us);
+                show.Push(move(frame));
+            }
+            lock_guard<mutex> lock(mtxRunning);
+            if (--running == 0) {
+                show.Close();
+            }
+        });
+    }
+
+    priority_queue<Frame, vector<Frame>, greater<Frame>> reorder;
+    int shown = 0;
+    Frame frame;
+    while (show.Pop(frame)) {
+        reorder.push(move(frame));
+        while (!reorder.empty() && reorder.top().first == shown) {
+            reorder.pop();
+            shown++;
+        }
+    }
+
+    reader.join();
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
+/**
+ * @brief The samples now: BoundedQueue into the workers and a ReorderBuffer
+ *        out of them, the display woken only by the next frame
+ */
+void RunReorder(const Options &opt) {
+    BoundedQueue<Frame> input(30);
+    ReorderBuffer<vector<char>> show(30 + opt.workers);
+    int running = opt.workers;
+    mutex mtxRunning;
+
+    thread reader([&]() {
+        auto next = steady_clock::now();
+        for (int index = 0; index < opt.frames; index++) {
+            this_thread::sleep_until(next);
+            next += microseconds(1000000 / opt.fps);
+            input.Push(make_pair(index, vector<char>(64)));
+        }
+        input.Close();
+    });
+
+    vector<thread> workers;
+    for (int i = 0; i < opt.workers; i++) {
+        workers.emplace_back([&]() {
+            Frame frame;
+            while (input.Pop(frame)) {
+                Process(opt.work_us, opt.dpu_us);
+                show.Put(frame.first, move(frame.second));
+            }
+            lock_guard<mutex> lock(mtxRunning);
+            if (--running == 0) {
+                show.Close();
+            }
+        });
+    }
+
+    long index;
+    vector<char> data;
+    long shown = 0;
+    while (show.Next(index, data)) {
+        if (index != shown++) {
+            fprintf(stderr, "Error: frame %ld shown in place of %ld\n", index, shown - 1);
+        }
+    }
+
+    reader.join();
+    for (auto &w : workers) {
+        w.join();
+    }
+    show.Report("display");
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-t workers] [-f fps] [-w work_us] [-d dpu_us] [-n frames]\n", name);
+    printf("\tCPU load of the video sample pipeline, reader -> workers -> display,\n");
+    printf("\twith spin-polling queues, BoundedQueue and BoundedQueue plus ReorderBuffer\n");
+    printf("\t-t workers: worker threads (default: 4)\n");
+    printf("\t-f fps: frame rate of the reader (default: 30)\n");
+    printf("\t-w work_us: CPU work of a worker per frame (default: 3000)\n");
+    printf("\t-d dpu_us: DPU time of a worker per frame, no CPU (default: 20000)\n");
+    printf("\t-n frames: frames of the stream (default: 300)\n");
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:f:w:d:n:")) != -1) {
+        switch (c) {
+        case 't': opt.workers = atoi(optarg); break;
+        case 'f': opt.fps = atoi(optarg); break;
+        case 'w': opt.work_us = atoi(optarg); break;
+        case 'd': opt.dpu_us = atoi(optarg); break;
+        case 'n': opt.frames = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (opt.workers <= 0 || opt.fps <= 0 || opt.frames <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    printf("workers %d  fps %d  work %dus  dpu %dus  frames %d  cores %u\n", opt.workers,
+           opt.fps, opt.work_us, opt.dpu_us, opt.frames, thread::hardware_concurrency());
+
+    Usage usage;
+    usage.Start();
+    RunPolling(opt);
+    usage.Report("polling", opt.frames);
+
+    usage.Start();
+    RunBlocking(opt);
+    usage.Report("blocking", opt.frames);
+
+    usage.Start();
+    RunReorder(opt);
+    usage.Report("reorder", opt.frames);
+
+    return 0;
+}
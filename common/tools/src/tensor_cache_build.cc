@@ -0,0 +1,219 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <dirent.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "image_loader.h"
+#include "tensor_cache.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace cv;
+using namespace deephi;
+
+/**
+ * @brief List the images under path, the same way as the *_mt samples
+ */
+void ListImages(const string &path, vector<string> &images) {
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        fprintf(stderr, "Error: Fail to open %s.\n", path.c_str());
+        exit(1);
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string name = entry->d_name;
+        string ext = name.substr(name.find_last_of(".") + 1);
+        if (ext == "JPEG" || ext == "jpeg" || ext == "JPG" || ext == "jpg" ||
+            ext == "PNG" || ext == "png") {
+            images.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    sort(images.begin(), images.end());
+}
+
+/**
+ * @brief Read image names from a list file, the first word of each line,
+ *        e.g. a calibration list of "name label" lines
+ */
+void LoadList(const string &file, vector<string> &images) {
+    ifstream fs(file);
+    if (!fs) {
+        fprintf(stderr, "Error: Fail to open %s.\n", file.c_str());
+        exit(1);
+    }
+
+    string line, name;
+    while (getline(fs, line)) {
+        istringstream is(line);
+        if (is >> name) {
+            images.push_back(name);
+        }
+    }
+}
+
+void usage(const char *name) {
+    printf("Usage: %s [-j threads] [-l list] image_dir cache_file width height scale"
+           " [mean_b mean_g mean_r]\n", name);
+    printf("\t-j threads: number of decoding threads (default: number of CPUs)\n");
+    printf("\t-l list: take image names from the first word of each line of list\n");
+    printf("\tscale: image scale times dpuGetInputTensorScale() of the input Node\n");
+    printf("\tmean: per channel mean in BGR order (default: 104 117 123), the mean the\n");
+    printf("\t      Kernel was compiled with, which the samples take with -m b,g,r\n");
+    printf("\te.g. %s ../image500_640_480/ resnet50.tc 224 224 0.5\n", name);
+}
+
+int main(int argc, char **argv) {
+    int threads = thread::hardware_concurrency();
+    string list;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:l:")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = atoi(optarg);
+            break;
+        case 'l':
+            list = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    int args = argc - optind;
+    if (args != 5 && args != 8) {
+        usage(argv[0]);
+        return -1;
+    }
+    char **arg = argv + optind;
+
+    string path = arg[0];
+    if (path.back() != '/') {
+        path += '/';
+    }
+    string cacheFile = arg[1];
+
+    TensorCacheKey key = {atoi(arg[2]), atoi(arg[3]), 3, {104, 117, 123}, (float)atof(arg[4])};
+    if (args == 8) {
+        for (int c = 0; c < 3; c++) {
+            key.mean[c] = atof(arg[5 + c]);
+        }
+    }
+    if (key.width <= 0 || key.height <= 0 || key.scale <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    vector<string> images;
+    if (list.empty()) {
+        ListImages(path, images);
+    } else {
+        LoadList(list, images);
+    }
+    if (images.empty()) {
+        fprintf(stderr, "Error: No image to cache.\n");
+        return -1;
+    }
+
+    TensorCacheWriter writer;
+    if (!writer.Create(cacheFile, key, images)) {
+        return -1;
+    }
+
+    /* Every thread decodes, resizes and quantizes straight into the file */
+    auto start = steady_clock::now();
+    atomic<int> next(0), failed(0);
+    vector<thread> workers;
+    for (int t = 0; t < max(threads, 1); t++) {
+        workers.emplace_back([&]() {
+            int i;
+            Mat image;
+            while ((i = next++) < (int)images.size()) {
+                if (!LoadImageScaled(path + images[i], Size(key.width, key.height), image)
+                    || !writer.Store(i, image)) {
+                    fprintf(stderr, "Error: Fail to cache %s.\n", images[i].c_str());
+                    failed++;
+                }
+            }
+        });
+    }
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    if (!writer.Commit()) {
+        return -1;
+    }
+    auto duration = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    printf("cached %d of %zu images  input %dx%dx%d  mean %g %g %g  scale %g\n",
+           (int)images.size() - failed, images.size(), key.width, key.height, key.channel,
+           key.mean[0], key.mean[1], key.mean[2], key.scale);
+    printf("threads %d  time %.2fs  %.1f images/s\n", max(threads, 1), duration / 1000000.0,
+           images.size() * 1000000.0 / duration);
+
+    return failed ? 1 : 0;
+}
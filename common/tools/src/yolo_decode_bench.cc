@@ -0,0 +1,261 @@
+/*
+-- (c) Copyright 2018 Xilinx, Inc. All rights reserved.
+--
+-- This file contains confidential and proprietary information
+-- of Xilinx, Inc. and is protected under U.S. and
+-- international copyright and other intellectual property
+-- laws.
+--
+-- DISCLAIMER
+-- This disclaimer is not a license and does not grant any
+-- rights to the materials distributed herewith. Except as
+-- otherwise provided in a valid license issued to you by
+-- Xilinx, and to the maximum extent permitted by applicable
+-- law: (1) THESE MATERIALS ARE MADE AVAILABLE "AS IS" AND
+-- WITH ALL FAULTS, AND XILINX HEREBY DISCLAIMS ALL WARRANTIES
+-- AND CONDITIONS, EXPRESS, IMPLIED, OR STATUTORY, INCLUDING
+-- BUT NOT LIMITED TO WARRANTIES OF MERCHANTABILITY, NON-
+-- INFRINGEMENT, OR FITNESS FOR ANY PARTICULAR PURPOSE; and
+-- (2) Xilinx shall not be liable (whether in contract or tort,
+-- including negligence, or under any other theory of
+-- liability) for any loss or damage of any kind or nature
+-- related to, arising under or in connection with these
+-- materials, including for any direct, or any indirect,
+-- special, incidental, or consequential loss or damage
+-- (including loss of data, profits, goodwill, or any type of
+-- loss or damage suffered as a result of any action brought
+-- by a third party) even if such damage or loss was
+-- reasonably foreseeable or Xilinx had been advised of the
+-- possibility of the same.
+--
+-- CRITICAL APPLICATIONS
+-- Xilinx products are not designed or intended to be fail-
+-- safe, or for use in any application requiring fail-safe
+-- performance, such as life-support or safety devices or
+-- systems, Class III medical devices, nuclear facilities,
+-- applications related to the deployment of airbags, or any
+-- other applications that could lead to death, personal
+-- injury, or severe property or environmental damage
+-- (individually and collectively, "Critical
+-- Applications"). Customer assumes the sole risk and
+-- liability of any use of Xilinx products in Critical
+-- Applications, subject only to applicable laws and
+-- regulations governing limitations on product liability.
+--
+-- THIS COPYRIGHT NOTICE AND DISCLAIMER MUST BE RETAINED AS
+-- PART OF THIS FILE AT ALL TIMES.
+*/
+
+#include <getopt.h>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "yolo_decode.h"
+/* sigmoid() and the classes, anchors and threshold of adas_detection */
+#include "utils.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace deephi;
+
+/* anchors of the four output nodes of adas_detection */
+const float yoloBiases[] = {123,100, 167,83, 98,174, 165,158, 347,98, 76,37,
+                            40,97, 74,64, 105,63, 66,131,18,46, 33,29, 47,23,
+                            28,68, 52,42, 5.5,7, 8,17, 14,11, 13,29, 24,17};
+
+/* Darknet decoding of adas_detection before YoloDecoder, the reference */
+void detect(vector<vector<float>> &boxes, vector<float> result,
+            int channel, int height, int weight, int num, int sh, int sw);
+
+void detect(vector<vector<float>> &boxes, vector<float> result,
+    int channel, int height, int width, int num, int sHeight, int sWidth) {
+    vector<float> biases{ 123,100, 167,83, 98,174, 165,158, 347,98, 76,37,
+                        40,97, 74,64, 105,63, 66,131,18,46, 33,29, 47,23,
+                        28,68, 52,42, 5.5,7, 8,17, 14,11, 13,29, 24,17 };
+    int conf_box = 5 + classificationCnt;
+    float swap[height * width][anchorCnt][conf_box];
+
+    for (int h = 0; h < height; ++h) {
+        for (int w = 0; w < width; ++w) {
+            for (int c = 0; c < channel; ++c) {
+                int temp = c * height * width + h * width + w;
+                swap[h * width + w][c / conf_box][c % conf_box] = result[temp];
+            }
+        }
+    }
+    for (int h = 0; h < height; ++h) {
+        for (int w = 0; w < width; ++w) {
+            for (int c = 0; c < anchorCnt; ++c) {
+                float obj_score = sigmoid(swap[h * width + w][c][4]);
+                if (obj_score < CONF)
+                    continue;
+                vector<float> box;
+
+                box.push_back((w + sigmoid(swap[h * width + w][c][0])) / width);
+                box.push_back((h + sigmoid(swap[h * width + w][c][1])) / height);
+                box.push_back(exp(swap[h * width + w][c][2]) * biases[2 * c + 10 * num] / float(sWidth));
+                box.push_back(exp(swap[h * width + w][c][3]) * biases[2 * c + 10 * num + 1] / float(sHeight));
+                box.push_back(-1);
+                box.push_back(obj_score);
+                for (int p = 0; p < classificationCnt; p++) {
+                    box.push_back(obj_score * sigmoid(swap[h * width + w][c][5 + p]));
+                }
+                boxes.push_back(box);
+            }
+        }
+    }
+}
+
+void get_output(int8_t* dpuOut, int sizeOut, float scale, int oc, int oh, int ow, vector<float>& result) {
+    vector<int8_t> nums(sizeOut);
+    memcpy(nums.data(), dpuOut, sizeOut);
+    for(int a = 0; a < oc; ++a){
+        for(int b = 0; b < oh; ++b){
+            for(int c = 0; c < ow; ++c) {
+                int offset = b * oc * ow + c * oc + a;
+                result[a * oh * ow + b * ow + c] = nums[offset] * scale;
+            }
+        }
+    }
+}
+
+/* shape of one output head */
+struct Head {
+    int height;
+    int width;
+    vector<int8_t> data;
+};
+
+void usage(const char *name) {
+    printf("Usage: %s [-w width] [-h height] [-s scale] [-d density] [-n runs]\n", name);
+    printf("\tCheck YoloDecoder against get_output() and detect() of adas_detection\n");
+    printf("\tand compare their speed on random outputs\n");
+    printf("\t-w width: width of the YOLO input (default: 512)\n");
+    printf("\t-h height: height of the YOLO input (default: 256)\n");
+    printf("\t-s scale: scale of the INT8 outputs (default: 0.125)\n");
+    printf("\t-d density: fraction of anchors above the threshold (default: 0.001)\n");
+    printf("\t-n runs: decodings timed (default: 200)\n");
+}
+
+int main(int argc, char **argv) {
+    int width = 512, height = 256, runs = 200;
+    float scale = 0.125f, density = 0.001f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:h:s:d:n:")) != -1) {
+        switch (opt) {
+        case 'w': width = atoi(optarg); break;
+        case 'h': height = atoi(optarg); break;
+        case 's': scale = atof(optarg); break;
+        case 'd': density = atof(optarg); break;
+        case 'n': runs = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (width < 32 || height < 32 || scale <= 0 || density < 0 || runs <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    const int conf_box = 5 + classificationCnt;
+    const int channel = anchorCnt * conf_box;
+    vector<YoloDecoder> decoders;
+    for (int i = 0; i < 4; i++) {
+        decoders.emplace_back(scale, classificationCnt, anchorCnt, yoloBiases + 2 * anchorCnt * i,
+                              CONF);
+    }
+    int passing = decoders[0].min_objectness();
+    printf("objectness threshold %g: INT8 value >= %d at scale %g\n", CONF, passing, scale);
+
+    /* heads of strides 32, 16, 8 and 4; objectness mostly low as on real
+       frames, other values uniform */
+    mt19937 rng(1);
+    uniform_int_distribution<int> any(-128, 127);
+    uniform_int_distribution<int> low(-128, max(passing - 1, -128));
+    uniform_int_distribution<int> high(min(passing, 127), 127);
+    uniform_real_distribution<float> u(0.0f, 1.0f);
+    vector<Head> heads(4);
+    int size = 0;
+    for (int i = 0; i < 4; i++) {
+        Head &head = heads[i];
+        head.height = height >> (5 - i);
+        head.width = width >> (5 - i);
+        head.data.resize(head.height * head.width * channel);
+        for (size_t j = 0; j < head.data.size(); j++) {
+            if (j % conf_box == 4) {
+                head.data[j] = (u(rng) < density) ? high(rng) : low(rng);
+            } else {
+                head.data[j] = any(rng);
+            }
+        }
+        size += head.data.size();
+    }
+
+    /* Darknet path: dequantize and transpose every head, then detect() */
+    vector<float> results[4];
+    auto reference = [&](vector<vector<float>> &boxes) {
+        for (int i = 0; i < 4; i++) {
+            Head &head = heads[i];
+            results[i].resize(head.data.size());
+            get_output(head.data.data(), head.data.size(), scale, channel, head.height,
+                       head.width, results[i]);
+            detect(boxes, results[i], channel, head.height, head.width, i, height, width);
+        }
+    };
+    auto fused = [&](Detections &boxes) {
+        for (int i = 0; i < 4; i++) {
+            Head &head = heads[i];
+            decoders[i].Decode(head.data.data(), head.height, head.width, width, height, boxes);
+        }
+    };
+
+    /* golden check, field by field */
+    vector<vector<float>> expected;
+    Detections actual(classificationCnt);
+    reference(expected);
+    fused(actual);
+    bool same = (expected.size() == actual.size());
+    for (size_t i = 0; same && i < expected.size(); i++) {
+        vector<float> box{actual.coord(0)[i], actual.coord(1)[i], actual.coord(2)[i],
+                          actual.coord(3)[i], (float)actual.label()[i], actual.score()[i]};
+        for (int k = 0; k < classificationCnt; k++) {
+            box.push_back(actual.class_score(k)[i]);
+        }
+        same = (expected[i] == box);
+    }
+    printf("golden check: %s, %d boxes from %d values\n", same ? "identical" : "different",
+           (int)expected.size(), size);
+    if (!same) {
+        fprintf(stderr, "Error: %d boxes decoded, %d expected\n", (int)actual.size(),
+                (int)expected.size());
+    }
+
+    /* speed, the boxes of the INT8 path reused as in adas_detection */
+    double us[2];
+    for (int path = 0; path < 2; path++) {
+        auto start = steady_clock::now();
+        for (int r = 0; r < runs; r++) {
+            if (path == 0) {
+                vector<vector<float>> boxes;
+                reference(boxes);
+            } else {
+                actual.clear();
+                fused(actual);
+            }
+        }
+        us[path] = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0 / runs;
+    }
+    printf("darknet %.1f us, int8 %.1f us per frame, %.1fx\n", us[0], us[1], us[0] / us[1]);
+
+    return same ? 0 : -1;
+}